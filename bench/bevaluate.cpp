@@ -0,0 +1,69 @@
+/**
+ * \file bevaluate.cpp
+ * \date Oct 17, 2026
+ */
+
+#include "pcsh/ir.hpp"
+#include "pcsh/ir_operations.hpp"
+#include "pcsh/parser.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace {
+
+    // arithmetic heavy script: every statement reads the previous ones
+    std::string make_script(int nstmts)
+    {
+        std::ostringstream os;
+        os << "v0 = 1;\nw0 = 0.5;\n";
+        for (int n = 1; n < nstmts; ++n) {
+            os << "v" << n << " = (v" << (n - 1) << " * 3 + " << n << ") / 2 - v" << (n - 1) << " / 7;\n";
+            os << "w" << n << " = w" << (n - 1) << " * 1.0001 + v" << n << " - (w" << (n - 1) << " / 3.0);\n";
+            if (n % 16 == 0) {
+                os << "if (v" << n << " == v" << n << ") { t" << n << " = -w" << n << " * 2; }\n";
+            }
+        }
+        return os.str();
+    }
+
+    double time_evaluate(const pcsh::ir::tree* ptree, pcsh::ir::evaluator e, int reps)
+    {
+        using clock = std::chrono::steady_clock;
+        auto start = clock::now();
+        for (int r = 0; r < reps; ++r) {
+            pcsh::ir::evaluate(ptree, e);
+        }
+        std::chrono::duration<double, std::milli> elapsed = clock::now() - start;
+        return elapsed.count() / reps;
+    }
+
+}//namespace
+
+int main(int argc, const char* argv[])
+{
+    using namespace pcsh;
+
+    int nstmts = (argc > 1) ? ::atoi(argv[1]) : 20000;
+    int reps = (argc > 2) ? ::atoi(argv[2]) : 20;
+
+    auto script = make_script(nstmts);
+    std::istringstream is(script);
+    auto ptree = parser::parser(is).parse_to_tree();
+
+    auto walker = time_evaluate(ptree.get(), ir::evaluator::TREE_WALKER, reps);
+    auto flat = time_evaluate(ptree.get(), ir::evaluator::FLAT_TREE, reps);
+    auto bytecode = time_evaluate(ptree.get(), ir::evaluator::BYTECODE, reps);
+    auto closures = time_evaluate(ptree.get(), ir::evaluator::CLOSURE, reps);
+
+    std::cout << "statements : " << (2 * nstmts) << "\n"
+              << "tree walker: " << walker << " ms\n"
+              << "flat tree  : " << flat << " ms\n"
+              << "bytecode   : " << bytecode << " ms\n"
+              << "closures   : " << closures << " ms\n"
+              << "speedup    : " << (walker / bytecode) << "x\n";
+    return 0;
+}
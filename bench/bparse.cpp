@@ -0,0 +1,120 @@
+/**
+ * \file bparse.cpp
+ * \date Oct 17, 2026
+ */
+
+#include "pcsh/ir.hpp"
+#include "pcsh/parser.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace {
+
+    std::string make_script(int nstmts)
+    {
+        std::ostringstream os;
+        os << "#!/usr/bin/env pcsh\n"
+           << "value0 = 1;\n";
+        for (int n = 1; n < nstmts; ++n) {
+            os << "# statement " << n << "\n"
+               << "value" << n << " = (value" << (n - 1) << " + " << n << ".25) * 3 - \"\" == \"\";\n";
+        }
+        return os.str();
+    }
+
+    // runs the lexer alone over the whole input
+    size_t lex_all(pcsh::parser::parser& p)
+    {
+        using namespace pcsh::parser;
+        size_t ntokens = 0;
+        while (true) {
+            pos_t start = 0;
+            auto t = p.peek(0, &start);
+            if (t.is_a(token_type::EOS) || t.is_a(token_type::FAIL)) {
+                break;
+            }
+            p.advance(start + t.length() + (t.is_a(token_type::QUOTE) ? 2 : 0));
+            ++ntokens;
+        }
+        return ntokens;
+    }
+
+    template <class Fn>
+    double time_mb_per_sec(Fn fn, size_t bytes, int reps)
+    {
+        using clock = std::chrono::steady_clock;
+        auto start = clock::now();
+        for (int r = 0; r < reps; ++r) {
+            fn();
+        }
+        std::chrono::duration<double> elapsed = clock::now() - start;
+        return (double(bytes) * reps) / (elapsed.count() * 1024 * 1024);
+    }
+
+}//namespace
+
+int main(int argc, const char* argv[])
+{
+    using namespace pcsh;
+
+    int nstmts = (argc > 1) ? ::atoi(argv[1]) : 20000;
+    int reps = (argc > 2) ? ::atoi(argv[2]) : 10;
+
+    auto script = make_script(nstmts);
+
+    size_t ntokens = 0;
+    auto lexstream = time_mb_per_sec([&] {
+            std::istringstream in(script);
+            parser::parser p(in);
+            ntokens = lex_all(p);
+        }, script.size(), reps);
+    std::string best = parser::lexer_kernels();
+    std::ostringstream perkernel;
+    for (auto name : { "scalar", "sse2", "avx2" }) {
+        if (!parser::select_lexer_kernels(name)) {
+            continue;
+        }
+        auto mbps = time_mb_per_sec([&] {
+                parser::parser p(script.data(), script.size());
+                lex_all(p);
+            }, script.size(), reps);
+        perkernel << "lex, " << name << std::string(10 - ::strlen(name), ' ') << ": " << mbps << " MB/s\n";
+    }
+    parser::select_lexer_kernels(best.c_str());
+    auto lexbuffer = time_mb_per_sec([&] {
+            parser::parser p(script.data(), script.size());
+            lex_all(p);
+        }, script.size(), reps);
+    auto lextokens = time_mb_per_sec([&] {
+            parser::token_stream toks(script.data(), script.size());
+        }, script.size(), reps);
+    parser::token_stream toks(script.data(), script.size());
+    auto parsetokens = time_mb_per_sec([&] {
+            parser::parser(toks).parse_to_tree();
+        }, script.size(), reps);
+    auto parsestream = time_mb_per_sec([&] {
+            std::istringstream in(script);
+            parser::parser(in).parse_to_tree();
+        }, script.size(), reps);
+    auto parsebuffer = time_mb_per_sec([&] {
+            parser::parser(script.data(), script.size()).parse_to_tree();
+        }, script.size(), reps);
+
+    std::cout << "bytes          : " << script.size() << "\n"
+              << "tokens         : " << ntokens << "\n"
+              << "kernels        : " << best << "\n"
+              << "lex, istream   : " << lexstream << " MB/s\n"
+              << "lex, buffer    : " << lexbuffer << " MB/s\n"
+              << perkernel.str()
+              << "lex, tokens    : " << lextokens << " MB/s\n"
+              << "parse, istream : " << parsestream << " MB/s\n"
+              << "parse, buffer  : " << parsebuffer << " MB/s\n"
+              << "parse, tokens  : " << parsetokens << " MB/s (tokens reused)\n";
+    return 0;
+}
@@ -0,0 +1,82 @@
+/**
+ * \file bvisit.cpp
+ * \date Oct 17, 2026
+ */
+
+#include "pcsh/ir.hpp"
+#include "pcsh/ir_operations.hpp"
+#include "pcsh/parser.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace {
+
+    // nodes in each generated statement: assign, var, minus, plus, var, mult, int, var, int
+    const int NODES_PER_STMT = 9;
+
+    std::string make_script(int nstmts)
+    {
+        std::ostringstream os;
+        os << "a0 = 1;\n";
+        for (int n = 1; n < nstmts; ++n) {
+            os << "a" << n << " = a" << (n - 1) << " + " << n << " * a" << (n - 1) << " - 1;\n";
+        }
+        return os.str();
+    }
+
+    class null_buffer : public std::streambuf
+    {
+      protected:
+        int overflow(int c) override
+        {
+            return c;
+        }
+    };
+
+    template <class Fn>
+    double time_ns_per_node(Fn fn, int nstmts, int reps)
+    {
+        using clock = std::chrono::steady_clock;
+        auto start = clock::now();
+        for (int r = 0; r < reps; ++r) {
+            fn();
+        }
+        std::chrono::duration<double, std::nano> elapsed = clock::now() - start;
+        return elapsed.count() / (double(reps) * nstmts * NODES_PER_STMT);
+    }
+
+}//namespace
+
+int main(int argc, const char* argv[])
+{
+    using namespace pcsh;
+
+    int nstmts = (argc > 1) ? ::atoi(argv[1]) : 20000;
+    int reps = (argc > 2) ? ::atoi(argv[2]) : 20;
+
+    auto script = make_script(nstmts);
+    std::istringstream is(script);
+    auto ptree = parser::parser(is).parse_to_tree();
+
+    null_buffer nb;
+    std::ostream nullos(&nb);
+
+    auto parse = time_ns_per_node([&] {
+            std::istringstream in(script);
+            parser::parser(in).parse_to_tree();
+        }, nstmts, reps);
+    auto print = time_ns_per_node([&] { ir::print(ptree.get(), nullos); }, nstmts, reps);
+    auto clone = time_ns_per_node([&] { ir::clone(ptree.get()); }, nstmts, reps);
+    auto walk = time_ns_per_node([&] { ir::evaluate(ptree.get(), ir::evaluator::TREE_WALKER); }, nstmts, reps);
+
+    std::cout << "nodes        : " << (nstmts * NODES_PER_STMT) << "\n"
+              << "parse+passes : " << parse << " ns/node\n"
+              << "print        : " << print << " ns/node\n"
+              << "clone        : " << clone << " ns/node\n"
+              << "tree walker  : " << walk << " ns/node\n";
+    return 0;
+}
@@ -7,6 +7,7 @@
 #define PCSH_ARENA_HPP
 
 #include "pcsh/exportsym.h"
+#include "pcsh/noncopyable.hpp"
 
 #include <algorithm>
 #include <cstring>
@@ -15,6 +16,39 @@
 
 namespace pcsh {
 
+    /// true for types whose destructor the arena never runs. Specialize for
+    /// types that are non-trivial only through an empty virtual destructor.
+    template <class T>
+    struct arena_skips_destructor : std::is_trivially_destructible<T>
+    { };
+
+    //////////////////////////////////////////////////////////////////////////
+    /// arena_policy : how an arena sizes and backs its segments
+    //////////////////////////////////////////////////////////////////////////
+
+    struct arena_policy
+    {
+        size_t initial;         // bytes in the first segment; a size hint
+        size_t growth;          // each new segment is this times the last
+        size_t max_segment;     // growth stops here
+        size_t mmap_threshold;  // segments this big are mapped from the OS
+        bool   huge_pages;      // and advised to use huge pages
+        bool   concurrent;      // allocations and destructor registration
+                                // may come from several threads at once;
+                                // mark(), rollback(), reset() and the
+                                // destructor still need the arena to
+                                // themselves
+
+        arena_policy(size_t init = 1024)
+          : initial(init)
+          , growth(2)
+          , max_segment(size_t(1) << 20)
+          , mmap_threshold(size_t(2) << 20)
+          , huge_pages(true)
+          , concurrent(false)
+        { }
+    };
+
     //////////////////////////////////////////////////////////////////////////
     /// arena
     //////////////////////////////////////////////////////////////////////////
@@ -24,8 +58,20 @@ namespace pcsh {
       public:
         arena(size_t sz = 1024);
 
+        explicit arena(const arena_policy& policy);
+
         ~arena();
 
+        /// an arena that lives in its own first segment, so making one takes
+        /// no allocation beyond the (pooled) segment. Release with destroy().
+        static arena* create(const arena_policy& policy = arena_policy());
+
+        static void destroy(arena* a);
+
+        /// destroys everything in the arena but keeps its segments for the
+        /// allocations that follow
+        void reset();
+
         inline const char* create_string(const char* str)
         {
             return create_string(str, ::strlen(str));
@@ -42,22 +88,53 @@ namespace pcsh {
         template <class T, class... Args>
         inline T* create(Args&&... args)
         {
-            static const bool trivialdtor = std::is_trivially_destructible<T>::value;
-            void* mem = allocate(sizeof(T), (trivialdtor ? nullptr : &destroyer<T>::act));
-            return new (mem) T(std::forward<Args>(args)...);
+            T* obj = new (allocate(sizeof(T))) T(std::forward<Args>(args)...);
+            if (!arena_skips_destructor<T>::value) {
+                // registered once constructed, so a throwing constructor
+                // leaves nothing to destroy
+                add_destructor(obj, &destroyer<T>::act);
+            }
+            return obj;
         }
 
         template <class T>
         inline T* create_array(size_t n)
         {
-            void* mem = allocate(sizeof(T) * n, nullptr);
-            return reinterpret_cast<T*>(mem);
+            return reinterpret_cast<T*>(allocate(sizeof(T) * n));
         }
 
         typedef void (*destroyfn)(void*);
+
+        /// where the next allocation goes; see `rollback()'
+        struct checkpoint
+        {
+            void*  seg;
+            char*  curr;
+            size_t left;
+            size_t ndtors;
+        };
+
+        checkpoint mark() const;
+
+        /// frees everything allocated since `cp' was taken, running the
+        /// destructors of those objects. Checkpoints taken after `cp' are
+        /// no longer valid.
+        void rollback(const checkpoint& cp);
+
+        /// segments in use
+        size_t segment_count() const;
+
+        /// bytes handed out, alignment padding included
+        size_t bytes_used() const;
       private:
         struct impl;
 
+        struct hosted
+        { };
+
+        arena(impl* i, hosted) : impl_(i)
+        { }
+
         template <class T>
         struct destroyer
         {
@@ -67,11 +144,85 @@ namespace pcsh {
             }
         };
 
-        void* allocate(size_t sz, destroyfn fn);
+        // allocations carry no header; objects with destructors are listed
+        // separately and destroyed newest first
+        void* allocate(size_t sz);
+
+        void add_destructor(void* obj, destroyfn fn);
 
         impl* impl_;
     };
 
+    //////////////////////////////////////////////////////////////////////////
+    /// arena_allocator : a standard allocator drawing from an arena
+    //////////////////////////////////////////////////////////////////////////
+
+    /// Memory is only given back with the arena, so deallocate() does nothing;
+    /// best for containers that live no longer than the arena and rarely shrink.
+    template <class T>
+    class arena_allocator
+    {
+      public:
+        typedef T value_type;
+
+        explicit arena_allocator(arena& a) : arena_(&a)
+        { }
+
+        template <class U>
+        arena_allocator(const arena_allocator<U>& rhs) : arena_(&rhs.get_arena())
+        { }
+
+        inline T* allocate(size_t n)
+        {
+            static_assert(alignof(T) <= 8, "Arena memory is only 8 byte aligned.");
+            if (n > (~size_t(0) / sizeof(T))) {
+                throw std::bad_alloc();
+            }
+            return arena_->create_array<T>(n);
+        }
+
+        inline void deallocate(T*, size_t)
+        { }
+
+        inline arena& get_arena() const
+        {
+            return *arena_;
+        }
+      private:
+        arena* arena_;
+    };
+
+    template <class T, class U>
+    inline bool operator==(const arena_allocator<T>& a, const arena_allocator<U>& b)
+    {
+        return &a.get_arena() == &b.get_arena();
+    }
+
+    template <class T, class U>
+    inline bool operator!=(const arena_allocator<T>& a, const arena_allocator<U>& b)
+    {
+        return !(a == b);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    /// arena_scope : rolls an arena back to where it was on scope exit
+    //////////////////////////////////////////////////////////////////////////
+
+    class arena_scope : public noncopyable
+    {
+      public:
+        explicit arena_scope(arena& a) : arena_(a), cp_(a.mark())
+        { }
+
+        ~arena_scope()
+        {
+            arena_.rollback(cp_);
+        }
+      private:
+        arena& arena_;
+        arena::checkpoint cp_;
+    };
+
 }//namespace pcsh
 
 #endif/*PCSH_ARENA_HPP*/
@@ -11,16 +11,66 @@
 #include "pcsh/noncopyable.hpp"
 #include "pcsh/types.hpp"
 
+#include <cstdint>
 #include <memory>
 
 namespace pcsh {
+namespace execution {
+
+    struct closure_program;
+    struct program;
+
+}// namespace execution
+
 namespace ir {
 
     class node_visitor;
 
+    struct flat_tree;
+
+    enum class node_kind : byte
+    {
+        VARIABLE,
+        INT_CONSTANT,
+        FLOAT_CONSTANT,
+        STRING_CONSTANT,
+        UNARY_PLUS,
+        UNARY_MINUS,
+        BINARY_DIV,
+        BINARY_MINUS,
+        BINARY_MULT,
+        BINARY_PLUS,
+        ASSIGN,
+        COMP_EQUALS,
+        BLOCK,
+        IF_STMT
+    };
+
     class PCSH_API node : public noncopyable
     {
       public:
+        static const std::uint32_t NO_LOCATION = ~std::uint32_t(0);
+
+        inline node(node_kind k) : kind_(k), loc_(NO_LOCATION)
+        { }
+
+        inline node_kind kind() const
+        {
+            return kind_;
+        }
+
+        /// index of this node in the location table of the parse that made
+        /// it, or NO_LOCATION
+        inline std::uint32_t location() const
+        {
+            return loc_;
+        }
+
+        inline void set_location(std::uint32_t loc)
+        {
+            loc_ = loc;
+        }
+
         inline void accept(node_visitor* v) const
         {
             accept_impl(v);
@@ -39,6 +89,9 @@ namespace ir {
         inline virtual ~node()
         { }
       private:
+        node_kind kind_;
+        std::uint32_t loc_;     // fits beside kind_
+
         virtual void accept_impl(node_visitor* v) const = 0;
         virtual node* left_impl() const = 0;
         virtual node* right_impl() const = 0;
@@ -51,21 +104,21 @@ namespace ir {
         {
             inline void operator()(tree* p) const
             {
-                delete p->arena_;
+                arena::destroy(p->arena_);
             }
         };
       public:
         typedef std::unique_ptr<tree, tree_destroyer> ptr;
 
-        inline static ptr create()
+        inline static ptr create(const arena_policy& policy = arena_policy())
         {
-            arena* parena = new arena;
+            arena* parena = arena::create(policy);
             ptr p(parena->create<tree>());
             p->arena_ = parena;
-            return std::move(p);
+            return p;
         }
 
-        inline tree(node* root = nullptr) : root_(root), arena_(nullptr)
+        inline tree(node* root = nullptr) : root_(root), arena_(nullptr), program_(nullptr), flat_(nullptr), closures_(nullptr)
         { }
 
         inline node* root() const
@@ -78,7 +131,7 @@ namespace ir {
             root_->accept(v);
         }
 
-        inline arena& get_arena()
+        inline arena& get_arena() const
         {
             return *arena_;
         }
@@ -86,10 +139,49 @@ namespace ir {
         inline void set_root(node* p)
         {
             root_ = p;
+            program_ = nullptr;
+            flat_ = nullptr;
+            closures_ = nullptr;
+        }
+
+        /// bytecode compiled from this tree, if any
+        inline const execution::program* compiled() const
+        {
+            return program_;
+        }
+
+        inline void set_compiled(const execution::program* p) const
+        {
+            program_ = p;
+        }
+
+        /// flat form of this tree, if any
+        inline const flat_tree* flattened() const
+        {
+            return flat_;
+        }
+
+        inline void set_flattened(const flat_tree* p) const
+        {
+            flat_ = p;
+        }
+
+        /// closures compiled from this tree, if any
+        inline const execution::closure_program* closures() const
+        {
+            return closures_;
+        }
+
+        inline void set_closures(const execution::closure_program* p) const
+        {
+            closures_ = p;
         }
       private:
         node* root_;
         arena* arena_;
+        mutable const execution::program* program_;
+        mutable const flat_tree* flat_;
+        mutable const execution::closure_program* closures_;
     };
 
 }// namespace ir
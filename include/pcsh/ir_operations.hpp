@@ -20,7 +20,23 @@ namespace ir {
 
     PCSH_API tree::ptr clone(const tree* ptree);
 
-    PCSH_API void evaluate(const tree* ptree);
+    enum class evaluator : byte
+    {
+        TREE_WALKER,
+        FLAT_TREE,
+        BYTECODE,
+        CLOSURE
+    };
+
+    PCSH_API void evaluate(const tree* ptree, evaluator e = evaluator::BYTECODE);
+
+    /// most nodes of one shape FLAT_TREE takes, 2^28 - 1 at most, as its
+    /// node references have 28 index bits; larger trees are evaluated as
+    /// BYTECODE instead
+    PCSH_API size_t flat_tree_limit();
+
+    /// lowers the FLAT_TREE limit for trees flattened from now on
+    PCSH_API void set_flat_tree_limit(size_t n);
 
     struct var_value
     {
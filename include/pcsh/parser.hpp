@@ -9,10 +9,16 @@
 #include "pcsh/exportsym.h"
 #include "pcsh/arena.hpp"
 #include "pcsh/ir.hpp"
+#include "pcsh/noncopyable.hpp"
+#include "pcsh/pass_manager.hpp"
 #include "pcsh/types.hpp"
 
+#include <cstdint>
 #include <iostream>
 #include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
 #if defined(_MSC_VER)
 #  pragma warning(disable:4251)
@@ -107,6 +113,7 @@ namespace parser {
         static token get(token_type t, cstring nm = nullptr, size_t len = 0);
 
         friend class parser;
+        friend class token_stream;
 
         token_type type_;
         cstring str_;
@@ -146,16 +153,102 @@ namespace parser {
     };
 
     //////////////////////////////////////////////////////////////////////////
-    /// parser
+    /// lexer kernels
     //////////////////////////////////////////////////////////////////////////
 
+    /// name of the lexer kernels in use: "avx2", "sse2" or "scalar"
+    PCSH_API cstring lexer_kernels();
+
+    /// switches the lexer kernels; false if this build or CPU lacks them
+    PCSH_API bool select_lexer_kernels(cstring name);
+
     using pos_t = size_t;
 
+    //////////////////////////////////////////////////////////////////////////
+    /// token_stream : a whole input lexed up front
+    //////////////////////////////////////////////////////////////////////////
+
+    /// Tokens are kept as parallel arrays of types, offsets, lengths and
+    /// lines, ending with an EOS token, or a FAIL token where lexing stopped.
+    /// A stream can be parsed any number of times.
+    class PCSH_API token_stream : public noncopyable
+    {
+      public:
+        // lexes [buf, buf + len); the memory must outlive the stream
+        token_stream(const char* buf, size_t len);
+
+        // reads all of `is' and keeps a copy of it
+        explicit token_stream(std::istream& is);
+
+        inline size_t size() const
+        {
+            return types_.size();
+        }
+
+        inline token_type type(size_t i) const
+        {
+            return types_[i];
+        }
+
+        inline pos_t offset(size_t i) const
+        {
+            return offsets_[i];
+        }
+
+        inline int line(size_t i) const
+        {
+            return static_cast<int>(lines_[i]);
+        }
+
+        // characters from the end of the previous line, as parser reports it
+        inline pos_t column(size_t i) const
+        {
+            return offsets_[i] - line_starts_[lines_[i] - 1];
+        }
+
+        token get(size_t i) const;
+
+        inline const char* data() const
+        {
+            return data_;
+        }
+
+        inline size_t bytes() const
+        {
+            return size_;
+        }
+      private:
+        std::string              copy_;
+        const char*              data_;
+        size_t                   size_;
+        std::vector<token_type>  types_;
+        std::vector<uint32_t>    offsets_;
+        std::vector<uint32_t>    lengths_;
+        std::vector<uint32_t>    lines_;
+        std::vector<uint32_t>    line_starts_;
+        // (token, offset into literals_) for each string literal
+        std::vector<std::pair<uint32_t, uint32_t>> quotes_;
+        std::string              literals_;
+        cstring                  error_;
+
+        void lex();
+    };
+
+    //////////////////////////////////////////////////////////////////////////
+    /// parser
+    //////////////////////////////////////////////////////////////////////////
+
     class PCSH_API parser
     {
       public:
         parser(std::istream& is, const std::string& filename = "(test)");
 
+        // lexes [buf, buf + len) in place; the memory must outlive the parser
+        parser(const char* buf, size_t len, const std::string& filename = "(test)");
+
+        // parses pre-lexed tokens; `toks' must outlive the parser
+        parser(const token_stream& toks, const std::string& filename = "(test)");
+
         ~parser();
 
         token peek(pos_t p = 0, pos_t* pactstart = nullptr);
@@ -177,6 +270,9 @@ namespace parser {
         // returns a valid executable tree, except for use before assign errors.
         ir::tree::ptr parse_to_tree();
 
+        // the same, running `passes' over the tree
+        ir::tree::ptr parse_to_tree(ir::pass_manager& passes);
+
         void sync_stream();
       private:
         class buffered_stream;
@@ -184,6 +280,7 @@ namespace parser {
         class parser_engine;
 
         buffered_stream* strm_;
+        const token_stream* toks_;
         int line_;
         pos_t line_start_;
         std::string filename_;
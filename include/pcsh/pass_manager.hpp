@@ -0,0 +1,97 @@
+/**
+ * \file pass_manager.hpp
+ * \date Oct 17, 2026
+ */
+
+#ifndef PCSH_PASS_MANAGER_HPP
+#define PCSH_PASS_MANAGER_HPP
+
+#include "pcsh/exportsym.h"
+#include "pcsh/ir.hpp"
+#include "pcsh/noncopyable.hpp"
+#include "pcsh/ostream.hpp"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER)
+#  pragma warning(disable:4251)
+#endif // defined(_MSC_VER)
+
+namespace pcsh {
+namespace ir {
+
+    //////////////////////////////////////////////////////////////////////////
+    /// pass_manager : the passes run over a freshly parsed tree
+    //////////////////////////////////////////////////////////////////////////
+
+    class PCSH_API pass_manager : public noncopyable
+    {
+      public:
+        typedef std::function<void(const tree&)> pass_fn;
+
+        struct pass_stats
+        {
+            std::string name;
+            double seconds;
+            size_t nodes;       // in the tree once the pass is done
+            size_t arena_bytes; // allocated from the tree's arena by the pass
+        };
+
+        /// the standard pipeline: "type-check", which every tree needs,
+        /// then the optional "fold" and "compile"
+        pass_manager();
+
+        /// appends an optional pass, or replaces the one called `name';
+        /// false, leaving the pipeline as is, if that pass is required
+        bool add(const std::string& name, pass_fn fn);
+
+        /// switches an optional pass on or off; false if there is no such
+        /// pass or it is required
+        bool enable(const std::string& name, bool on);
+
+        /// names of the passes in pipeline order
+        std::vector<std::string> passes() const;
+
+        /// record pass_stats as passes run; off by default
+        inline void set_timing(bool on)
+        {
+            timing_ = on;
+        }
+
+        inline bool timing() const
+        {
+            return timing_;
+        }
+
+        void run(const tree& t);
+
+        /// runs `fn' over `t' as if it were a pass, e.g. to time parsing
+        void measure(const std::string& name, const tree& t, const std::function<void()>& fn);
+
+        inline const std::vector<pass_stats>& stats() const
+        {
+            return stats_;
+        }
+
+        /// a table of the recorded stats
+        void report(ostream& os) const;
+      private:
+        struct pass
+        {
+            std::string name;
+            pass_fn fn;
+            bool required;
+            bool enabled;
+        };
+
+        std::vector<pass> passes_;
+        std::vector<pass_stats> stats_;
+        bool timing_;
+    };
+
+}//namespace ir
+}//namespace pcsh
+
+#endif/*PCSH_PASS_MANAGER_HPP*/
@@ -24,6 +24,7 @@ set(pcsh_hdr
     ${hdr_dir}/noncopyable.hpp;
     ${hdr_dir}/ostream.hpp;
     ${hdr_dir}/parser.hpp;
+    ${hdr_dir}/pass_manager.hpp;
     ${hdr_dir}/result_type.hpp;
     ${hdr_dir}/types.hpp;
     ${hdr_dir}/version.hpp;
@@ -31,17 +32,25 @@ set(pcsh_hdr
 
 # internal
 set(pcsh_int_hdr
+    ${src_dir}/execution/bytecode.hpp;
+    ${src_dir}/execution/closures.hpp;
+    ${src_dir}/execution/flat_interpreter.hpp;
     ${src_dir}/execution/interpreter.hpp;
+    ${src_dir}/ir/expression_walker.hpp;
+    ${src_dir}/ir/flat_tree.hpp;
     ${src_dir}/ir/nodes.hpp;
     ${src_dir}/ir/nodes_fwd.hpp;
     ${src_dir}/ir/ops/printer.hpp;
     ${src_dir}/ir/ops/tree_cloner.hpp;
     ${src_dir}/ir/ops/variable_printer.hpp;
-    ${src_dir}/ir/passes/populate_symbol_table.hpp;
+    ${src_dir}/ir/passes/constant_folder.hpp;
+    ${src_dir}/ir/passes/resolve_variables.hpp;
     ${src_dir}/ir/passes/type_checker.hpp;
+    ${src_dir}/ir/static_visitor.hpp;
+    ${src_dir}/ir/string_table.hpp;
     ${src_dir}/ir/symbol_table.hpp;
-    ${src_dir}/ir/tree_validation.hpp;
     ${src_dir}/ir/visitor.hpp;
+    ${src_dir}/parser/lexer_kernels.hpp;
     ${src_dir}/parser/parser_engine.hpp;
 )
 
@@ -49,18 +58,27 @@ set(pcsh_int_hdr
 set(pcsh_src
     ${src_dir}/assert.cpp;
     ${src_dir}/arena.cpp;
+    ${src_dir}/execution/closures.cpp;
+    ${src_dir}/execution/compiler.cpp;
+    ${src_dir}/execution/flat_interpreter.cpp;
     ${src_dir}/execution/interpreter.cpp;
+    ${src_dir}/execution/vm.cpp;
+    ${src_dir}/ir/flat_tree.cpp;
     ${src_dir}/ir/operations.cpp;
+    ${src_dir}/ir/pass_manager.cpp;
     ${src_dir}/ir/ops/printer.cpp;
     ${src_dir}/ir/ops/tree_cloner.cpp;
     ${src_dir}/ir/ops/variable_printer.cpp;
     ${src_dir}/ir/visitor.cpp;
-    ${src_dir}/ir/passes/populate_symbol_table.cpp;
+    ${src_dir}/ir/passes/constant_folder.cpp;
+    ${src_dir}/ir/passes/resolve_variables.cpp;
     ${src_dir}/ir/passes/type_checker.cpp;
+    ${src_dir}/ir/string_table.cpp;
     ${src_dir}/ir/symbol_table.cpp;
-    ${src_dir}/ir/tree_validation.cpp;
+    ${src_dir}/parser/lexer_kernels.cpp;
     ${src_dir}/parser/parser_engine.cpp;
     ${src_dir}/parser/parser.cpp;
+    ${src_dir}/parser/token_stream.cpp;
     ${src_dir}/version.cpp;
 )
 
@@ -80,6 +98,7 @@ set_target_properties(libpcsh PROPERTIES PREFIX "")
 # --- main executable
 set(pcsh_main_src
     ${src_dir}/main/linebufistream.hpp;
+    ${src_dir}/main/mappedfile.hpp;
     ${src_dir}/main/main.cpp;
 )
 
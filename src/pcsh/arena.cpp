@@ -4,179 +4,502 @@
  */
 
 #include "pcsh/arena.hpp"
+#include "pcsh/assert.hpp"
 
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#if !defined(_WIN32)
+#  include <sys/mman.h>
+#endif//!defined(_WIN32)
 
 namespace pcsh {
 
-    struct header
+    struct segment
     {
-        size_t sz;
+        segment* fwd;
+        size_t sz;      // bytes, this header included
+        size_t left;
+        char* curr;
+        std::atomic<size_t> used;   // bump offset for concurrent arenas
+        bool mapped;    // from mmap rather than operator new
 
-        header(size_t s, bool dtor = false) : sz((s & ~size_t(1)) | (dtor ? 1 : 0))
+        segment(size_t s, bool m) : fwd(nullptr), sz(s), left(0), curr(nullptr), used(0), mapped(m)
         {
+            rewind();
         }
 
-        size_t size() const
+        inline char* base()
         {
-            return sz & ~size_t(1);
+            return reinterpret_cast<char*>(this + 1);
         }
 
-        bool has_dtor() const
+        inline size_t capacity() const
         {
-            return sz & size_t(1);
+            return sz - sizeof(segment);
         }
 
-        char* data()
+        inline void rewind()
         {
-            auto ptr = reinterpret_cast<char*>(this);
-            return ptr + sizeof(header) + (has_dtor() ? sizeof(void*) : 0);
+            curr = base();
+            left = capacity();
+            used.store(0, std::memory_order_relaxed);
         }
+    };
 
-        header* next()
-        {
-            return reinterpret_cast<header*>(data() + size());
-        }
+    struct dtor_entry
+    {
+        void* obj;
+        arena::destroyfn fn;
     };
 
-    struct dtor_header : public header
+    // destructors are listed in chunks allocated from the arena itself
+    struct dtor_chunk
     {
-        void* ptr;
+        static const size_t CAPACITY = 15;
 
-        dtor_header(size_t s) : header(s, true)
-        {
-        }
+        dtor_chunk* prev;
+        size_t n;
+        dtor_entry entries[CAPACITY];
     };
 
-    struct segment
+    void* call_malloc(size_t sz)
     {
-        segment* fwd;
-        size_t sz;
-        size_t left;
-        char* curr;
+        return ::operator new(sz);
+    }
+
+    void call_free(void* ptr)
+    {
+        ::operator delete(ptr);
+    }
+
+    // anonymous memory straight from the OS, or nullptr
+    void* call_mmap(size_t sz, bool hugepages)
+    {
+#if !defined(_WIN32)
+        void* p = ::mmap(nullptr, sz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) {
+            return nullptr;
+        }
+#  if defined(MADV_HUGEPAGE)
+        if (hugepages) {
+            ::madvise(p, sz, MADV_HUGEPAGE);
+        }
+#  endif//defined(MADV_HUGEPAGE)
+        static_cast<void>(hugepages);
+        return p;
+#else
+        static_cast<void>(sz);
+        static_cast<void>(hugepages);
+        return nullptr;
+#endif//!defined(_WIN32)
+    }
+
+    void call_munmap(void* ptr, size_t sz)
+    {
+#if !defined(_WIN32)
+        ::munmap(ptr, sz);
+#else
+        static_cast<void>(ptr);
+        static_cast<void>(sz);
+#endif//!defined(_WIN32)
+    }
+
+    void release_segment(segment* s)
+    {
+        if (s->mapped) {
+            call_munmap(s, s->sz);
+        } else {
+            call_free(s);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    /// segment_pool : free segments shared by every arena
+    //////////////////////////////////////////////////////////////////////////
 
-        segment(size_t s) : fwd(nullptr), sz(s), left(s), curr(nullptr)
+    class segment_pool
+    {
+      public:
+        static const size_t MIN_SHIFT = 10;
+        static const size_t MAX_SHIFT = 24;
+        static const size_t NUM_CLASSES = MAX_SHIFT - MIN_SHIFT + 1;
+        static const size_t MAX_CACHED = size_t(64) << 20;
+
+        // never destroyed, as arenas may outlive static destruction
+        static segment_pool& instance()
         {
-            curr = reinterpret_cast<char*>(const_cast<segment*>(this) + 1);
+            static segment_pool* pool = new segment_pool();
+            return *pool;
         }
 
-        inline header* begin()
+        // bytes for a segment with `need' usable bytes: a power of two when
+        // it can be pooled, at least `minsz'
+        static size_t segment_bytes(size_t need, size_t minsz)
         {
-            return reinterpret_cast<header*>(const_cast<segment*>(this) + 1);
+            need = std::max(need + sizeof(segment), minsz);
+            if (need > (size_t(1) << MAX_SHIFT)) {
+                // a whole number of huge pages
+                static const size_t ALIGN = (size_t(2) << 20) - 1;
+                return (need + ALIGN) & ~ALIGN;
+            }
+            size_t bytes = size_t(1) << MIN_SHIFT;
+            while (bytes < need) {
+                bytes <<= 1;
+            }
+            return bytes;
         }
 
-        inline header* end()
+        segment* get(size_t bytes, const arena_policy& policy)
         {
-            return reinterpret_cast<header*>(curr);
+            auto c = size_class(bytes);
+            if (c < NUM_CLASSES) {
+                std::lock_guard<std::mutex> lock(mtx_);
+                segment* s = free_[c];
+                if (s) {
+                    free_[c] = s->fwd;
+                    cached_ -= bytes;
+                    return new (s) segment(bytes, s->mapped);
+                }
+            }
+            if (bytes >= policy.mmap_threshold) {
+                if (void* mem = call_mmap(bytes, policy.huge_pages)) {
+                    return new (mem) segment(bytes, true);
+                }
+            }
+            return new (call_malloc(bytes)) segment(bytes, false);
         }
 
-        inline void call_dtors()
+        void put(segment* s)
         {
-            header* f = begin();
-            header* const e = end();
-            while (f != e) {
-                if (f->has_dtor()) {
-                    typedef void (*dtorfn)(void*);
-                    static_assert(
-                        std::is_same<dtorfn, arena::destroyfn>::value,
-                        "Destructor functions must have compatible signatures!");
-                    ((dtorfn)(static_cast<dtor_header*>(f)->ptr))(f->data());
+            auto c = size_class(s->sz);
+            if (c < NUM_CLASSES) {
+                std::lock_guard<std::mutex> lock(mtx_);
+                if (cached_ + s->sz <= MAX_CACHED) {
+                    s->fwd = free_[c];
+                    free_[c] = s;
+                    cached_ += s->sz;
+                    return;
                 }
-                f = f->next();
             }
+            release_segment(s);
+        }
+
+        // returns a whole chain
+        void put_all(segment* s)
+        {
+            while (s) {
+                segment* next = s->fwd;
+                put(s);
+                s = next;
+            }
+        }
+      private:
+        std::mutex mtx_;
+        segment* free_[NUM_CLASSES];
+        size_t cached_;
+
+        segment_pool() : mtx_(), free_(), cached_(0)
+        { }
+
+        // NUM_CLASSES for sizes that are not pooled
+        static size_t size_class(size_t bytes)
+        {
+            if ((bytes & (bytes - 1)) != 0) {
+                return NUM_CLASSES;
+            }
+            size_t c = 0;
+            while ((size_t(1) << (c + MIN_SHIFT)) < bytes) {
+                ++c;
+            }
+            return c;
         }
     };
 
-    void* call_malloc(size_t sz)
+    inline size_t align8(size_t sz)
     {
-        return ::operator new(sz);
+        return (sz + 7) & ~size_t(7);
     }
 
-    void call_free(void* ptr)
+    inline void* allocate_from_seg(segment* seg, size_t sz)
     {
-        ::operator delete(ptr);
+        void* mem = seg->curr;
+        seg->curr += sz;
+        seg->left -= sz;
+        return mem;
     }
 
-    segment* new_segment(size_t sz)
+    // A thread's piece of the concurrent arena it last allocated from. Arenas
+    // get a fresh id when created or rolled back, which drops stale pieces.
+    struct local_chunk
     {
-        static const size_t ALIGN = 15;
-        // align to nearest multiple of 16
-        sz = (sz + ALIGN) & ~ALIGN;
-        sz += sizeof(segment);
-        void* mem = call_malloc(sz + sizeof(segment));
-        return new (mem) segment(sz);
-    }
+        std::uint64_t owner;
+        char* curr;
+        size_t left;
+    };
 
-    void destroy_segments(segment* seg)
+    thread_local local_chunk tls_chunk = { 0, nullptr, 0 };
+
+    std::atomic<std::uint64_t> next_arena_id(1);
+
+    //////////////////////////////////////////////////////////////////////////
+    /// arena
+    //////////////////////////////////////////////////////////////////////////
+
+    // Lives at the start of the arena's first segment.
+    struct arena::impl
     {
-        while (seg) {
-            segment* next = seg->fwd;
-            seg->call_dtors();
-            call_free(seg);
-            seg = next;
+        segment* seg_;      // newest first
+        segment* spare_;    // emptied by reset() or rollback()
+        arena_policy policy_;
+        size_t lastsz_;     // bytes in the newest segment made
+        dtor_chunk* dtors_;
+        size_t ndtors_;
+        checkpoint base_;   // just past this, and a hosted arena
+
+        // concurrent arenas: threads carve LOCAL_CHUNK pieces out of `shared_'
+        // with an atomic bump and allocate from those without locking
+        static const size_t LOCAL_CHUNK = 4096;
+
+        std::atomic<std::uint64_t> id_;
+        std::atomic<segment*> shared_;
+        std::mutex seg_mtx_;    // adding segments
+        std::mutex dtor_mtx_;   // the destructor list; taken before seg_mtx_
+
+        impl(segment* s, const arena_policy& p)
+          : seg_(s), spare_(nullptr), policy_(p), lastsz_(s->sz), dtors_(nullptr), ndtors_(0), base_()
+          , id_(next_arena_id.fetch_add(1)), shared_(s), seg_mtx_(), dtor_mtx_()
+        {
+            s->used.store(static_cast<size_t>(s->curr - s->base()), std::memory_order_relaxed);
+            base_ = mark();
         }
-    }
 
-    void* allocate_from_seg(segment* seg, size_t sz, void* ptr)
-    {
-        header* h = nullptr;
-        if (ptr) {
-            dtor_header* hdr = new (seg->end()) dtor_header(sz - sizeof(dtor_header));
-            hdr->ptr = ptr;
-            h = hdr;
-        } else {
-            header* hdr = new (seg->end()) header(sz - sizeof(header));
-            h = hdr;
+        static impl* create(const arena_policy& p)
+        {
+            auto& pool = segment_pool::instance();
+            segment* s = pool.get(segment_pool::segment_bytes(align8(sizeof(impl)), p.initial), p);
+            return new (allocate_from_seg(s, align8(sizeof(impl)))) impl(s, p);
         }
-        seg->curr = reinterpret_cast<char*>(h->next());
-        seg->left -= sz;
-        return h->data();
-    }
 
-    struct arena::impl
-    {
-        segment* seg_;
-        size_t minsz_;
+        static void destroy(impl* i)
+        {
+            i->call_dtors(0);
+            // `i' is in the oldest segment
+            segment* segs = i->seg_;
+            segment* spare = i->spare_;
+            i->~impl();
+            auto& pool = segment_pool::instance();
+            pool.put_all(spare);
+            pool.put_all(segs);
+        }
+
+        inline checkpoint mark() const
+        {
+            checkpoint cp = { seg_, seg_->curr, seg_->left, ndtors_ };
+            if (policy_.concurrent) {
+                auto used = std::min(seg_->used.load(std::memory_order_relaxed), seg_->capacity());
+                cp.curr = seg_->base() + used;
+                cp.left = seg_->capacity() - used;
+            }
+            return cp;
+        }
+
+        inline void* alloc(size_t sz)
+        {
+            return policy_.concurrent ? allocate_concurrent(sz) : allocate(sz);
+        }
+
+        inline void* allocate(size_t sz)
+        {
+            if (seg_->left >= sz) {
+                return allocate_from_seg(seg_, sz);
+            }
+            segment* s = next_segment(sz);
+            return allocate_from_seg(s, sz);
+        }
 
-        impl(size_t sz) : seg_(new_segment(sz)), minsz_(sz)
+        void* allocate_concurrent(size_t sz)
         {
+            auto& tl = tls_chunk;
+            auto id = id_.load(std::memory_order_relaxed);
+            if ((tl.owner != id) || (tl.left < sz)) {
+                if (sz > LOCAL_CHUNK / 4) {
+                    return allocate_shared(sz);
+                }
+                tl.curr = static_cast<char*>(allocate_shared(LOCAL_CHUNK));
+                tl.left = LOCAL_CHUNK;
+                tl.owner = id;
+            }
+            void* mem = tl.curr;
+            tl.curr += sz;
+            tl.left -= sz;
+            return mem;
+        }
+
+        void* allocate_shared(size_t sz)
+        {
+            while (true) {
+                segment* s = shared_.load(std::memory_order_acquire);
+                auto off = s->used.fetch_add(sz, std::memory_order_relaxed);
+                if (off + sz <= s->capacity()) {
+                    return s->base() + off;
+                }
+                std::lock_guard<std::mutex> lock(seg_mtx_);
+                if (shared_.load(std::memory_order_relaxed) == s) {
+                    shared_.store(next_segment(sz), std::memory_order_release);
+                }
+            }
         }
 
-        ~impl()
+        // makes a segment with room for `sz' the newest
+        segment* next_segment(size_t sz)
         {
-            if (seg_) {
-                destroy_segments(seg_);
+            segment* s = spare_;
+            if (s && (s->left >= sz)) {
+                spare_ = s->fwd;
+            } else {
+                // grow geometrically up to the largest segment size
+                auto next = std::min(lastsz_ * std::max(policy_.growth, size_t(1)), policy_.max_segment);
+                s = segment_pool::instance().get(segment_pool::segment_bytes(sz, next), policy_);
+                lastsz_ = s->sz;
             }
+            s->fwd = seg_;
+            seg_ = s;
+            return s;
         }
 
-        inline void* allocate(size_t sz, void* fptr)
+        inline void add_destructor(void* obj, destroyfn fn)
         {
-            if (seg_->left > sz) {
-                return allocate_from_seg(seg_, sz, fptr);
+            if (policy_.concurrent) {
+                std::lock_guard<std::mutex> lock(dtor_mtx_);
+                push_destructor(obj, fn);
             } else {
-                size_t segsz = std::max(sz, minsz_);
-                segment* s = new_segment(segsz);
-                s->fwd = seg_;
-                seg_ = s;
-                return allocate_from_seg(s, sz, fptr);
+                push_destructor(obj, fn);
+            }
+        }
+
+        inline void push_destructor(void* obj, destroyfn fn)
+        {
+            if (!dtors_ || (dtors_->n == dtor_chunk::CAPACITY)) {
+                auto c = static_cast<dtor_chunk*>(alloc(align8(sizeof(dtor_chunk))));
+                c->prev = dtors_;
+                c->n = 0;
+                dtors_ = c;
+            }
+            dtor_entry e = { obj, fn };
+            dtors_->entries[dtors_->n++] = e;
+            ++ndtors_;
+        }
+
+        // destroys objects newest first, down to the first `n'
+        inline void call_dtors(size_t n)
+        {
+            while (ndtors_ > n) {
+                auto& e = dtors_->entries[--dtors_->n];
+                --ndtors_;
+                e.fn(e.obj);
+                if (dtors_->n == 0) {
+                    dtors_ = dtors_->prev;
+                }
+            }
+        }
+
+        inline void rollback(const checkpoint& cp)
+        {
+            call_dtors(cp.ndtors);
+            // segments added since the mark are kept empty for reuse
+            while (seg_ != cp.seg) {
+                PCSH_ASSERT_MSG(seg_, "Rolling back to a checkpoint from another arena!");
+                segment* next = seg_->fwd;
+                seg_->rewind();
+                seg_->fwd = spare_;
+                spare_ = seg_;
+                seg_ = next;
+            }
+            seg_->curr = cp.curr;
+            seg_->left = cp.left;
+            if (policy_.concurrent) {
+                // pieces threads hold may lie past the checkpoint
+                id_.store(next_arena_id.fetch_add(1), std::memory_order_relaxed);
+                seg_->used.store(static_cast<size_t>(cp.curr - seg_->base()), std::memory_order_relaxed);
+                shared_.store(seg_, std::memory_order_release);
             }
         }
     };
 
-    arena::arena(size_t sz) : impl_(new arena::impl(sz))
+    arena::arena(size_t sz) : impl_(impl::create(arena_policy(sz)))
+    {
+    }
+
+    arena::arena(const arena_policy& policy) : impl_(impl::create(policy))
     {
     }
 
     arena::~arena()
     {
-        delete impl_;
+        impl::destroy(impl_);
+    }
+
+    arena* arena::create(const arena_policy& policy)
+    {
+        impl* i = impl::create(policy);
+        arena* a = new (i->alloc(align8(sizeof(arena)))) arena(i, hosted());
+        i->base_ = i->mark();
+        return a;
+    }
+
+    void arena::destroy(arena* a)
+    {
+        // the arena's memory goes with its first segment
+        impl::destroy(a->impl_);
+    }
+
+    void arena::reset()
+    {
+        impl_->rollback(impl_->base_);
+    }
+
+    arena::checkpoint arena::mark() const
+    {
+        return impl_->mark();
+    }
+
+    void arena::rollback(const arena::checkpoint& cp)
+    {
+        impl_->rollback(cp);
+    }
+
+    size_t arena::segment_count() const
+    {
+        size_t n = 0;
+        for (segment* s = impl_->seg_; s; s = s->fwd) {
+            ++n;
+        }
+        return n;
+    }
+
+    size_t arena::bytes_used() const
+    {
+        auto cp = impl_->mark();
+        size_t n = impl_->seg_->capacity() - cp.left;
+        for (segment* s = impl_->seg_->fwd; s; s = s->fwd) {
+            n += impl_->policy_.concurrent
+                 ? std::min(s->used.load(std::memory_order_relaxed), s->capacity())
+                 : s->capacity() - s->left;
+        }
+        return n;
+    }
+
+    void* arena::allocate(size_t sz)
+    {
+        return impl_->alloc(align8(sz));
     }
 
-    void* arena::allocate(size_t sz, arena::destroyfn fn)
+    void arena::add_destructor(void* obj, arena::destroyfn fn)
     {
-        sz = (sz + 7) & ~size_t(7); // align upto 8
-        size_t szneeded = sz + sizeof(header) + (fn ? sizeof(void*) : 0);
-        return impl_->allocate(szneeded, (void*)fn);
+        impl_->add_destructor(obj, fn);
     }
 
 }//namespace pcsh
@@ -0,0 +1,103 @@
+/**
+ * \file bytecode.hpp
+ * \date Oct 17, 2026
+ */
+
+#ifndef PCSH_EXECUTION_BYTECODE_HPP
+#define PCSH_EXECUTION_BYTECODE_HPP
+
+#include "pcsh/ir.hpp"
+#include "pcsh/result_type.hpp"
+#include "pcsh/types.hpp"
+
+#include "ir/nodes_fwd.hpp"
+#include "ir/symbol_table.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace pcsh {
+namespace execution {
+
+    //////////////////////////////////////////////////////////////////////////
+    /// opcode
+    //////////////////////////////////////////////////////////////////////////
+
+    // Operands `a', `b' and `c' are register indices unless noted.
+    // Registers [0, num_vars) hold the program variables, the rest are
+    // temporaries.
+    enum class opcode : byte
+    {
+        LOADK,      // r[a] = constants[b]
+        MOVE,       // r[a] = r[b]
+        CHECK,      // fail unless variable a is assigned
+        DEFINE,     // mark variable a as assigned
+        I2D,        // r[a] = double(r[b])
+        D2I,        // r[a] = int(r[b])
+        NEG_I,      // r[a] = -r[b]
+        NEG_D,
+        ADD_I,      // r[a] = r[b] op r[c]
+        ADD_D,
+        SUB_I,
+        SUB_D,
+        MUL_I,
+        MUL_D,
+        DIV_I,
+        DIV_D,
+        EQ_I,       // r[a] = (r[b] == r[c])
+        EQ_S,
+        JUMP,       // pc = a
+        JUMP_DEF,   // if variable a is assigned, pc = b
+        JUMP_Z_I,   // if r[a] is false, pc = b
+        JUMP_Z_D,
+        JUMP_Z_S,
+        FAIL,       // throw messages[a]
+        HALT
+    };
+
+    struct instruction
+    {
+        opcode op;
+        std::uint32_t a;
+        std::uint32_t b;
+        std::uint32_t c;
+    };
+
+    // registers share the representation of symbol table slots
+    using value = symbol_table::value;
+
+    //////////////////////////////////////////////////////////////////////////
+    /// program
+    //////////////////////////////////////////////////////////////////////////
+
+    struct program
+    {
+        /// variable slot, bound to the symbol table entry it was declared as
+        struct variable_slot
+        {
+            symbol_table::entry* entry;
+            const ir::variable* var;
+            result_type type;
+        };
+
+        std::vector<instruction> code;
+        std::vector<value> constants;
+        std::vector<std::string> messages;
+        std::vector<variable_slot> vars;
+        std::uint32_t num_registers;
+    };
+
+    /// translates a validated tree into bytecode
+    program compile(const ir::tree* ptree);
+
+    /// returns the program cached in the tree, compiling it on first use
+    const program* compiled_program(const ir::tree* ptree);
+
+    /// runs a compiled program and stores the variable values into the tree
+    void run(const program& prog);
+
+}//namespace execution
+}//namespace pcsh
+
+#endif/*PCSH_EXECUTION_BYTECODE_HPP*/
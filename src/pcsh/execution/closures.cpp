@@ -0,0 +1,1022 @@
+/**
+ * \file closures.cpp
+ * \date Oct 17, 2026
+ */
+
+#include "pcsh/assert.hpp"
+#include "pcsh/parser.hpp"
+
+#include "execution/closures.hpp"
+#include "ir/expression_walker.hpp"
+#include "ir/nodes.hpp"
+#include "ir/symbol_table.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+namespace pcsh {
+namespace execution {
+
+    using namespace ir;
+
+    union thunk
+    {
+        int (*int_fn)(const closure*);
+        double (*dbl_fn)(const closure*);
+        cstring (*str_fn)(const closure*);
+        // returns how many of the statements that follow to skip
+        std::uint32_t (*stmt_fn)(const closure*);
+    };
+
+    struct closure
+    {
+        thunk fn;
+        union {
+            const closure* a;               // left side, only operand or if condition
+            const variable* var;            // variables, to name them in errors
+        };
+        const closure* b;                   // right side or assigned value
+        union {
+            symbol_table::value k;          // constants, in the type of their context
+            symbol_table::entry* ent;       // variables and assignments
+            const closure* const* stmts;    // blocks
+        };
+        std::uint32_t count;                // statements of blocks and if bodies
+        node_kind kind;
+        result_type ty;                     // of the entry, or of the compared operands
+        bool deep;                          // `fn' is eval_deep()
+    };
+
+    namespace {
+
+        void throw_unassigned(const variable* v)
+        {
+            auto msg = std::string("Variable `") + v->name() + "' used before it is assigned a value!";
+            parser::throw_parser_exception(msg, "", "", "");
+        }
+
+        void throw_invalid_eq()
+        {
+            parser::throw_parser_exception("Invalid use of `=='. Return type of expression must be integer.", "", "", "");
+        }
+
+        template <class T>
+        using thunk_of = T (*)(const closure*);
+
+        template <class T>
+        inline T call(const closure* c);
+
+        template <>
+        inline int call<int>(const closure* c)
+        {
+            return c->fn.int_fn(c);
+        }
+
+        template <>
+        inline double call<double>(const closure* c)
+        {
+            return c->fn.dbl_fn(c);
+        }
+
+        template <>
+        inline cstring call<cstring>(const closure* c)
+        {
+            return c->fn.str_fn(c);
+        }
+
+        inline void set_fn(closure* c, thunk_of<int> f)
+        {
+            c->fn.int_fn = f;
+        }
+
+        inline void set_fn(closure* c, thunk_of<double> f)
+        {
+            c->fn.dbl_fn = f;
+        }
+
+        inline void set_fn(closure* c, thunk_of<cstring> f)
+        {
+            c->fn.str_fn = f;
+        }
+
+        inline void set_fn(closure* c, std::uint32_t (*f)(const closure*))
+        {
+            c->fn.stmt_fn = f;
+        }
+
+        // the member of a value holding a T
+        template <class T>
+        inline T& member(symbol_table::value& v);
+
+        template <>
+        inline int& member<int>(symbol_table::value& v)
+        {
+            return v.int_val;
+        }
+
+        template <>
+        inline double& member<double>(symbol_table::value& v)
+        {
+            return v.dbl_val;
+        }
+
+        template <>
+        inline cstring& member<cstring>(symbol_table::value& v)
+        {
+            return v.str_val;
+        }
+
+        template <class T>
+        inline T member(const symbol_table::value& v)
+        {
+            return member<T>(const_cast<symbol_table::value&>(v));
+        }
+
+        template <class T>
+        inline T pop(std::vector<T>& v)
+        {
+            auto x = v.back();
+            v.pop_back();
+            return x;
+        }
+
+        //////////////////////////////////////////////////////////////////////////
+        /// expression thunks
+        //////////////////////////////////////////////////////////////////////////
+
+        // How an operator reads an operand: by calling its closure, or in
+        // place for constants and for variables of the context type.
+        struct by_call
+        {
+            template <class T>
+            static inline T get(const closure* c)
+            {
+                return call<T>(c);
+            }
+        };
+
+        struct by_constant
+        {
+            template <class T>
+            static inline T get(const closure* c)
+            {
+                return member<T>(c->k);
+            }
+        };
+
+        struct by_variable
+        {
+            template <class T>
+            static inline T get(const closure* c)
+            {
+                if (!c->ent->evaluated) {
+                    throw_unassigned(c->var);
+                }
+                return member<T>(c->ent->val);
+            }
+        };
+
+        struct add_op
+        {
+            template <class T>
+            static inline T apply(T a, T b)
+            {
+                return a + b;
+            }
+        };
+
+        struct sub_op
+        {
+            template <class T>
+            static inline T apply(T a, T b)
+            {
+                return a - b;
+            }
+        };
+
+        struct mul_op
+        {
+            template <class T>
+            static inline T apply(T a, T b)
+            {
+                return a * b;
+            }
+        };
+
+        struct div_op
+        {
+            template <class T>
+            static inline T apply(T a, T b)
+            {
+                return a / b;
+            }
+        };
+
+        // comparisons are only computed as int
+        struct eq_op
+        {
+            template <class T>
+            static inline T apply(T a, T b)
+            {
+                return (a == b) ? 1 : 0;
+            }
+        };
+
+        template <class T>
+        T constant(const closure* c)
+        {
+            return member<T>(c->k);
+        }
+
+        // a variable holding a V, read as a T
+        template <class T, class V>
+        T read(const closure* c)
+        {
+            if (!c->ent->evaluated) {
+                throw_unassigned(c->var);
+            }
+            return static_cast<T>(member<V>(c->ent->val));
+        }
+
+        // a variable that no declaration was found for
+        template <class T>
+        T unassigned(const closure* c)
+        {
+            throw_unassigned(c->var);
+            return T();
+        }
+
+        // a comparison outside of an int expression
+        template <class T>
+        T invalid_eq(const closure* c)
+        {
+            throw_invalid_eq();
+            return T();
+        }
+
+        template <class T, class A>
+        T negate(const closure* c)
+        {
+            return -A::template get<T>(c->a);
+        }
+
+        template <class T, class Op, class L, class R>
+        T arith(const closure* c)
+        {
+            auto l = L::template get<T>(c->a);
+            return Op::apply(l, R::template get<T>(c->b));
+        }
+
+        int eq_string(const closure* c)
+        {
+            auto l = call<cstring>(c->a);
+            return (::strcmp(l, call<cstring>(c->b)) == 0) ? 1 : 0;
+        }
+
+        // an assignment inside an expression only takes effect if the
+        // variable, holding a V, has no value yet
+        template <class T, class V>
+        T assign_value(const closure* c)
+        {
+            auto ent = c->ent;
+            if (ent->evaluated) {
+                return static_cast<T>(member<V>(ent->val));
+            }
+            auto val = call<T>(c->b);
+            member<V>(ent->val) = static_cast<V>(val);
+            ent->evaluated = true;
+            return val;
+        }
+
+        // The fn of closures more than RECURSION_LIMIT levels above their
+        // deepest leaf. The operators of the deep spine wait on the heap and
+        // the shallow operands met on the way are called, so the call stack
+        // stays bounded whatever the depth of the expression.
+        template <class T>
+        T eval_deep(const closure* c)
+        {
+            struct frame
+            {
+                const closure* c;
+                bool right;         // right side still to compute
+            };
+            std::vector<frame> frames;
+            std::vector<T> lefts;
+            T val = T();
+            while (true) {
+                // down the left spine to a shallow operand or a value
+                while (true) {
+                    if (!c->deep) {
+                        val = call<T>(c);
+                        break;
+                    }
+                    if (c->kind == node_kind::UNARY_MINUS) {
+                        frames.push_back({ c, false });
+                        c = c->a;
+                    } else if (c->kind == node_kind::ASSIGN) {
+                        if (c->ent->evaluated) {
+                            val = symbol_table::read<T>(*c->ent);
+                            break;
+                        }
+                        frames.push_back({ c, false });
+                        c = c->b;
+                    } else if (c->kind == node_kind::COMP_EQUALS && c->ty == result_type::STRING) {
+                        val = static_cast<T>(eq_string(c));
+                        break;
+                    } else {
+                        frames.push_back({ c, true });
+                        c = c->a;
+                    }
+                }
+
+                // back up, applying operators until one needs its right side
+                while (true) {
+                    if (frames.empty()) {
+                        return val;
+                    }
+                    auto& f = frames.back();
+                    if (f.right) {
+                        f.right = false;
+                        lefts.push_back(val);
+                        c = f.c->b;
+                        break;
+                    }
+                    auto p = f.c;
+                    frames.pop_back();
+                    switch (p->kind) {
+                        case node_kind::UNARY_MINUS:
+                            val = -val;
+                            break;
+                        case node_kind::BINARY_DIV:
+                            val = pop(lefts) / val;
+                            break;
+                        case node_kind::BINARY_MINUS:
+                            val = pop(lefts) - val;
+                            break;
+                        case node_kind::BINARY_MULT:
+                            val = pop(lefts) * val;
+                            break;
+                        case node_kind::BINARY_PLUS:
+                            val = pop(lefts) + val;
+                            break;
+                        case node_kind::ASSIGN:
+                            symbol_table::store<T>(*p->ent, val);
+                            break;
+                        case node_kind::COMP_EQUALS:
+                            val = (pop(lefts) == val) ? 1 : 0;
+                            break;
+                        default:
+                            PCSH_ASSERT_MSG(false, "Invalid closure in a numeric expression.");
+                            break;
+                    }
+                }
+            }
+        }
+
+        // string expressions only nest through assignments, which are
+        // followed down and then stored back up
+        template <>
+        cstring eval_deep<cstring>(const closure* c)
+        {
+            std::vector<const closure*> pending;
+            while (c->deep && !c->ent->evaluated) {
+                pending.push_back(c);
+                c = c->b;
+            }
+            auto val = c->deep ? member<cstring>(c->ent->val) : call<cstring>(c);
+            while (!pending.empty()) {
+                symbol_table::store<cstring>(*pop(pending)->ent, val);
+            }
+            return val;
+        }
+
+        //////////////////////////////////////////////////////////////////////////
+        /// statement thunks
+        //////////////////////////////////////////////////////////////////////////
+
+        // a statement `x = ...' where x holds a V
+        template <class V, class R>
+        std::uint32_t assign_stmt(const closure* c)
+        {
+            auto val = R::template get<V>(c->b);
+            member<V>(c->ent->val) = val;
+            c->ent->evaluated = true;
+            return 0;
+        }
+
+        // the next assignment out of a cascade, copying the value of the
+        // previous one
+        template <class V>
+        std::uint32_t copy_stmt(const closure* c)
+        {
+            member<V>(c->ent->val) = member<V>(c->a->ent->val);
+            c->ent->evaluated = true;
+            return 0;
+        }
+
+        // nested statements are spliced into the block, so running it
+        // takes no native stack however deep they nest
+        std::uint32_t block_stmt(const closure* c)
+        {
+            auto s = c->stmts;
+            const auto end = s + c->count;
+            while (s != end) {
+                auto stmt = *s;
+                s += 1 + stmt->fn.stmt_fn(stmt);
+            }
+            return 0;
+        }
+
+        inline bool truth(int v)
+        {
+            return v != 0;
+        }
+
+        inline bool truth(double v)
+        {
+            return v != 0.0;
+        }
+
+        inline bool truth(cstring v)
+        {
+            return v[0] != '\0';
+        }
+
+        // the body follows, and is skipped if the condition is false
+        template <class C>
+        std::uint32_t if_stmt_fn(const closure* c)
+        {
+            return truth(call<C>(c->a)) ? 0 : c->count;
+        }
+
+        //////////////////////////////////////////////////////////////////////////
+        /// closure_builder
+        //////////////////////////////////////////////////////////////////////////
+
+        // Statements are built into one list, an if statement followed by
+        // its body, with the blocks and if statements being built kept on a
+        // stack; expressions with an expression_walker. Every operand is
+        // computed in the type of the enclosing statement, `ctx_', except
+        // those of comparisons, as in typed_interpreter<T>.
+        class closure_builder
+        {
+            friend class ir::expression_walker;
+          public:
+            closure_builder(arena& ar)
+              : arena_(ar), tables_(), walker_(), contexts_(), ctx_(result_type::UNDETERMINED), ints_(), doubles_(), reads_()
+            { }
+
+            const closure* build_block(const block* v)
+            {
+                std::vector<const closure*> body;
+                std::vector<frame> frames;
+                const node* n = v;
+                while (n) {
+                    switch (n->kind()) {
+                        case node_kind::ASSIGN:
+                            assignment(static_cast<const assign*>(n), body);
+                            break;
+                        case node_kind::BLOCK:
+                            tables_.push_back(&(static_cast<const block*>(n)->table()));
+                            frames.push_back({ n, 0, nullptr });
+                            break;
+                        case node_kind::IF_STMT: {
+                            auto c = conditional(static_cast<const if_stmt*>(n));
+                            if (c) {
+                                body.push_back(c);
+                                frames.push_back({ n, body.size(), c });
+                            }
+                            break;
+                        }
+                        default:
+                            // bare expressions have no effect
+                            break;
+                    }
+
+                    // the next statement, leaving what has none left
+                    n = nullptr;
+                    while (!n && !frames.empty()) {
+                        auto& f = frames.back();
+                        if (f.n->kind() == node_kind::BLOCK) {
+                            auto b = static_cast<const block*>(f.n);
+                            if (f.next != b->statement_count()) {
+                                n = b->statement(f.next++);
+                            } else {
+                                frames.pop_back();
+                                tables_.pop_back();
+                            }
+                        } else if (f.c->count == NOT_BUILT) {
+                            f.c->count = 0;
+                            n = static_cast<const if_stmt*>(f.n)->body();
+                        } else {
+                            f.c->count = static_cast<std::uint32_t>(body.size() - f.next);
+                            frames.pop_back();
+                        }
+                    }
+                }
+                return make_block(body);
+            }
+          private:
+            // a block or if statement being built
+            struct frame
+            {
+                const node* n;
+                size_t next;        // statement of a block, or where an if body starts
+                closure* c;         // of an if statement
+            };
+
+            // the statement count of an if statement whose body is not built yet
+            static const std::uint32_t NOT_BUILT = ~std::uint32_t(0);
+
+            // a closure, and the height of its expression
+            struct built
+            {
+                closure* c;
+                std::uint32_t height;
+            };
+
+            typedef built result;
+
+            enum shape
+            {
+                BY_CALL,
+                BY_CONSTANT,
+                BY_VARIABLE
+            };
+
+            arena& arena_;
+            scope_stack tables_;
+            expression_walker walker_;
+            // contexts of the comparisons being built
+            std::vector<result_type> contexts_;
+            result_type ctx_;
+            // leaves are shared: one closure per constant value, and per
+            // variable read in each type
+            std::unordered_map<int, closure*> ints_;
+            std::unordered_map<std::uint64_t, closure*> doubles_;
+            std::unordered_map<const symbol_table::entry*, closure*> reads_[3];
+
+            closure* make(node_kind kind)
+            {
+                auto c = arena_.create<closure>();
+                c->kind = kind;
+                return c;
+            }
+
+            const closure* make_block(const std::vector<const closure*>& body)
+            {
+                auto c = make(node_kind::BLOCK);
+                auto stmts = arena_.create_array<const closure*>(std::max<size_t>(body.size(), 1));
+                std::copy(body.begin(), body.end(), stmts);
+                c->stmts = stmts;
+                c->count = static_cast<std::uint32_t>(body.size());
+                set_fn(c, &block_stmt);
+                return c;
+            }
+
+            symbol_table::entry* entry_of(const variable* v) const
+            {
+                return variable_accessor(tables_).find(v);
+            }
+
+            //////////////////////////////////////////////////////////////////////////
+            /// statements
+            //////////////////////////////////////////////////////////////////////////
+
+            void assignment(const assign* v, std::vector<const closure*>& out)
+            {
+                // cascading assignment operators: the innermost one is
+                // computed and its value is copied outwards
+                std::vector<const assign*> chain;
+                while (v->right()->kind() == node_kind::ASSIGN) {
+                    chain.push_back(v);
+                    v = static_cast<const assign*>(v->right());
+                }
+
+                auto ent = entry_of(v->var());
+                PCSH_ASSERT_MSG(ent, "Assignment to an undeclared variable.");
+                auto c = make(node_kind::ASSIGN);
+                c->ent = ent;
+                c->ty = ent->type;
+                switch (ent->type) {
+                    case result_type::INTEGER:
+                        assign_of<int>(c, v);
+                        break;
+                    case result_type::FLOATING:
+                        assign_of<double>(c, v);
+                        break;
+                    case result_type::STRING:
+                        assign_of<cstring>(c, v);
+                        break;
+                    default:
+                        PCSH_ENFORCE_MSG(false, "Incomplete implementation for evaluate!");
+                        break;
+                }
+                out.push_back(c);
+
+                while (!chain.empty()) {
+                    auto from = c;
+                    c = make(node_kind::ASSIGN);
+                    c->ent = entry_of(pop(chain)->var());
+                    PCSH_ASSERT_MSG(c->ent, "Assignment to an undeclared variable.");
+                    PCSH_ASSERT_MSG(c->ent->type == from->ty, "Cascading assignment changes type.");
+                    c->ty = from->ty;
+                    c->a = from;
+                    switch (from->ty) {
+                        case result_type::INTEGER:
+                            set_fn(c, &copy_stmt<int>);
+                            break;
+                        case result_type::FLOATING:
+                            set_fn(c, &copy_stmt<double>);
+                            break;
+                        default:
+                            set_fn(c, &copy_stmt<cstring>);
+                            break;
+                    }
+                    out.push_back(c);
+                }
+            }
+
+            template <class V>
+            void assign_of(closure* c, const assign* v)
+            {
+                c->b = expr(v->right(), c->ty);
+                switch (shape_of(c->b, c->ty)) {
+                    case BY_CONSTANT:
+                        set_fn(c, &assign_stmt<V, by_constant>);
+                        break;
+                    case BY_VARIABLE:
+                        set_fn(c, &assign_stmt<V, by_variable>);
+                        break;
+                    default:
+                        set_fn(c, &assign_stmt<V, by_call>);
+                        break;
+                }
+            }
+
+            // the closure of `v' without its body, or nullptr if it can
+            // never run
+            closure* conditional(const if_stmt* v)
+            {
+                auto c = make(node_kind::IF_STMT);
+                switch (v->condition_type()) {
+                    case result_type::INTEGER:
+                        set_fn(c, &if_stmt_fn<int>);
+                        break;
+                    case result_type::FLOATING:
+                        set_fn(c, &if_stmt_fn<double>);
+                        break;
+                    case result_type::STRING:
+                        set_fn(c, &if_stmt_fn<cstring>);
+                        break;
+                    default:
+                        PCSH_ASSERT_MSG(false, "Unknown condition type evaluation in if statement.");
+                        return nullptr;
+                }
+                c->a = expr(v->condition(), v->condition_type());
+                c->count = NOT_BUILT;
+                return c;
+            }
+
+            //////////////////////////////////////////////////////////////////////////
+            /// expressions
+            //////////////////////////////////////////////////////////////////////////
+
+            closure* expr(const node* n, result_type ty)
+            {
+                ctx_ = ty;
+                return walker_.walk(n, *this).c;
+            }
+
+            // how a parent computing a `ty' can read `c'
+            static shape shape_of(const closure* c, result_type ty)
+            {
+                switch (c->kind) {
+                    case node_kind::INT_CONSTANT:
+                    case node_kind::FLOAT_CONSTANT:
+                    case node_kind::STRING_CONSTANT:
+                        return BY_CONSTANT;
+                    case node_kind::VARIABLE:
+                        return (c->ent && (c->ty == ty)) ? BY_VARIABLE : BY_CALL;
+                    default:
+                        return BY_CALL;
+                }
+            }
+
+            template <class T, class Op, class L>
+            static thunk_of<T> pick(shape r)
+            {
+                switch (r) {
+                    case BY_CONSTANT:
+                        return &arith<T, Op, L, by_constant>;
+                    case BY_VARIABLE:
+                        return &arith<T, Op, L, by_variable>;
+                    default:
+                        return &arith<T, Op, L, by_call>;
+                }
+            }
+
+            // the arithmetic thunk for the shapes of both operands
+            template <class T, class Op>
+            static thunk_of<T> pick(shape l, shape r)
+            {
+                switch (l) {
+                    case BY_CONSTANT:
+                        return pick<T, Op, by_constant>(r);
+                    case BY_VARIABLE:
+                        return pick<T, Op, by_variable>(r);
+                    default:
+                        return pick<T, Op, by_call>(r);
+                }
+            }
+
+            template <class T>
+            static thunk_of<T> pick_negate(shape a)
+            {
+                switch (a) {
+                    case BY_CONSTANT:
+                        return &negate<T, by_constant>;
+                    case BY_VARIABLE:
+                        return &negate<T, by_variable>;
+                    default:
+                        return &negate<T, by_call>;
+                }
+            }
+
+            template <class Op>
+            void set_arith(closure* c)
+            {
+                auto l = shape_of(c->a, ctx_);
+                auto r = shape_of(c->b, ctx_);
+                switch (ctx_) {
+                    case result_type::INTEGER:
+                        set_fn(c, pick<int, Op>(l, r));
+                        break;
+                    case result_type::FLOATING:
+                        set_fn(c, pick<double, Op>(l, r));
+                        break;
+                    default:
+                        PCSH_ASSERT_MSG(false, "Arithmetic on non numeric type.");
+                        break;
+                }
+            }
+
+            // closures more than RECURSION_LIMIT levels high are run by
+            // eval_deep()
+            built finish(closure* c, std::uint32_t height)
+            {
+                if (height > expression_walker::RECURSION_LIMIT) {
+                    c->deep = true;
+                    switch (ctx_) {
+                        case result_type::INTEGER:
+                            set_fn(c, &eval_deep<int>);
+                            break;
+                        case result_type::FLOATING:
+                            set_fn(c, &eval_deep<double>);
+                            break;
+                        default:
+                            set_fn(c, &eval_deep<cstring>);
+                            break;
+                    }
+                }
+                built b = { c, height };
+                return b;
+            }
+
+            bool enter(const node* n)
+            {
+                if (n->kind() != node_kind::COMP_EQUALS) {
+                    return true;
+                }
+                if (ctx_ != result_type::INTEGER) {
+                    // fails at run time
+                    return false;
+                }
+                switch (static_cast<const comp_equals*>(n)->comp_type()) {
+                    case result_type::STRING:
+                        contexts_.push_back(ctx_);
+                        ctx_ = result_type::STRING;
+                        return true;
+                    case result_type::INTEGER:
+                    case result_type::FLOATING:
+                        // floating point comparisons are made on truncated
+                        // values, so the operands are computed as int
+                        contexts_.push_back(ctx_);
+                        ctx_ = result_type::INTEGER;
+                        return true;
+                    default:
+                        PCSH_ASSERT_MSG(false, "Invalid comparison type");
+                        return false;
+                }
+            }
+
+            built leaf(const node* n)
+            {
+                closure* c = nullptr;
+                switch (n->kind()) {
+                    case node_kind::VARIABLE:
+                        c = variable_of(static_cast<const variable*>(n));
+                        break;
+                    case node_kind::INT_CONSTANT:
+                        c = constant_of(node_kind::INT_CONSTANT, static_cast<const int_constant*>(n)->value());
+                        break;
+                    case node_kind::FLOAT_CONSTANT:
+                        c = constant_of(node_kind::FLOAT_CONSTANT, static_cast<const float_constant*>(n)->value());
+                        break;
+                    case node_kind::STRING_CONSTANT:
+                        c = make(node_kind::STRING_CONSTANT);
+                        c->k.str_val = static_cast<const string_constant*>(n)->value();
+                        set_fn(c, &constant<cstring>);
+                        break;
+                    case node_kind::COMP_EQUALS:
+                        // not entered
+                        if (ctx_ == result_type::INTEGER) {
+                            c = constant_of(node_kind::INT_CONSTANT, 0);
+                            break;
+                        }
+                        c = make(node_kind::COMP_EQUALS);
+                        if (ctx_ == result_type::FLOATING) {
+                            set_fn(c, &invalid_eq<double>);
+                        } else {
+                            set_fn(c, &invalid_eq<cstring>);
+                        }
+                        break;
+                    default:
+                        PCSH_ASSERT_MSG(false, "Statement used as an expression.");
+                        c = constant_of(node_kind::INT_CONSTANT, 0);
+                        break;
+                }
+                built b = { c, 1 };
+                return b;
+            }
+
+            closure* constant_of(node_kind kind, double val)
+            {
+                if (ctx_ == result_type::FLOATING) {
+                    // keyed by representation, to tell 0.0 from -0.0
+                    std::uint64_t bits;
+                    std::memcpy(&bits, &val, sizeof(bits));
+                    auto& c = doubles_[bits];
+                    if (!c) {
+                        c = make(kind);
+                        c->k.dbl_val = val;
+                        set_fn(c, &constant<double>);
+                    }
+                    return c;
+                }
+                auto& c = ints_[static_cast<int>(val)];
+                if (!c) {
+                    c = make(kind);
+                    c->k.int_val = static_cast<int>(val);
+                    set_fn(c, &constant<int>);
+                }
+                return c;
+            }
+
+            closure* variable_of(const variable* v)
+            {
+                if (!v->resolved()) {
+                    auto c = make(node_kind::VARIABLE);
+                    c->var = v;
+                    switch (ctx_) {
+                        case result_type::INTEGER:
+                            set_fn(c, &unassigned<int>);
+                            break;
+                        case result_type::FLOATING:
+                            set_fn(c, &unassigned<double>);
+                            break;
+                        default:
+                            set_fn(c, &unassigned<cstring>);
+                            break;
+                    }
+                    return c;
+                }
+                auto ent = &symbol_table::at(*tables_[v->depth()], v->slot());
+                auto& c = reads_[(ctx_ == result_type::INTEGER) ? 0 : (ctx_ == result_type::FLOATING) ? 1 : 2][ent];
+                if (c) {
+                    return c;
+                }
+                c = make(node_kind::VARIABLE);
+                c->var = v;
+                c->ent = ent;
+                c->ty = ent->type;
+                switch (ctx_) {
+                    case result_type::INTEGER:
+                        set_fn(c, (c->ty == result_type::FLOATING) ? &read<int, double> : &read<int, int>);
+                        break;
+                    case result_type::FLOATING:
+                        set_fn(c, (c->ty == result_type::FLOATING) ? &read<double, double> : &read<double, int>);
+                        break;
+                    default:
+                        PCSH_ASSERT_MSG(c->ty == result_type::STRING, "String read of a non string variable.");
+                        set_fn(c, &read<cstring, cstring>);
+                        break;
+                }
+                return c;
+            }
+
+            built unary(const node* n, const built& operand)
+            {
+                switch (n->kind()) {
+                    case node_kind::UNARY_MINUS: {
+                        auto c = make(node_kind::UNARY_MINUS);
+                        c->a = operand.c;
+                        auto a = shape_of(c->a, ctx_);
+                        if (ctx_ == result_type::FLOATING) {
+                            set_fn(c, pick_negate<double>(a));
+                        } else {
+                            set_fn(c, pick_negate<int>(a));
+                        }
+                        return finish(c, operand.height + 1);
+                    }
+                    case node_kind::ASSIGN: {
+                        auto v = static_cast<const assign*>(n);
+                        if (!v->var()->resolved()) {
+                            // assigned in an if condition, which declares
+                            // nothing: the value is stored nowhere
+                            return operand;
+                        }
+                        auto c = make(node_kind::ASSIGN);
+                        c->ent = entry_of(v->var());
+                        c->ty = c->ent->type;
+                        c->b = operand.c;
+                        switch (ctx_) {
+                            case result_type::INTEGER:
+                                set_fn(c, (c->ty == result_type::FLOATING) ? &assign_value<int, double> : &assign_value<int, int>);
+                                break;
+                            case result_type::FLOATING:
+                                set_fn(c, (c->ty == result_type::FLOATING) ? &assign_value<double, double> : &assign_value<double, int>);
+                                break;
+                            default:
+                                set_fn(c, &assign_value<cstring, cstring>);
+                                break;
+                        }
+                        return finish(c, operand.height + 1);
+                    }
+                    default:
+                        // unary plus leaves its operand as it is
+                        return operand;
+                }
+            }
+
+            built binary(const node* n, const built& l, const built& r)
+            {
+                auto c = make(n->kind());
+                c->a = l.c;
+                c->b = r.c;
+                switch (n->kind()) {
+                    case node_kind::BINARY_DIV:
+                        set_arith<div_op>(c);
+                        break;
+                    case node_kind::BINARY_MINUS:
+                        set_arith<sub_op>(c);
+                        break;
+                    case node_kind::BINARY_MULT:
+                        set_arith<mul_op>(c);
+                        break;
+                    case node_kind::BINARY_PLUS:
+                        set_arith<add_op>(c);
+                        break;
+                    default:
+                        // comparisons yield an int
+                        c->ty = ctx_;
+                        if (ctx_ == result_type::STRING) {
+                            set_fn(c, &eq_string);
+                        } else {
+                            set_fn(c, pick<int, eq_op>(shape_of(c->a, ctx_), shape_of(c->b, ctx_)));
+                        }
+                        ctx_ = pop(contexts_);
+                        break;
+                }
+                return finish(c, std::max(l.height, r.height) + 1);
+            }
+        };
+
+    }//namespace
+
+    closure_program compile_closures(const tree* ptree)
+    {
+        closure_builder builder(ptree->get_arena());
+        closure_program prog;
+        prog.root = builder.build_block(static_cast<const block*>(ptree->root()));
+        return prog;
+    }
+
+    const closure_program* compiled_closures(const tree* ptree)
+    {
+        if (!ptree->closures()) {
+            auto p = ptree->get_arena().create<closure_program>(compile_closures(ptree));
+            ptree->set_closures(p);
+        }
+        return ptree->closures();
+    }
+
+    void run(const closure_program& prog)
+    {
+        prog.root->fn.stmt_fn(prog.root);
+    }
+
+}//namespace execution
+}//namespace pcsh
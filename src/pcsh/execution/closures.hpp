@@ -0,0 +1,41 @@
+/**
+ * \file closures.hpp
+ * \date Oct 17, 2026
+ */
+
+#ifndef PCSH_EXECUTION_CLOSURES_HPP
+#define PCSH_EXECUTION_CLOSURES_HPP
+
+#include "pcsh/ir.hpp"
+
+namespace pcsh {
+namespace execution {
+
+    struct closure;
+
+    //////////////////////////////////////////////////////////////////////////
+    /// closure_program
+    //////////////////////////////////////////////////////////////////////////
+
+    /// A tree turned into one closure per node with an effect. Each closure
+    /// is a function pointer chosen for the types the type checker settled,
+    /// bound to the symbol table entries it reads and writes, and calls its
+    /// operands directly. Lives in the tree's arena.
+    struct closure_program
+    {
+        const closure* root;
+    };
+
+    /// builds the closures of a validated tree
+    closure_program compile_closures(const ir::tree* ptree);
+
+    /// returns the closures cached in the tree, building them on first use
+    const closure_program* compiled_closures(const ir::tree* ptree);
+
+    /// runs the closures, with the semantics of interpreter
+    void run(const closure_program& prog);
+
+}//namespace execution
+}//namespace pcsh
+
+#endif/*PCSH_EXECUTION_CLOSURES_HPP*/
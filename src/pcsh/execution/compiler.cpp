@@ -0,0 +1,627 @@
+/**
+ * \file compiler.cpp
+ * \date Oct 17, 2026
+ */
+
+#include "pcsh/assert.hpp"
+
+#include "execution/bytecode.hpp"
+#include "ir/expression_walker.hpp"
+#include "ir/nodes.hpp"
+#include "ir/symbol_table.hpp"
+
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+namespace pcsh {
+namespace execution {
+
+    using namespace ir;
+
+    namespace {
+
+        const std::uint32_t NO_REGISTER = std::numeric_limits<std::uint32_t>::max();
+
+        cstring const INVALID_EQ_USE = "Invalid use of `=='. Return type of expression must be integer.";
+
+        //////////////////////////////////////////////////////////////////////////
+        /// emitter : shared code generation state
+        //////////////////////////////////////////////////////////////////////////
+
+        class emitter
+        {
+          public:
+            emitter(program& p) : prog_(p), bases_(), tables_(), num_temps_(0), max_temps_(0)
+            { }
+
+            inline std::uint32_t emit(opcode op, std::uint32_t a = 0, std::uint32_t b = 0, std::uint32_t c = 0)
+            {
+                prog_.code.push_back({ op, a, b, c });
+                return static_cast<std::uint32_t>(prog_.code.size() - 1);
+            }
+
+            inline std::uint32_t here() const
+            {
+                return static_cast<std::uint32_t>(prog_.code.size());
+            }
+
+            inline instruction& at(std::uint32_t pc)
+            {
+                return prog_.code[pc];
+            }
+
+            std::uint32_t constant(value v)
+            {
+                prog_.constants.push_back(v);
+                return static_cast<std::uint32_t>(prog_.constants.size() - 1);
+            }
+
+            std::uint32_t message(const std::string& msg)
+            {
+                prog_.messages.push_back(msg);
+                return static_cast<std::uint32_t>(prog_.messages.size() - 1);
+            }
+
+            void fail(const std::string& msg)
+            {
+                emit(opcode::FAIL, message(msg));
+            }
+
+            inline std::uint32_t temp()
+            {
+                auto r = static_cast<std::uint32_t>(prog_.vars.size()) + num_temps_++;
+                max_temps_ = std::max(max_temps_, num_temps_);
+                return r;
+            }
+
+            inline std::uint32_t temp_mark() const
+            {
+                return num_temps_;
+            }
+
+            inline void release_temps(std::uint32_t mark)
+            {
+                num_temps_ = mark;
+            }
+
+            inline std::uint32_t max_temps() const
+            {
+                return max_temps_;
+            }
+
+            inline void push_scope(const block* v)
+            {
+                tables_.push_back(&(v->table()));
+            }
+
+            inline void pop_scope()
+            {
+                tables_.pop_back();
+            }
+
+            // gives the entries of a table consecutive registers, in slot order
+            void declare(const symbol_table::ptr* tbl, const std::vector<symbol_table::name_and_type>& entries)
+            {
+                bases_[tbl] = static_cast<std::uint32_t>(prog_.vars.size());
+                for (const auto& el : entries) {
+                    prog_.vars.push_back({ nullptr, nullptr, el.type });
+                }
+            }
+
+            // maps the (depth, slot) bound by type_checker to a register
+            std::uint32_t resolve(const variable* v)
+            {
+                if (!v->resolved()) {
+                    return NO_REGISTER;
+                }
+                PCSH_ASSERT_MSG(v->depth() < tables_.size(), "Variable resolved outside of its scope.");
+                const auto& tbl = *tables_[v->depth()];
+                auto reg = bases_[&tbl] + v->slot();
+                if (!prog_.vars[reg].var) {
+                    prog_.vars[reg].var = v;
+                    prog_.vars[reg].entry = &symbol_table::at(tbl, v->slot());
+                }
+                return reg;
+            }
+
+            inline result_type type_of(std::uint32_t slot) const
+            {
+                return prog_.vars[slot].type;
+            }
+
+            // r[dst] = convert(r[src]) from type `from' to type `to'
+            void convert(std::uint32_t dst, result_type to, std::uint32_t src, result_type from)
+            {
+                if (to == from) {
+                    if (dst != src) {
+                        emit(opcode::MOVE, dst, src);
+                    }
+                } else if (to == result_type::FLOATING && from == result_type::INTEGER) {
+                    emit(opcode::I2D, dst, src);
+                } else if (to == result_type::INTEGER && from == result_type::FLOATING) {
+                    emit(opcode::D2I, dst, src);
+                } else {
+                    PCSH_ASSERT_MSG(false, "Invalid conversion between value types.");
+                }
+            }
+
+          private:
+            program& prog_;
+            std::unordered_map<const symbol_table::ptr*, std::uint32_t> bases_;
+            scope_stack tables_;
+            std::uint32_t num_temps_;
+            std::uint32_t max_temps_;
+        };
+
+        //////////////////////////////////////////////////////////////////////////
+        /// slot_allocator : gives every declared variable a register
+        //////////////////////////////////////////////////////////////////////////
+
+        class slot_allocator final : public node_visitor
+        {
+          public:
+            slot_allocator(emitter& e) : emit_(e)
+            { }
+          private:
+            emitter& emit_;
+
+            void enter_block(const block* v) override
+            {
+                const auto& tbl = v->table();
+                emit_.declare(&tbl, symbol_table::all_entries(tbl));
+            }
+        };
+
+        //////////////////////////////////////////////////////////////////////////
+        /// expr_compiler : compiles an expression evaluated as a given type
+        //////////////////////////////////////////////////////////////////////////
+
+        // Mirrors typed_interpreter<T>: every operand is computed in the type
+        // of the enclosing statement, and assignments nested in an expression
+        // only take effect if the variable has no value yet.
+        //
+        // Expressions are compiled with an expression_walker. `ty_' and `dst_'
+        // are the type and destination asked of the node being entered; an
+        // operator saves its own in a frame while its operands are compiled,
+        // and is handed the registers holding them.
+        class expr_compiler
+        {
+            friend class ir::expression_walker;
+          public:
+            expr_compiler(emitter& e)
+              : emit_(e), walker_(), frames_(), ty_(result_type::UNDETERMINED), dst_(NO_REGISTER), skipped_(NO_REGISTER)
+            { }
+
+            // returns the register holding the result; writes to `dst' if one is given
+            std::uint32_t compile(const node* n, result_type ty, std::uint32_t dst = NO_REGISTER)
+            {
+                ty_ = ty;
+                dst_ = dst;
+                return walker_.walk(n, *this);
+            }
+          private:
+            typedef std::uint32_t result;
+
+            struct frame
+            {
+                result_type ty;
+                std::uint32_t dst;
+                std::uint32_t mark;     // temporaries in use before the operands
+                std::uint32_t out;      // assignments and comparisons
+                std::uint32_t slot;     // assignments
+                std::uint32_t skip;     // assignments
+            };
+
+            emitter& emit_;
+            expression_walker walker_;
+            std::vector<frame> frames_;
+            result_type ty_;
+            std::uint32_t dst_;
+            std::uint32_t skipped_;     // result of a comparison not compiled
+
+            inline std::uint32_t output()
+            {
+                return (dst_ != NO_REGISTER) ? dst_ : emit_.temp();
+            }
+
+            // saves the context of `n' and asks its operands for a temporary
+            // of type `ty'
+            void push_frame(result_type ty, std::uint32_t out = NO_REGISTER, std::uint32_t slot = NO_REGISTER, std::uint32_t skip = 0)
+            {
+                frames_.push_back({ ty_, dst_, emit_.temp_mark(), out, slot, skip });
+                ty_ = ty;
+                dst_ = NO_REGISTER;
+            }
+
+            // restores the context of the node being left; its sibling, if
+            // any, is compiled in the same one
+            frame pop_frame()
+            {
+                auto f = frames_.back();
+                frames_.pop_back();
+                ty_ = f.ty;
+                dst_ = f.dst;
+                return f;
+            }
+
+            std::uint32_t load_constant(value v)
+            {
+                auto reg = output();
+                emit_.emit(opcode::LOADK, reg, emit_.constant(v));
+                return reg;
+            }
+
+            std::uint32_t read(std::uint32_t slot, std::uint32_t out)
+            {
+                auto vty = emit_.type_of(slot);
+                if ((vty == ty_) && (out == NO_REGISTER)) {
+                    return slot;
+                }
+                auto reg = (out != NO_REGISTER) ? out : emit_.temp();
+                emit_.convert(reg, ty_, slot, vty);
+                return reg;
+            }
+
+            bool enter(const node* n)
+            {
+                switch (n->kind()) {
+                    case node_kind::UNARY_MINUS:
+                    case node_kind::BINARY_DIV:
+                    case node_kind::BINARY_MINUS:
+                    case node_kind::BINARY_MULT:
+                    case node_kind::BINARY_PLUS:
+                        push_frame(ty_);
+                        return true;
+                    case node_kind::ASSIGN:
+                        return enter_assign(static_cast<const assign*>(n));
+                    case node_kind::COMP_EQUALS:
+                        return enter_comparison(static_cast<const comp_equals*>(n));
+                    case node_kind::BLOCK:
+                        PCSH_ASSERT_MSG(false, "Block used as an expression.");
+                        return false;
+                    case node_kind::IF_STMT:
+                        PCSH_ASSERT_MSG(false, "If statement used as an expression.");
+                        return false;
+                    default:
+                        // leaves, and unary plus which passes its context on
+                        return true;
+                }
+            }
+
+            std::uint32_t leaf(const node* n)
+            {
+                switch (n->kind()) {
+                    case node_kind::VARIABLE:
+                        return compile_variable(static_cast<const variable*>(n));
+                    case node_kind::INT_CONSTANT: {
+                        auto c = static_cast<const int_constant*>(n)->value();
+                        value val;
+                        if (ty_ == result_type::FLOATING) {
+                            val.dbl_val = static_cast<double>(c);
+                        } else {
+                            val.int_val = c;
+                        }
+                        return load_constant(val);
+                    }
+                    case node_kind::FLOAT_CONSTANT: {
+                        auto c = static_cast<const float_constant*>(n)->value();
+                        value val;
+                        if (ty_ == result_type::INTEGER) {
+                            val.int_val = static_cast<int>(c);
+                        } else {
+                            val.dbl_val = c;
+                        }
+                        return load_constant(val);
+                    }
+                    case node_kind::STRING_CONSTANT: {
+                        value val;
+                        val.str_val = static_cast<const string_constant*>(n)->value();
+                        return load_constant(val);
+                    }
+                    case node_kind::COMP_EQUALS:
+                        return skipped_;
+                    default:
+                        return NO_REGISTER;
+                }
+            }
+
+            std::uint32_t unary(const node* n, std::uint32_t o)
+            {
+                switch (n->kind()) {
+                    case node_kind::UNARY_MINUS: {
+                        auto f = pop_frame();
+                        emit_.release_temps(f.mark);
+                        auto reg = output();
+                        emit_.emit((ty_ == result_type::INTEGER) ? opcode::NEG_I : opcode::NEG_D, reg, o);
+                        return reg;
+                    }
+                    case node_kind::ASSIGN:
+                        if (!static_cast<const assign*>(n)->var()->resolved()) {
+                            return o;
+                        }
+                        return leave_assign(o);
+                    default:
+                        return o;
+                }
+            }
+
+            std::uint32_t binary(const node* n, std::uint32_t l, std::uint32_t r)
+            {
+                switch (n->kind()) {
+                    case node_kind::BINARY_DIV:
+                        return arith<opcode::DIV_I, opcode::DIV_D>(l, r);
+                    case node_kind::BINARY_MINUS:
+                        return arith<opcode::SUB_I, opcode::SUB_D>(l, r);
+                    case node_kind::BINARY_MULT:
+                        return arith<opcode::MUL_I, opcode::MUL_D>(l, r);
+                    case node_kind::BINARY_PLUS:
+                        return arith<opcode::ADD_I, opcode::ADD_D>(l, r);
+                    default:
+                        return leave_comparison(static_cast<const comp_equals*>(n), l, r);
+                }
+            }
+
+            template <opcode INT_OP, opcode DBL_OP>
+            std::uint32_t arith(std::uint32_t l, std::uint32_t r)
+            {
+                auto f = pop_frame();
+                emit_.release_temps(f.mark);
+                auto reg = output();
+                switch (ty_) {
+                    case result_type::INTEGER:
+                        emit_.emit(INT_OP, reg, l, r);
+                        break;
+                    case result_type::FLOATING:
+                        emit_.emit(DBL_OP, reg, l, r);
+                        break;
+                    default:
+                        PCSH_ASSERT_MSG(false, "Arithmetic on non numeric type.");
+                        break;
+                }
+                return reg;
+            }
+
+            std::uint32_t compile_variable(const variable* v)
+            {
+                auto slot = emit_.resolve(v);
+                if (slot == NO_REGISTER) {
+                    emit_.fail(std::string("Variable `") + v->name() + "' used before it is assigned a value!");
+                    return output();
+                }
+                emit_.emit(opcode::CHECK, slot);
+                return read(slot, dst_);
+            }
+
+            bool enter_assign(const assign* v)
+            {
+                if (!v->var()->resolved()) {
+                    // assigned in an if condition, which declares nothing:
+                    // compiled as its right side, like unary plus
+                    return true;
+                }
+                auto out = output();
+                auto slot = emit_.resolve(v->var());
+                // first assignment: store the value, and yield it unconverted
+                auto skip = emit_.emit(opcode::JUMP_DEF, slot);
+                push_frame(ty_, out, slot, skip);
+                return true;
+            }
+
+            std::uint32_t leave_assign(std::uint32_t r)
+            {
+                auto f = pop_frame();
+                emit_.convert(f.slot, emit_.type_of(f.slot), r, ty_);
+                emit_.emit(opcode::DEFINE, f.slot);
+                if (r != f.out) {
+                    emit_.emit(opcode::MOVE, f.out, r);
+                }
+                emit_.release_temps(f.mark);
+                auto done = emit_.emit(opcode::JUMP);
+                emit_.at(f.skip).b = emit_.here();
+                read(f.slot, f.out);
+                emit_.at(done).a = emit_.here();
+                return f.out;
+            }
+
+            bool enter_comparison(const comp_equals* v)
+            {
+                auto out = output();
+                if (ty_ != result_type::INTEGER) {
+                    emit_.fail(INVALID_EQ_USE);
+                    skipped_ = out;
+                    return false;
+                }
+                switch (v->comp_type()) {
+                    case result_type::STRING:
+                        push_frame(result_type::STRING, out);
+                        return true;
+                    case result_type::INTEGER:
+                    case result_type::FLOATING:
+                        // floating point comparisons are made on truncated values
+                        push_frame(result_type::INTEGER, out);
+                        return true;
+                    default: {
+                        PCSH_ASSERT_MSG(false, "Invalid comparison type");
+                        value zero;
+                        zero.int_val = 0;
+                        emit_.emit(opcode::LOADK, out, emit_.constant(zero));
+                        skipped_ = out;
+                        return false;
+                    }
+                }
+            }
+
+            std::uint32_t leave_comparison(const comp_equals* v, std::uint32_t l, std::uint32_t r)
+            {
+                auto f = pop_frame();
+                auto op = (v->comp_type() == result_type::STRING) ? opcode::EQ_S : opcode::EQ_I;
+                emit_.emit(op, f.out, l, r);
+                emit_.release_temps(f.mark);
+                return f.out;
+            }
+        };
+
+        //////////////////////////////////////////////////////////////////////////
+        /// stmt_compiler
+        //////////////////////////////////////////////////////////////////////////
+
+        // Mirrors interpreter: only assignments, blocks and if statements have
+        // an effect when used as statements.
+        class stmt_compiler final : public node_visitor
+        {
+          public:
+            stmt_compiler(emitter& e) : emit_(e), expr_(e), chain_(), skips_()
+            { }
+          private:
+            emitter& emit_;
+            expr_compiler expr_;
+            // outer assignments of a cascade, outermost first
+            std::vector<const assign*> chain_;
+            // jumps over the bodies of the if statements being compiled
+            std::vector<std::uint32_t> skips_;
+
+            void visit_impl(const variable* v) override
+            { }
+
+            void visit_impl(const int_constant* v) override
+            { }
+
+            void visit_impl(const float_constant* v) override
+            { }
+
+            void visit_impl(const string_constant* v) override
+            { }
+
+            void visit_impl(const unary_plus* v) override
+            { }
+
+            void visit_impl(const unary_minus* v) override
+            { }
+
+            void visit_impl(const binary_div* v) override
+            { }
+
+            void visit_impl(const binary_minus* v) override
+            { }
+
+            void visit_impl(const binary_mult* v) override
+            { }
+
+            void visit_impl(const binary_plus* v) override
+            { }
+
+            void visit_impl(const comp_equals* v) override
+            { }
+
+            void visit_impl(const assign* v) override
+            {
+                auto slot = emit_.resolve(v->var());
+                PCSH_ASSERT_MSG(slot != NO_REGISTER, "Assignment to an undeclared variable.");
+                auto vty = emit_.type_of(slot);
+                PCSH_ENFORCE_MSG(vty == result_type::INTEGER || vty == result_type::FLOATING || vty == result_type::STRING,
+                                 "Incomplete implementation for evaluate!");
+
+                auto mark = emit_.temp_mark();
+                if (v->right()->kind() == node_kind::ASSIGN) {
+                    // cascading assignment operators share the value: the
+                    // innermost one is compiled, then copied outwards
+                    chain_.clear();
+                    auto inner = v;
+                    while (inner->right()->kind() == node_kind::ASSIGN) {
+                        chain_.push_back(inner);
+                        inner = static_cast<const assign*>(inner->right());
+                    }
+                    inner->accept(this);
+                    auto src = emit_.resolve(inner->var());
+                    while (!chain_.empty()) {
+                        auto dst = emit_.resolve(chain_.back()->var());
+                        chain_.pop_back();
+                        emit_.emit(opcode::MOVE, dst, src);
+                        emit_.emit(opcode::DEFINE, dst);
+                        src = dst;
+                    }
+                } else {
+                    auto r = expr_.compile(v->right(), vty, slot);
+                    if (r != slot) {
+                        emit_.emit(opcode::MOVE, slot, r);
+                    }
+                    emit_.emit(opcode::DEFINE, slot);
+                }
+                emit_.release_temps(mark);
+            }
+
+            void enter_block(const block* v) override
+            {
+                emit_.push_scope(v);
+            }
+
+            void leave_block(const block* v) override
+            {
+                emit_.pop_scope();
+            }
+
+            // compiles the condition and the jump over the body
+            bool enter_if(const if_stmt* v) override
+            {
+                opcode jmp = opcode::HALT;
+                switch (v->condition_type()) {
+                    case result_type::INTEGER:
+                        jmp = opcode::JUMP_Z_I;
+                        break;
+                    case result_type::FLOATING:
+                        jmp = opcode::JUMP_Z_D;
+                        break;
+                    case result_type::STRING:
+                        jmp = opcode::JUMP_Z_S;
+                        break;
+                    default:
+                        PCSH_ASSERT_MSG(false, "Unknown condition type evaluation in if statement.");
+                        return false;
+                }
+                auto mark = emit_.temp_mark();
+                auto c = expr_.compile(v->condition(), v->condition_type());
+                emit_.release_temps(mark);
+                skips_.push_back(emit_.emit(jmp, c));
+                return true;
+            }
+
+            void leave_if(const if_stmt* v) override
+            {
+                emit_.at(skips_.back()).b = emit_.here();
+                skips_.pop_back();
+            }
+        };
+
+    }//namespace
+
+    program compile(const tree* ptree)
+    {
+        program prog;
+        prog.num_registers = 0;
+
+        emitter e(prog);
+        {
+            slot_allocator alloc(e);
+            ptree->accept(&alloc);
+        }
+        {
+            stmt_compiler comp(e);
+            ptree->accept(&comp);
+        }
+        e.emit(opcode::HALT);
+        prog.num_registers = static_cast<std::uint32_t>(prog.vars.size()) + e.max_temps();
+        return prog;
+    }
+
+    const program* compiled_program(const tree* ptree)
+    {
+        if (!ptree->compiled()) {
+            auto p = ptree->get_arena().create<program>(compile(ptree));
+            ptree->set_compiled(p);
+        }
+        return ptree->compiled();
+    }
+
+}//namespace execution
+}//namespace pcsh
@@ -0,0 +1,477 @@
+/**
+ * \file flat_interpreter.cpp
+ * \date Oct 17, 2026
+ */
+
+#include "pcsh/assert.hpp"
+#include "pcsh/parser.hpp"
+
+#include "execution/flat_interpreter.hpp"
+#include "ir/expression_walker.hpp"
+#include "ir/symbol_table.hpp"
+
+#include <cstring>
+
+namespace pcsh {
+namespace execution {
+
+    using namespace ir;
+
+    namespace {
+
+        cstring const INVALID_EQ_USE = "Invalid use of `=='. Return type of expression must be integer.";
+
+        class flat_interpreter
+        {
+          public:
+            flat_interpreter(const flat_tree& t) : tree_(t), tables_(), blocks_(), frames_(), ints_(), doubles_(), chain_()
+            { }
+
+            // blocks being run are kept on blocks_, and an if statement
+            // whose body runs is replaced by it, so statements can nest as
+            // deep as memory allows
+            void exec(node_ref r)
+            {
+                const auto base = blocks_.size();
+                while (true) {
+                    auto idx = flat_tree::index(r);
+                    switch (flat_tree::kind(r)) {
+                        case node_kind::ASSIGN:
+                            exec_assign(idx);
+                            break;
+                        case node_kind::BLOCK: {
+                            const auto& b = tree_.blocks[idx];
+                            tables_.push_back(b.table);
+                            const node_ref* s = tree_.stmts.data() + b.first;
+                            blocks_.push_back({ s, s + b.count });
+                            break;
+                        }
+                        case node_kind::IF_STMT: {
+                            const auto& f = tree_.ifs[idx];
+                            if (condition_holds(f)) {
+                                r = f.body;
+                                continue;
+                            }
+                            break;
+                        }
+                        default:
+                            // bare expressions have no effect
+                            break;
+                    }
+
+                    // the next statement, leaving the blocks that have none left
+                    while ((blocks_.size() != base) && (blocks_.back().next == blocks_.back().end)) {
+                        blocks_.pop_back();
+                        tables_.pop_back();
+                    }
+                    if (blocks_.size() == base) {
+                        return;
+                    }
+                    r = *(blocks_.back().next++);
+                }
+            }
+          private:
+            // the statements left of a block being run
+            struct block_frame
+            {
+                const node_ref* next;
+                const node_ref* end;
+            };
+
+            // an operator waiting on its operands; `next' is 0 until its
+            // left side is computed
+            struct frame
+            {
+                node_ref r;
+                std::uint32_t next;
+            };
+
+            const flat_tree& tree_;
+            scope_stack tables_;
+            std::vector<block_frame> blocks_;
+            // deep expressions are computed with these stacks
+            std::vector<frame> frames_;
+            std::vector<int> ints_;
+            std::vector<double> doubles_;
+            // variables of the outer assignments of a cascade
+            std::vector<std::uint32_t> chain_;
+
+            inline std::vector<int>& operands(int*)
+            {
+                return ints_;
+            }
+
+            inline std::vector<double>& operands(double*)
+            {
+                return doubles_;
+            }
+
+            template <class T>
+            static inline T pop(std::vector<T>& v)
+            {
+                auto x = v.back();
+                v.pop_back();
+                return x;
+            }
+
+            symbol_table::entry* entry_of(std::uint32_t var)
+            {
+                const auto& v = tree_.variables[var];
+                if (v.slot == symbol_table::NO_SLOT) {
+                    return nullptr;
+                }
+                return &symbol_table::at(*tables_[v.depth], v.slot);
+            }
+
+            const symbol_table::entry& read_entry(std::uint32_t var)
+            {
+                auto ent = entry_of(var);
+                if (!ent || !ent->evaluated) {
+                    auto msg = std::string("Variable `") + tree_.variables[var].name + "' used before it is assigned a value!";
+                    parser::throw_parser_exception(msg, "", "", "");
+                }
+                return *ent;
+            }
+
+            symbol_table::entry& assigned_entry(std::uint32_t var)
+            {
+                auto ent = entry_of(var);
+                PCSH_ASSERT_MSG(ent, "Assignment to an undeclared variable.");
+                return *ent;
+            }
+
+            void exec_assign(std::uint32_t idx)
+            {
+                // cascading assignment operators share the value: the
+                // innermost one is computed, then copied outwards
+                const auto base = chain_.size();
+                const auto* a = &tree_.assigns[idx];
+                while (flat_tree::kind(a->right) == node_kind::ASSIGN) {
+                    chain_.push_back(a->var);
+                    a = &tree_.assigns[flat_tree::index(a->right)];
+                }
+                auto* ent = &assigned_entry(a->var);
+                switch (ent->type) {
+                    case result_type::INTEGER:
+                        symbol_table::store<int>(*ent, eval<int>(a->right));
+                        break;
+                    case result_type::FLOATING:
+                        symbol_table::store<double>(*ent, eval<double>(a->right));
+                        break;
+                    case result_type::STRING:
+                        symbol_table::store<cstring>(*ent, eval_string(a->right));
+                        break;
+                    default:
+                        PCSH_ENFORCE_MSG(false, "Incomplete implementation for evaluate!");
+                        break;
+                }
+                while (chain_.size() != base) {
+                    const auto& from = *ent;
+                    ent = &assigned_entry(chain_.back());
+                    chain_.pop_back();
+                    switch (from.type) {
+                        case result_type::INTEGER:
+                            symbol_table::store<int>(*ent, from.val.int_val);
+                            break;
+                        case result_type::FLOATING:
+                            symbol_table::store<double>(*ent, from.val.dbl_val);
+                            break;
+                        case result_type::STRING:
+                            symbol_table::store<cstring>(*ent, from.val.str_val);
+                            break;
+                        default:
+                            PCSH_ENFORCE_MSG(false, "Incomplete implementation for evaluate!");
+                            break;
+                    }
+                }
+            }
+
+            bool condition_holds(const flat_tree::if_rec& f)
+            {
+                bool runbody = false;
+                switch (f.cond_type) {
+                    case result_type::INTEGER:
+                        runbody = (eval<int>(f.cond) != 0);
+                        break;
+                    case result_type::FLOATING:
+                        runbody = (eval<double>(f.cond) != 0.0);
+                        break;
+                    case result_type::STRING:
+                        runbody = (eval_string(f.cond)[0] != '\0');
+                        break;
+                    default:
+                        PCSH_ASSERT_MSG(false, "Unknown condition type evaluation in if statement.");
+                        break;
+                }
+                return runbody;
+            }
+
+            bool compare_eq(const flat_tree::comp_rec& c, unsigned depth)
+            {
+                switch (c.type) {
+                    case result_type::STRING:
+                        return ::strcmp(eval_string(c.left), eval_string(c.right)) == 0;
+                    case result_type::INTEGER:
+                    case result_type::FLOATING:
+                        // floating point comparisons are made on truncated values
+                        return eval<int>(c.left, depth) == eval<int>(c.right, depth);
+                    default:
+                        PCSH_ASSERT_MSG(false, "Invalid comparison type");
+                        return false;
+                }
+            }
+
+            // expressions are computed in the type of the enclosing statement
+            template <class T>
+            T eval(node_ref r, unsigned depth = 0)
+            {
+                if (depth == expression_walker::RECURSION_LIMIT) {
+                    return eval_deep<T>(r);
+                }
+                ++depth;
+                auto idx = flat_tree::index(r);
+                switch (flat_tree::kind(r)) {
+                    case node_kind::VARIABLE:
+                        return symbol_table::read<T>(read_entry(idx));
+                    case node_kind::INT_CONSTANT:
+                        return static_cast<T>(tree_.ints[idx]);
+                    case node_kind::FLOAT_CONSTANT:
+                        return static_cast<T>(tree_.floats[idx]);
+                    case node_kind::UNARY_PLUS:
+                        return eval<T>(tree_.unaries[idx], depth);
+                    case node_kind::UNARY_MINUS:
+                        return -eval<T>(tree_.unaries[idx], depth);
+                    case node_kind::BINARY_DIV: {
+                        const auto& b = tree_.binaries[idx];
+                        auto l = eval<T>(b.left, depth);
+                        return l / eval<T>(b.right, depth);
+                    }
+                    case node_kind::BINARY_MINUS: {
+                        const auto& b = tree_.binaries[idx];
+                        auto l = eval<T>(b.left, depth);
+                        return l - eval<T>(b.right, depth);
+                    }
+                    case node_kind::BINARY_MULT: {
+                        const auto& b = tree_.binaries[idx];
+                        auto l = eval<T>(b.left, depth);
+                        return l * eval<T>(b.right, depth);
+                    }
+                    case node_kind::BINARY_PLUS: {
+                        const auto& b = tree_.binaries[idx];
+                        auto l = eval<T>(b.left, depth);
+                        return l + eval<T>(b.right, depth);
+                    }
+                    case node_kind::ASSIGN: {
+                        // only takes effect if the variable has no value yet
+                        const auto& a = tree_.assigns[idx];
+                        auto ent = entry_of(a.var);
+                        if (!ent) {
+                            // assigned in an if condition, which declares
+                            // nothing: the value is stored nowhere
+                            return eval<T>(a.right, depth);
+                        }
+                        if (ent->evaluated) {
+                            return symbol_table::read<T>(*ent);
+                        }
+                        auto val = eval<T>(a.right, depth);
+                        symbol_table::store<T>(*ent, val);
+                        return val;
+                    }
+                    case node_kind::COMP_EQUALS:
+                        if (result_type_of<T>::value != result_type::INTEGER) {
+                            parser::throw_parser_exception(INVALID_EQ_USE, "", "", "");
+                        }
+                        return compare_eq(tree_.comparisons[idx], depth) ? 1 : 0;
+                    default:
+                        PCSH_ASSERT_MSG(false, "Invalid node in a numeric expression.");
+                        return T();
+                }
+            }
+
+            // eval() beyond RECURSION_LIMIT: the operators waiting on their
+            // operands are kept on frames_, and finished left operands on
+            // the stack of T, so the depth is limited by memory
+            template <class T>
+            T eval_deep(node_ref r)
+            {
+                auto& values = operands(static_cast<T*>(nullptr));
+                const auto base = frames_.size();
+                T val = T();
+                while (true) {
+                    // down the left spine to a value
+                    bool found = false;
+                    while (!found) {
+                        auto idx = flat_tree::index(r);
+                        found = true;
+                        switch (flat_tree::kind(r)) {
+                            case node_kind::VARIABLE:
+                                val = symbol_table::read<T>(read_entry(idx));
+                                break;
+                            case node_kind::INT_CONSTANT:
+                                val = static_cast<T>(tree_.ints[idx]);
+                                break;
+                            case node_kind::FLOAT_CONSTANT:
+                                val = static_cast<T>(tree_.floats[idx]);
+                                break;
+                            case node_kind::UNARY_PLUS:
+                            case node_kind::UNARY_MINUS:
+                                frames_.push_back({ r, 1 });
+                                r = tree_.unaries[idx];
+                                found = false;
+                                break;
+                            case node_kind::BINARY_DIV:
+                            case node_kind::BINARY_MINUS:
+                            case node_kind::BINARY_MULT:
+                            case node_kind::BINARY_PLUS:
+                                frames_.push_back({ r, 0 });
+                                r = tree_.binaries[idx].left;
+                                found = false;
+                                break;
+                            case node_kind::ASSIGN: {
+                                // only takes effect if the variable has no value yet
+                                const auto& a = tree_.assigns[idx];
+                                auto ent = entry_of(a.var);
+                                if (!ent) {
+                                    r = a.right;
+                                    found = false;
+                                } else if (ent->evaluated) {
+                                    val = symbol_table::read<T>(*ent);
+                                } else {
+                                    frames_.push_back({ r, 1 });
+                                    r = a.right;
+                                    found = false;
+                                }
+                                break;
+                            }
+                            case node_kind::COMP_EQUALS: {
+                                if (result_type_of<T>::value != result_type::INTEGER) {
+                                    parser::throw_parser_exception(INVALID_EQ_USE, "", "", "");
+                                }
+                                const auto& c = tree_.comparisons[idx];
+                                switch (c.type) {
+                                    case result_type::STRING:
+                                        val = (::strcmp(eval_string(c.left), eval_string(c.right)) == 0) ? 1 : 0;
+                                        break;
+                                    case result_type::INTEGER:
+                                    case result_type::FLOATING:
+                                        // floating point comparisons are made on truncated values
+                                        frames_.push_back({ r, 0 });
+                                        r = c.left;
+                                        found = false;
+                                        break;
+                                    default:
+                                        PCSH_ASSERT_MSG(false, "Invalid comparison type");
+                                        val = 0;
+                                        break;
+                                }
+                                break;
+                            }
+                            default:
+                                PCSH_ASSERT_MSG(false, "Invalid node in a numeric expression.");
+                                val = T();
+                                break;
+                        }
+                    }
+
+                    // back up, applying operators until one needs a right side
+                    while (true) {
+                        if (frames_.size() == base) {
+                            return val;
+                        }
+                        auto& f = frames_.back();
+                        auto idx = flat_tree::index(f.r);
+                        auto kind = flat_tree::kind(f.r);
+                        if (f.next == 0) {
+                            values.push_back(val);
+                            f.next = 1;
+                            r = (kind == node_kind::COMP_EQUALS) ? tree_.comparisons[idx].right : tree_.binaries[idx].right;
+                            break;
+                        }
+                        switch (kind) {
+                            case node_kind::UNARY_MINUS:
+                                val = -val;
+                                break;
+                            case node_kind::BINARY_DIV:
+                                val = pop(values) / val;
+                                break;
+                            case node_kind::BINARY_MINUS:
+                                val = pop(values) - val;
+                                break;
+                            case node_kind::BINARY_MULT:
+                                val = pop(values) * val;
+                                break;
+                            case node_kind::BINARY_PLUS:
+                                val = pop(values) + val;
+                                break;
+                            case node_kind::ASSIGN:
+                                symbol_table::store<T>(assigned_entry(tree_.assigns[idx].var), val);
+                                break;
+                            case node_kind::COMP_EQUALS:
+                                val = (pop(values) == val) ? 1 : 0;
+                                break;
+                            default:
+                                break;
+                        }
+                        frames_.pop_back();
+                    }
+                }
+            }
+
+            // string expressions only nest through assignments, which are
+            // followed down and then stored back up
+            cstring eval_string(node_ref r)
+            {
+                const auto base = chain_.size();
+                cstring val = "";
+                bool found = false;
+                while (!found) {
+                    auto idx = flat_tree::index(r);
+                    found = true;
+                    switch (flat_tree::kind(r)) {
+                        case node_kind::VARIABLE:
+                            val = symbol_table::read<cstring>(read_entry(idx));
+                            break;
+                        case node_kind::STRING_CONSTANT:
+                            val = tree_.strings[idx];
+                            break;
+                        case node_kind::ASSIGN: {
+                            const auto& a = tree_.assigns[idx];
+                            auto ent = entry_of(a.var);
+                            if (!ent) {
+                                r = a.right;
+                                found = false;
+                            } else if (ent->evaluated) {
+                                val = symbol_table::read<cstring>(*ent);
+                            } else {
+                                chain_.push_back(a.var);
+                                r = a.right;
+                                found = false;
+                            }
+                            break;
+                        }
+                        case node_kind::COMP_EQUALS:
+                            parser::throw_parser_exception(INVALID_EQ_USE, "", "", "");
+                            break;
+                        default:
+                            PCSH_ASSERT_MSG(false, "Invalid node in a string expression.");
+                            break;
+                    }
+                }
+                while (chain_.size() != base) {
+                    symbol_table::store<cstring>(assigned_entry(chain_.back()), val);
+                    chain_.pop_back();
+                }
+                return val;
+            }
+        };
+
+    }//namespace
+
+    void run(const flat_tree& t)
+    {
+        flat_interpreter interp(t);
+        interp.exec(t.root);
+    }
+
+}//namespace execution
+}//namespace pcsh
@@ -0,0 +1,20 @@
+/**
+ * \file flat_interpreter.hpp
+ * \date Oct 17, 2026
+ */
+
+#ifndef PCSH_EXECUTION_FLAT_INTERPRETER_HPP
+#define PCSH_EXECUTION_FLAT_INTERPRETER_HPP
+
+#include "ir/flat_tree.hpp"
+
+namespace pcsh {
+namespace execution {
+
+    /// evaluates the flat form of a tree, with the semantics of interpreter
+    void run(const ir::flat_tree& t);
+
+}//namespace execution
+}//namespace pcsh
+
+#endif/*PCSH_EXECUTION_FLAT_INTERPRETER_HPP*/
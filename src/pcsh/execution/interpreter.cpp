@@ -6,229 +6,369 @@
 #include "pcsh/parser.hpp"
 
 #include "execution/interpreter.hpp"
+#include "ir/expression_walker.hpp"
 #include "ir/nodes.hpp"
 #include "ir/symbol_table.hpp"
 
+#include <cstring>
+
 namespace pcsh {
 namespace execution {
 
     using namespace ir;
 
-    template <bool isint>
-    bool compare_eq(const comp_equals* v, const variable_accessor& acc, arena& ar);
-
-    template <class T>
-    class typed_interpreter;
-
-    template <>
-    class typed_interpreter<void>;
-
-    template <>
-    class typed_interpreter<cstring>;
-
-    template <class T>
-    class typed_interpreter : public node_visitor
-    {
-    public:
-        typed_interpreter(const sym_table_list& p, arena& ar) : accessor_(p), ar_(ar), value_()
-        { }
-
-        T value() const
-        {
-            return value_;
-        }
-    private:
-        variable_accessor accessor_;
-        arena& ar_;
-        T value_;
+    namespace {
 
-        void visit_impl(const variable* v) override
+        void throw_unassigned(const variable* v)
         {
-            auto res = accessor_.lookup(v, true);
-            if (res.evaluated) {
-                res.ptr->accept(this);
-                return;
-            }
             auto msg = std::string("Variable `") + v->name() + "' used before it is assigned a value!";
             parser::throw_parser_exception(msg, "", "", "");
         }
 
-        void visit_impl(const int_constant* v) override
+        void throw_invalid_eq()
         {
-            value_ = static_cast<T>(v->value());
+            parser::throw_parser_exception("Invalid use of `=='. Return type of expression must be integer.", "", "", "");
         }
 
-        void visit_impl(const float_constant* v) override
+        template <class T>
+        std::vector<T>& operands_of(operand_stacks& s);
+
+        template <>
+        inline std::vector<int>& operands_of<int>(operand_stacks& s)
         {
-            value_ = static_cast<T>(v->value());
+            return s.ints;
         }
 
-        void visit_impl(const unary_plus* v) override
+        template <>
+        inline std::vector<double>& operands_of<double>(operand_stacks& s)
         {
-            v->operand()->accept(this);
-            // value_ = value_;
+            return s.doubles;
         }
 
-        void visit_impl(const unary_minus* v) override
+        template <class T>
+        inline T pop(std::vector<T>& v)
         {
-            v->operand()->accept(this);
-            value_ = -value_;
+            auto x = v.back();
+            v.pop_back();
+            return x;
         }
 
-        void visit_impl(const binary_div* v) override
+    }//namespace
+
+    // Computes an expression as a T.
+    template <class T>
+    class typed_interpreter
+    {
+    public:
+        typed_interpreter(const scope_stack& p, operand_stacks& s)
+          : accessor_(p), stacks_(s), values_(operands_of<T>(s)), value_()
+        { }
+
+        void visit(const node* n)
         {
-            v->left()->accept(this);
-            auto left = value_;
-            v->right()->accept(this);
-            auto right = value_;
-            value_ = left / right;
+            value_ = eval(n, 0);
         }
 
-        void visit_impl(const binary_minus* v) override
+        T value() const
         {
-            v->left()->accept(this);
-            auto left = value_;
-            v->right()->accept(this);
-            auto right = value_;
-            value_ = left - right;
+            return value_;
         }
+    private:
+        variable_accessor accessor_;
+        operand_stacks& stacks_;
+        std::vector<T>& values_;
+        T value_;
 
-        void visit_impl(const binary_mult* v) override
+        // comparisons yield integers; see the int specialization. False if
+        // `val' is the result, true if the operands are to be compared as T.
+        bool compare(const comp_equals* v, T& val)
         {
-            v->left()->accept(this);
-            auto left = value_;
-            v->right()->accept(this);
-            auto right = value_;
-            value_ = left * right;
+            throw_invalid_eq();
+            return false;
         }
 
-        void visit_impl(const binary_plus* v) override
+        T read(const variable* v)
         {
-            v->left()->accept(this);
-            auto left = value_;
-            v->right()->accept(this);
-            auto right = value_;
-            value_ = left + right;
+            auto res = accessor_.find(v, true);
+            if (!res) {
+                throw_unassigned(v);
+            }
+            return symbol_table::read<T>(*res);
         }
 
-        void visit_impl(const assign* v) override
+        T eval(const node* n, unsigned depth)
         {
-            auto res = accessor_.lookup(v->var());
-            if (!res.evaluated) {
-                v->right()->accept(this);
-                accessor_.set(v->var(), ar_.create<float_constant>(value_),
-                              result_type_of<T>::value, true);
-            } else {
-                res.ptr->accept(this);
+            if (depth == expression_walker::RECURSION_LIMIT) {
+                return eval_deep(n);
+            }
+            ++depth;
+            switch (n->kind()) {
+                case node_kind::VARIABLE:
+                    return read(static_cast<const variable*>(n));
+                case node_kind::INT_CONSTANT:
+                    return static_cast<T>(static_cast<const int_constant*>(n)->value());
+                case node_kind::FLOAT_CONSTANT:
+                    return static_cast<T>(static_cast<const float_constant*>(n)->value());
+                case node_kind::UNARY_PLUS:
+                    return eval(static_cast<const unary_plus*>(n)->operand(), depth);
+                case node_kind::UNARY_MINUS:
+                    return -eval(static_cast<const unary_minus*>(n)->operand(), depth);
+                case node_kind::BINARY_DIV: {
+                    auto l = eval(static_cast<const binary_div*>(n)->lhs(), depth);
+                    return l / eval(static_cast<const binary_div*>(n)->rhs(), depth);
+                }
+                case node_kind::BINARY_MINUS: {
+                    auto l = eval(static_cast<const binary_minus*>(n)->lhs(), depth);
+                    return l - eval(static_cast<const binary_minus*>(n)->rhs(), depth);
+                }
+                case node_kind::BINARY_MULT: {
+                    auto l = eval(static_cast<const binary_mult*>(n)->lhs(), depth);
+                    return l * eval(static_cast<const binary_mult*>(n)->rhs(), depth);
+                }
+                case node_kind::BINARY_PLUS: {
+                    auto l = eval(static_cast<const binary_plus*>(n)->lhs(), depth);
+                    return l + eval(static_cast<const binary_plus*>(n)->rhs(), depth);
+                }
+                case node_kind::ASSIGN: {
+                    // only takes effect if the variable has no value yet
+                    auto v = static_cast<const assign*>(n);
+                    auto res = accessor_.find(v->var());
+                    if (!res) {
+                        // assigned in an if condition, which declares
+                        // nothing: the value is stored nowhere
+                        return eval(v->rhs(), depth);
+                    }
+                    if (res->evaluated) {
+                        return symbol_table::read<T>(*res);
+                    }
+                    auto val = eval(v->rhs(), depth);
+                    symbol_table::store<T>(*res, val);
+                    return val;
+                }
+                case node_kind::COMP_EQUALS: {
+                    auto v = static_cast<const comp_equals*>(n);
+                    T val = T();
+                    if (compare(v, val)) {
+                        auto l = eval(v->lhs(), depth);
+                        val = (l == eval(v->rhs(), depth)) ? 1 : 0;
+                    }
+                    return val;
+                }
+                default:
+                    PCSH_ASSERT_MSG(false, "Invalid node in a numeric expression.");
+                    return T();
             }
         }
 
-        void visit_impl(const comp_equals* v) override
+        // eval() beyond RECURSION_LIMIT: the operators waiting on their
+        // operands are kept on the frames of `stacks', and finished left
+        // operands on its T stack, so the depth is limited by memory
+        T eval_deep(const node* n)
         {
-            value_ = compare_eq<result_type_of<T>::value == result_type::INTEGER>(v, accessor_, ar_)
-                ? 1
-                : 0;
+            auto& frames = stacks_.frames;
+            const auto base = frames.size();
+            T val = T();
+            while (true) {
+                // down the left spine to a value
+                bool found = false;
+                while (!found) {
+                    found = true;
+                    switch (n->kind()) {
+                        case node_kind::VARIABLE:
+                            val = read(static_cast<const variable*>(n));
+                            break;
+                        case node_kind::INT_CONSTANT:
+                            val = static_cast<T>(static_cast<const int_constant*>(n)->value());
+                            break;
+                        case node_kind::FLOAT_CONSTANT:
+                            val = static_cast<T>(static_cast<const float_constant*>(n)->value());
+                            break;
+                        case node_kind::UNARY_PLUS:
+                        case node_kind::UNARY_MINUS:
+                            frames.push_back({ n, 1 });
+                            n = static_cast<const untyped_unary_op_base*>(n)->operand();
+                            found = false;
+                            break;
+                        case node_kind::BINARY_DIV:
+                        case node_kind::BINARY_MINUS:
+                        case node_kind::BINARY_MULT:
+                        case node_kind::BINARY_PLUS:
+                            frames.push_back({ n, 0 });
+                            n = static_cast<const untyped_binary_op_base*>(n)->lhs();
+                            found = false;
+                            break;
+                        case node_kind::ASSIGN: {
+                            // only takes effect if the variable has no value yet
+                            auto res = accessor_.find(static_cast<const assign*>(n)->var());
+                            if (!res) {
+                                n = static_cast<const assign*>(n)->rhs();
+                                found = false;
+                            } else if (res->evaluated) {
+                                val = symbol_table::read<T>(*res);
+                            } else {
+                                frames.push_back({ n, 1 });
+                                n = static_cast<const assign*>(n)->rhs();
+                                found = false;
+                            }
+                            break;
+                        }
+                        case node_kind::COMP_EQUALS:
+                            if (compare(static_cast<const comp_equals*>(n), val)) {
+                                frames.push_back({ n, 0 });
+                                n = static_cast<const comp_equals*>(n)->lhs();
+                                found = false;
+                            }
+                            break;
+                        default:
+                            PCSH_ASSERT_MSG(false, "Invalid node in a numeric expression.");
+                            val = T();
+                            break;
+                    }
+                }
+
+                // back up, applying operators until one needs a right side
+                while (true) {
+                    if (frames.size() == base) {
+                        return val;
+                    }
+                    auto& f = frames.back();
+                    if (f.next == 0) {
+                        values_.push_back(val);
+                        f.next = 1;
+                        n = static_cast<const untyped_binary_op_base*>(f.n)->rhs();
+                        break;
+                    }
+                    switch (f.n->kind()) {
+                        case node_kind::UNARY_MINUS:
+                            val = -val;
+                            break;
+                        case node_kind::BINARY_DIV:
+                            val = pop(values_) / val;
+                            break;
+                        case node_kind::BINARY_MINUS:
+                            val = pop(values_) - val;
+                            break;
+                        case node_kind::BINARY_MULT:
+                            val = pop(values_) * val;
+                            break;
+                        case node_kind::BINARY_PLUS:
+                            val = pop(values_) + val;
+                            break;
+                        case node_kind::ASSIGN:
+                            symbol_table::store<T>(*accessor_.find(static_cast<const assign*>(f.n)->var()), val);
+                            break;
+                        case node_kind::COMP_EQUALS:
+                            val = (pop(values_) == val) ? 1 : 0;
+                            break;
+                        default:
+                            break;
+                    }
+                    frames.pop_back();
+                }
+            }
         }
     };
 
     template <>
-    class typed_interpreter<cstring> : public node_visitor
+    class typed_interpreter<cstring>
     {
     public:
-        typed_interpreter(const sym_table_list& p, arena& ar) : accessor_(p), ar_(ar), value_(nullptr)
+        typed_interpreter(const scope_stack& p, operand_stacks& s)
+          : accessor_(p), stacks_(s), value_(nullptr)
         { }
 
+        void visit(const node* n)
+        {
+            value_ = eval(n);
+        }
+
         cstring value() const
         {
             return value_;
         }
     private:
         variable_accessor accessor_;
-        arena& ar_;
+        operand_stacks& stacks_;
         cstring value_;
 
-        void visit_impl(const variable* v) override
+        // string expressions only nest through assignments, which are
+        // followed down and then stored back up
+        cstring eval(const node* n)
         {
-            auto res = accessor_.lookup(v, true);
-            if (res.evaluated) {
-                res.ptr->accept(this);
-                return;
+            auto& frames = stacks_.frames;
+            const auto base = frames.size();
+            cstring val = "";
+            bool found = false;
+            while (!found) {
+                found = true;
+                switch (n->kind()) {
+                    case node_kind::VARIABLE: {
+                        auto v = static_cast<const variable*>(n);
+                        auto res = accessor_.find(v, true);
+                        if (!res) {
+                            throw_unassigned(v);
+                        }
+                        val = symbol_table::read<cstring>(*res);
+                        break;
+                    }
+                    case node_kind::STRING_CONSTANT:
+                        val = static_cast<const string_constant*>(n)->value();
+                        break;
+                    case node_kind::ASSIGN: {
+                        auto res = accessor_.find(static_cast<const assign*>(n)->var());
+                        if (!res) {
+                            n = static_cast<const assign*>(n)->rhs();
+                            found = false;
+                        } else if (res->evaluated) {
+                            val = symbol_table::read<cstring>(*res);
+                        } else {
+                            frames.push_back({ n, 1 });
+                            n = static_cast<const assign*>(n)->rhs();
+                            found = false;
+                        }
+                        break;
+                    }
+                    case node_kind::COMP_EQUALS:
+                        throw_invalid_eq();
+                        break;
+                    default:
+                        // the type checker keeps numbers and arithmetic out
+                        // of string expressions
+                        PCSH_ASSERT_MSG(false, "Invalid node in a string expression.");
+                        break;
+                }
             }
-            auto msg = std::string("Variable `") + v->name() + "' used before it is assigned a value!";
-            parser::throw_parser_exception(msg, "", "", "");
-        }
-
-        void visit_impl(const assign* v) override
-        {
-            auto res = accessor_.lookup(v->var());
-            if (!res.evaluated) {
-                v->right()->accept(this);
-                accessor_.set(v->var(), ar_.create<string_constant>(ar_.create_string(value_)),
-                              result_type::STRING, true);
-            } else {
-                res.ptr->accept(this);
+            while (frames.size() != base) {
+                symbol_table::store<cstring>(*accessor_.find(static_cast<const assign*>(frames.back().n)->var()), val);
+                frames.pop_back();
             }
-        }
-
-        void visit_impl(const string_constant* v) override
-        {
-            value_ = v->value();
-        }
-
-        void visit_impl(const comp_equals* v) override
-        {
-            parser::throw_parser_exception("Invalid use of `=='. Return type of expression must be integer.", "", "", "");
+            return val;
         }
     };
 
     template <>
-    class typed_interpreter<void> : public node_visitor
-    { };
-
-    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-    /// operations
-    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-    template <>
-    inline bool compare_eq<false>(const comp_equals* v, const variable_accessor& acc, arena& ar)
-    {
-        parser::throw_parser_exception("Invalid use of `=='. Return type of expression must be integer.", "", "", "");
-        return false;
-    }
-
-    template <>
-    inline bool compare_eq<true>(const comp_equals* v, const variable_accessor& acc, arena& ar)
+    bool typed_interpreter<int>::compare(const comp_equals* v, int& val)
     {
         switch (v->comp_type()) {
             case result_type::STRING: {
-                typed_interpreter<cstring> eval(acc.symtab_list(), ar);
-                v->left()->accept(&eval);
+                // string operands hold no comparisons, so this nests once
+                typed_interpreter<cstring> eval(accessor_.symtab_list(), stacks_);
+                eval.visit(v->left());
                 auto v1 = eval.value();
-                v->right()->accept(&eval);
+                eval.visit(v->right());
                 auto v2 = eval.value();
-                return ::strcmp(v1, v2) == 0;
-            }
-            case result_type::INTEGER: {
-                typed_interpreter<int> eval(acc.symtab_list(), ar);
-                v->left()->accept(&eval);
-                auto v1 = eval.value();
-                v->right()->accept(&eval);
-                auto v2 = eval.value();
-                return v1 == v2;
-                break;
-            }
-            case result_type::FLOATING: {
-                typed_interpreter<int> eval(acc.symtab_list(), ar);
-                v->left()->accept(&eval);
-                auto v1 = eval.value();
-                v->right()->accept(&eval);
-                auto v2 = eval.value();
-                return v1 == v2;
+                val = (::strcmp(v1, v2) == 0) ? 1 : 0;
+                return false;
             }
-            default: {
+            case result_type::INTEGER:
+            case result_type::FLOATING:
+                // floating point comparisons are made on truncated values,
+                // so the operands are computed as int here
+                return true;
+            default:
                 PCSH_ASSERT_MSG(false, "Invalid comparison type");
+                val = 0;
                 return false;
-            }
         }
     }
 
@@ -236,152 +376,77 @@ namespace execution {
     /// evaluator
     /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-    void interpreter::visit_impl(const variable* v)
-    {
-        curr_visitor_->visit(v);
-    }
-
-    void interpreter::visit_impl(const int_constant* v)
-    {
-        curr_visitor_->visit(v);
-    }
-
-    void interpreter::visit_impl(const float_constant* v)
-    {
-        curr_visitor_->visit(v);
-    }
-
-    void interpreter::visit_impl(const string_constant* v)
-    {
-        curr_visitor_->visit(v);
-    }
-
-    void interpreter::visit_impl(const unary_plus* v)
-    {
-        curr_visitor_->visit(v);
-    }
-
-    void interpreter::visit_impl(const unary_minus* v)
-    {
-        curr_visitor_->visit(v);
-    }
-
-    void interpreter::visit_impl(const binary_div* v)
-    {
-        curr_visitor_->visit(v);
-    }
-
-    void interpreter::visit_impl(const binary_minus* v)
-    {
-        curr_visitor_->visit(v);
-    }
-
-    void interpreter::visit_impl(const binary_mult* v)
-    {
-        curr_visitor_->visit(v);
-    }
-
-    void interpreter::visit_impl(const binary_plus* v)
-    {
-        curr_visitor_->visit(v);
-    }
-
     void interpreter::visit_impl(const assign* v)
     {
-        auto oldvis = curr_visitor_;
-
-        arena& ar = *ar_;
-
-        // slightly wasteful, yes, but avoids dynamic allocation
-        // and can be cleaned up later with a smarter union
-        typed_interpreter<int> intinterp(nested_tables_, ar);
-        typed_interpreter<double> dblinterp(nested_tables_, ar);
-        typed_interpreter<cstring> strinterp(nested_tables_, ar);
-
         variable_accessor acc(nested_tables_);
 
-        const auto& ent = acc.lookup(v->var());
-        result_type outty = ent.type;
-
-        switch (outty) {
-            case result_type::INTEGER:
-                curr_visitor_ = &intinterp;
-                break;
-            case result_type::FLOATING:
-                curr_visitor_ = &dblinterp;
-                break;
-            case result_type::STRING:
-                curr_visitor_ = &strinterp;
-                break;
-            default:
-                PCSH_ENFORCE_MSG(false, "Incomplete implementation for evaluate!");
-                break;
-        }
-
-        auto oldlastasgn = last_assign_;
-        v->right()->accept(this);
-
-        node* newvalue = nullptr;
-
-        if (oldlastasgn != last_assign_) {
-            // cascading assignment operators
-            acc.set(v->var(), last_assign_, outty, true);
-            goto assign_done_cleanup;
+        // cascading assignment operators: the innermost one is computed and
+        // its value is copied outwards, one variable at a time
+        chain_.clear();
+        while (v->right()->kind() == node_kind::ASSIGN) {
+            chain_.push_back(v);
+            v = static_cast<const assign*>(v->right());
         }
 
-        switch (outty) {
-            case result_type::INTEGER:
-                newvalue = ar.create<int_constant>(intinterp.value());
+        auto ent = acc.find(v->var());
+        PCSH_ASSERT_MSG(ent, "Assignment to an undeclared variable.");
+        switch (ent->type) {
+            case result_type::INTEGER: {
+                typed_interpreter<int> eval(nested_tables_, stacks_);
+                eval.visit(v->right());
+                symbol_table::store<int>(*ent, eval.value());
                 break;
-            case result_type::FLOATING:
-                newvalue = ar.create<float_constant>(dblinterp.value());
+            }
+            case result_type::FLOATING: {
+                typed_interpreter<double> eval(nested_tables_, stacks_);
+                eval.visit(v->right());
+                symbol_table::store<double>(*ent, eval.value());
                 break;
-            case result_type::STRING:
-                newvalue = ar.create<string_constant>(ar.create_string(strinterp.value()));
+            }
+            case result_type::STRING: {
+                typed_interpreter<cstring> eval(nested_tables_, stacks_);
+                eval.visit(v->right());
+                symbol_table::store<cstring>(*ent, eval.value());
                 break;
+            }
             default:
                 PCSH_ENFORCE_MSG(false, "Incomplete implementation for evaluate!");
                 break;
         }
 
-        acc.set(v->var(), newvalue, outty, true);
-        last_assign_ = newvalue;
-
-assign_done_cleanup:
-        curr_visitor_ = oldvis;
+        while (!chain_.empty()) {
+            auto from = ent;
+            ent = acc.find(chain_.back()->var());
+            PCSH_ASSERT_MSG(ent, "Assignment to an undeclared variable.");
+            chain_.pop_back();
+            switch (from->type) {
+                case result_type::INTEGER:
+                    symbol_table::store<int>(*ent, from->val.int_val);
+                    break;
+                case result_type::FLOATING:
+                    symbol_table::store<double>(*ent, from->val.dbl_val);
+                    break;
+                case result_type::STRING:
+                    symbol_table::store<cstring>(*ent, from->val.str_val);
+                    break;
+                default:
+                    PCSH_ENFORCE_MSG(false, "Incomplete implementation for evaluate!");
+                    break;
+            }
+        }
     }
 
-    void interpreter::visit_impl(const comp_equals* v)
+    void interpreter::enter_block(const block* v)
     {
-        curr_visitor_->visit(v);
+        nested_tables_.push_back(&(v->table()));
     }
 
-    void interpreter::visit_impl(const block* v)
+    void interpreter::leave_block(const block* v)
     {
-        auto oldblk = curr_;
-        auto oldvis = curr_visitor_;
-
-        if (!ar_) {
-            ar_ = &(v->get_arena());
-        }
-
-        {// visit this block
-            curr_ = v;
-            typed_interpreter<void> donothing;
-            curr_visitor_ = &donothing;
-
-            nested_tables_.push_back(&(v->table()));
-
-            visit_block(v);
-
-            nested_tables_.pop_back();
-        }
-
-        curr_ = oldblk;
-        curr_visitor_ = oldvis;
+        nested_tables_.pop_back();
     }
 
-    void interpreter::visit_impl(const if_stmt* v)
+    bool interpreter::enter_if(const if_stmt* v)
     {
         auto c = v->condition();
         auto cty = v->condition_type();
@@ -390,20 +455,20 @@ assign_done_cleanup:
 
         switch (cty) {
             case pcsh::result_type::INTEGER: {
-                typed_interpreter<int> eval(nested_tables_, *ar_);
-                c->accept(&eval);
+                typed_interpreter<int> eval(nested_tables_, stacks_);
+                eval.visit(c);
                 runbody = (eval.value() != 0);
                 break;
             }
             case pcsh::result_type::FLOATING: {
-                typed_interpreter<double> eval(nested_tables_, *ar_);
-                c->accept(&eval);
+                typed_interpreter<double> eval(nested_tables_, stacks_);
+                eval.visit(c);
                 runbody = (eval.value() != 0.0);
                 break;
             }
             case pcsh::result_type::STRING: {
-                typed_interpreter<cstring> eval(nested_tables_, *ar_);
-                c->accept(&eval);
+                typed_interpreter<cstring> eval(nested_tables_, stacks_);
+                eval.visit(c);
                 cstring str = eval.value();
                 runbody = (str[0] != '\0');
                 break;
@@ -413,9 +478,7 @@ assign_done_cleanup:
                 break;
         }
 
-        if (runbody) {
-            v->body()->accept(this);
-        }
+        return runbody;
     }
 
 }//namespace execution
@@ -6,40 +6,81 @@
 #ifndef PCSH_EXECUTION_INTERPRETER_HPP
 #define PCSH_EXECUTION_INTERPRETER_HPP
 
+#include "ir/static_visitor.hpp"
 #include "ir/symbol_table.hpp"
-#include "ir/visitor.hpp"
 
-#include <list>
+#include <vector>
 
 namespace pcsh {
 namespace execution {
 
-    class interpreter final : public ir::node_visitor
+    /// operators and operands waiting to be combined, shared by the
+    /// expressions of a run
+    struct operand_stacks
     {
+        struct frame
+        {
+            const ir::node* n;
+            unsigned next;      // 0 until the left operand is computed
+        };
+
+        std::vector<frame> frames;
+        std::vector<int> ints;
+        std::vector<double> doubles;
+    };
+
+    class interpreter final : public ir::static_visitor<interpreter>
+    {
+        friend class ir::static_visitor<interpreter>;
     public:
-        inline interpreter() : curr_(nullptr), curr_visitor_(nullptr), ar_(nullptr), nested_tables_(), last_assign_(nullptr)
+        inline interpreter() : nested_tables_(), stacks_(), chain_()
         { }
     private:
-        const ir::block* curr_;
-        ir::node_visitor* curr_visitor_;
-        arena* ar_;
-        ir::sym_table_list nested_tables_;
-        ir::node* last_assign_;
-
-        void visit_impl(const ir::variable* v) override;
-        void visit_impl(const ir::int_constant* v) override;
-        void visit_impl(const ir::float_constant* v) override;
-        void visit_impl(const ir::string_constant* v) override;
-        void visit_impl(const ir::unary_plus* v) override;
-        void visit_impl(const ir::unary_minus* v) override;
-        void visit_impl(const ir::binary_div* v) override;
-        void visit_impl(const ir::binary_minus* v) override;
-        void visit_impl(const ir::binary_mult* v) override;
-        void visit_impl(const ir::binary_plus* v) override;
-        void visit_impl(const ir::assign* v) override;
-        void visit_impl(const ir::comp_equals* v) override;
-        void visit_impl(const ir::block* v) override;
-        void visit_impl(const ir::if_stmt* v) override;
+        ir::scope_stack nested_tables_;
+        operand_stacks stacks_;
+        // outer assignments of a cascade, outermost first
+        std::vector<const ir::assign*> chain_;
+
+        // bare expressions used as statements have no effect
+        void visit_impl(const ir::variable* v)
+        { }
+
+        void visit_impl(const ir::int_constant* v)
+        { }
+
+        void visit_impl(const ir::float_constant* v)
+        { }
+
+        void visit_impl(const ir::string_constant* v)
+        { }
+
+        void visit_impl(const ir::unary_plus* v)
+        { }
+
+        void visit_impl(const ir::unary_minus* v)
+        { }
+
+        void visit_impl(const ir::binary_div* v)
+        { }
+
+        void visit_impl(const ir::binary_minus* v)
+        { }
+
+        void visit_impl(const ir::binary_mult* v)
+        { }
+
+        void visit_impl(const ir::binary_plus* v)
+        { }
+
+        void visit_impl(const ir::comp_equals* v)
+        { }
+
+        void visit_impl(const ir::assign* v);
+
+        void enter_block(const ir::block* v);
+        void leave_block(const ir::block* v);
+        // evaluates the condition, returning whether the body runs
+        bool enter_if(const ir::if_stmt* v);
     };
 
 }//namespace execution
@@ -0,0 +1,169 @@
+/**
+ * \file vm.cpp
+ * \date Oct 17, 2026
+ */
+
+#include "pcsh/assert.hpp"
+#include "pcsh/parser.hpp"
+
+#include "execution/bytecode.hpp"
+#include "ir/nodes.hpp"
+#include "ir/symbol_table.hpp"
+
+#include <cstring>
+
+namespace pcsh {
+namespace execution {
+
+    using namespace ir;
+
+    namespace {
+
+        // picks up values left in the symbol tables by an earlier evaluation
+        void load_variables(const program& prog, value* regs, byte* assigned)
+        {
+            const auto n = prog.vars.size();
+            for (size_t i = 0; i != n; ++i) {
+                const auto& slot = prog.vars[i];
+                if (slot.var && slot.entry->evaluated) {
+                    regs[i] = slot.entry->val;
+                    assigned[i] = 1;
+                }
+            }
+        }
+
+        void store_variables(const program& prog, const value* regs, const byte* assigned)
+        {
+            const auto n = prog.vars.size();
+            for (size_t i = 0; i != n; ++i) {
+                const auto& slot = prog.vars[i];
+                if (slot.var && assigned[i]) {
+                    auto& ent = *slot.entry;
+                    ent.val = regs[i];
+                    ent.evaluated = true;
+                }
+            }
+        }
+
+        void throw_unassigned(const program& prog, std::uint32_t slot)
+        {
+            auto msg = std::string("Variable `") + prog.vars[slot].var->name() + "' used before it is assigned a value!";
+            parser::throw_parser_exception(msg, "", "", "");
+        }
+
+        void execute(const program& prog, value* r, byte* assigned)
+        {
+            const instruction* code = prog.code.data();
+            const value* k = prog.constants.data();
+            std::uint32_t pc = 0;
+            while (true) {
+                const instruction& i = code[pc++];
+                switch (i.op) {
+                    case opcode::LOADK:
+                        r[i.a] = k[i.b];
+                        break;
+                    case opcode::MOVE:
+                        r[i.a] = r[i.b];
+                        break;
+                    case opcode::CHECK:
+                        if (!assigned[i.a]) {
+                            throw_unassigned(prog, i.a);
+                        }
+                        break;
+                    case opcode::DEFINE:
+                        assigned[i.a] = 1;
+                        break;
+                    case opcode::I2D:
+                        r[i.a].dbl_val = static_cast<double>(r[i.b].int_val);
+                        break;
+                    case opcode::D2I:
+                        r[i.a].int_val = static_cast<int>(r[i.b].dbl_val);
+                        break;
+                    case opcode::NEG_I:
+                        r[i.a].int_val = -r[i.b].int_val;
+                        break;
+                    case opcode::NEG_D:
+                        r[i.a].dbl_val = -r[i.b].dbl_val;
+                        break;
+                    case opcode::ADD_I:
+                        r[i.a].int_val = r[i.b].int_val + r[i.c].int_val;
+                        break;
+                    case opcode::ADD_D:
+                        r[i.a].dbl_val = r[i.b].dbl_val + r[i.c].dbl_val;
+                        break;
+                    case opcode::SUB_I:
+                        r[i.a].int_val = r[i.b].int_val - r[i.c].int_val;
+                        break;
+                    case opcode::SUB_D:
+                        r[i.a].dbl_val = r[i.b].dbl_val - r[i.c].dbl_val;
+                        break;
+                    case opcode::MUL_I:
+                        r[i.a].int_val = r[i.b].int_val * r[i.c].int_val;
+                        break;
+                    case opcode::MUL_D:
+                        r[i.a].dbl_val = r[i.b].dbl_val * r[i.c].dbl_val;
+                        break;
+                    case opcode::DIV_I:
+                        r[i.a].int_val = r[i.b].int_val / r[i.c].int_val;
+                        break;
+                    case opcode::DIV_D:
+                        r[i.a].dbl_val = r[i.b].dbl_val / r[i.c].dbl_val;
+                        break;
+                    case opcode::EQ_I:
+                        r[i.a].int_val = (r[i.b].int_val == r[i.c].int_val) ? 1 : 0;
+                        break;
+                    case opcode::EQ_S:
+                        r[i.a].int_val = (::strcmp(r[i.b].str_val, r[i.c].str_val) == 0) ? 1 : 0;
+                        break;
+                    case opcode::JUMP:
+                        pc = i.a;
+                        break;
+                    case opcode::JUMP_DEF:
+                        if (assigned[i.a]) {
+                            pc = i.b;
+                        }
+                        break;
+                    case opcode::JUMP_Z_I:
+                        if (r[i.a].int_val == 0) {
+                            pc = i.b;
+                        }
+                        break;
+                    case opcode::JUMP_Z_D:
+                        if (r[i.a].dbl_val == 0.0) {
+                            pc = i.b;
+                        }
+                        break;
+                    case opcode::JUMP_Z_S:
+                        if (r[i.a].str_val[0] == '\0') {
+                            pc = i.b;
+                        }
+                        break;
+                    case opcode::FAIL:
+                        parser::throw_parser_exception(prog.messages[i.a], "", "", "");
+                        break;
+                    case opcode::HALT:
+                        return;
+                }
+            }
+        }
+
+    }//namespace
+
+    void run(const program& prog)
+    {
+        std::vector<value> regs(prog.num_registers);
+        std::vector<byte> assigned(prog.vars.size(), 0);
+
+        load_variables(prog, regs.data(), assigned.data());
+        try {
+            execute(prog, regs.data(), assigned.data());
+        } catch (...) {
+            // keep the values assigned before the failure visible
+            store_variables(prog, regs.data(), assigned.data());
+            throw;
+        }
+        store_variables(prog, regs.data(), assigned.data());
+    }
+
+}//namespace execution
+}//namespace pcsh
@@ -0,0 +1,165 @@
+/**
+ * \file expression_walker.hpp
+ * \date Oct 17, 2026
+ */
+
+#ifndef PCSH_IR_EXPRESSION_WALKER_HPP
+#define PCSH_IR_EXPRESSION_WALKER_HPP
+
+#include "ir/nodes.hpp"
+
+#include <vector>
+
+#if !defined(PCSH_NOINLINE)
+#  if !defined(_MSC_VER)
+#    define PCSH_NOINLINE __attribute__((noinline))
+#  else
+#    define PCSH_NOINLINE __declspec(noinline)
+#  endif
+#endif
+
+namespace pcsh {
+namespace ir {
+
+    //////////////////////////////////////////////////////////////////////////
+    /// expression_walker
+    //////////////////////////////////////////////////////////////////////////
+
+    // Walks an expression depth first, handing each node the results of its
+    // operands. The first RECURSION_LIMIT levels are walked by recursion,
+    // which is fastest for the usual short expressions; below that the
+    // pending nodes and results are kept on the heap, so the depth of an
+    // expression is limited by memory rather than by the call stack. A chain
+    // like `1+1+...+1' is one long left spine.
+    //
+    // A Handler names its `result' type and has
+    //
+    //   bool enter(const node* n)
+    //       before the operands of n; false skips them and makes n a leaf
+    //   result leaf(const node* n)
+    //   result unary(const node* n, const result& operand)
+    //   result binary(const node* n, const result& left, const result& right)
+    //
+    // Operands are walked left then right. The operand of an assignment is
+    // its right side only, so assignments are unary; the variable is left to
+    // the handler.
+    //
+    // Handlers may start another walk from any of these.
+    class expression_walker
+    {
+      public:
+        expression_walker() : frames_()
+        { }
+
+        // the number of levels walked by recursion
+        static const unsigned RECURSION_LIMIT = 128;
+
+        template <class Handler>
+        typename Handler::result walk(const node* n, Handler& h)
+        {
+            return walk(n, h, 0);
+        }
+      private:
+        struct frame
+        {
+            const node* n;
+            bool binary;
+            bool right;         // right side still to walk
+        };
+
+        std::vector<frame> frames_;
+
+        template <class Handler>
+        typename Handler::result walk(const node* n, Handler& h, unsigned depth)
+        {
+            if (depth == RECURSION_LIMIT) {
+                return walk_deep(n, h);
+            }
+            if (!h.enter(n)) {
+                return h.leaf(n);
+            }
+            ++depth;
+            switch (n->kind()) {
+                case node_kind::UNARY_PLUS:
+                case node_kind::UNARY_MINUS:
+                    return h.unary(n, walk(static_cast<const untyped_unary_op_base*>(n)->operand(), h, depth));
+                case node_kind::BINARY_DIV:
+                case node_kind::BINARY_MINUS:
+                case node_kind::BINARY_MULT:
+                case node_kind::BINARY_PLUS:
+                case node_kind::COMP_EQUALS: {
+                    auto left = walk(static_cast<const untyped_binary_op_base*>(n)->lhs(), h, depth);
+                    return h.binary(n, left, walk(static_cast<const untyped_binary_op_base*>(n)->rhs(), h, depth));
+                }
+                case node_kind::ASSIGN:
+                    return h.unary(n, walk(static_cast<const untyped_binary_op_base*>(n)->rhs(), h, depth));
+                default:
+                    return h.leaf(n);
+            }
+        }
+
+        template <class Handler>
+        PCSH_NOINLINE typename Handler::result walk_deep(const node* n, Handler& h)
+        {
+            // results of the left sides waiting for their right ones
+            std::vector<typename Handler::result> lefts;
+            const auto base = frames_.size();
+            auto r = typename Handler::result();
+            while (true) {
+                // down the left spine, to a leaf or a skipped node
+                while (h.enter(n)) {
+                    switch (n->kind()) {
+                        case node_kind::UNARY_PLUS:
+                        case node_kind::UNARY_MINUS:
+                            frames_.push_back({ n, false, false });
+                            n = static_cast<const untyped_unary_op_base*>(n)->operand();
+                            continue;
+                        case node_kind::BINARY_DIV:
+                        case node_kind::BINARY_MINUS:
+                        case node_kind::BINARY_MULT:
+                        case node_kind::BINARY_PLUS:
+                        case node_kind::COMP_EQUALS:
+                            frames_.push_back({ n, true, true });
+                            n = static_cast<const untyped_binary_op_base*>(n)->lhs();
+                            continue;
+                        case node_kind::ASSIGN:
+                            frames_.push_back({ n, false, false });
+                            n = static_cast<const untyped_binary_op_base*>(n)->rhs();
+                            continue;
+                        default:
+                            break;
+                    }
+                    break;
+                }
+                r = h.leaf(n);
+                // back up to the next right side
+                while (true) {
+                    if (frames_.size() == base) {
+                        return r;
+                    }
+                    auto& f = frames_.back();
+                    if (f.right) {
+                        f.right = false;
+                        lefts.push_back(r);
+                        n = static_cast<const untyped_binary_op_base*>(f.n)->rhs();
+                        break;
+                    }
+                    auto p = f.n;
+                    auto binary = f.binary;
+                    frames_.pop_back();
+                    if (binary) {
+                        auto left = lefts.back();
+                        lefts.pop_back();
+                        r = h.binary(p, left, r);
+                    } else {
+                        r = h.unary(p, r);
+                    }
+                }
+            }
+        }
+    };
+
+}//namespace ir
+}//namespace pcsh
+
+#endif/*PCSH_IR_EXPRESSION_WALKER_HPP*/
@@ -0,0 +1,231 @@
+/**
+ * \file flat_tree.cpp
+ * \date Oct 17, 2026
+ */
+
+#include "pcsh/assert.hpp"
+#include "pcsh/ir_operations.hpp"
+
+#include "ir/expression_walker.hpp"
+#include "ir/flat_tree.hpp"
+#include "ir/nodes.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+namespace pcsh {
+namespace ir {
+
+    namespace {
+
+        template <class T>
+        inline size_t bytes_of(const std::vector<T>& v)
+        {
+            return v.size() * sizeof(T);
+        }
+
+        // most entries an array may hold; see set_flat_tree_limit
+        std::atomic<size_t> max_entries(flat_tree::INDEX_MASK);
+
+        // thrown when an array outgrows its node references
+        struct too_many_nodes
+        { };
+
+        // Statements are flattened with the blocks and if statements being
+        // flattened kept on frames_; expressions with an expression_walker,
+        // which hands each node the refs of its operands.
+        class flattener
+        {
+            friend class ir::expression_walker;
+          public:
+            flattener(flat_tree& t)
+              : tree_(t), frames_(), done_(), walker_(), vars_(), limit_(max_entries.load(std::memory_order_relaxed))
+            { }
+
+            node_ref flatten(const node* n)
+            {
+                const auto base = frames_.size();
+                node_ref r = flat_tree::NO_NODE;
+                while (true) {
+                    switch (n->kind()) {
+                        case node_kind::BLOCK:
+                            frames_.push_back({ n, 0, done_.size(), flat_tree::NO_NODE });
+                            break;
+                        case node_kind::IF_STMT:
+                            frames_.push_back({ n, 0, 0, walker_.walk(static_cast<const if_stmt*>(n)->condition(), *this) });
+                            break;
+                        default:
+                            r = walker_.walk(n, *this);
+                            break;
+                    }
+
+                    // hand `r' to the statement waiting for it, up to one
+                    // that has another to flatten
+                    n = nullptr;
+                    while (!n) {
+                        if (frames_.size() == base) {
+                            return r;
+                        }
+                        auto& f = frames_.back();
+                        if (f.n->kind() == node_kind::BLOCK) {
+                            auto v = static_cast<const block*>(f.n);
+                            if (f.next != 0) {
+                                done_.push_back(r);
+                            }
+                            if (f.next != v->statement_count()) {
+                                n = v->statement(f.next++);
+                            } else {
+                                const auto mark = f.mark;
+                                frames_.pop_back();
+                                r = flatten_block(v, mark);
+                            }
+                        } else if (f.next == 0) {
+                            f.next = 1;
+                            n = static_cast<const if_stmt*>(f.n)->body();
+                        } else {
+                            const auto c = f.cond;
+                            auto v = static_cast<const if_stmt*>(f.n);
+                            frames_.pop_back();
+                            r = flat_tree::make_ref(node_kind::IF_STMT, append(tree_.ifs, flat_tree::if_rec{ c, r, v->condition_type() }));
+                        }
+                    }
+                }
+            }
+          private:
+            typedef node_ref result;
+
+            // a block or if statement being flattened
+            struct frame
+            {
+                const node* n;
+                size_t next;        // statement of a block, or 1 once an if body is flattened
+                size_t mark;        // where the statements of a block start in done_
+                node_ref cond;      // of an if statement
+            };
+
+            flat_tree& tree_;
+            std::vector<frame> frames_;
+            // flattened statements of the blocks on frames_
+            std::vector<node_ref> done_;
+            expression_walker walker_;
+            // variables of the assignments whose right sides are being walked
+            std::vector<std::uint32_t> vars_;
+            size_t limit_;
+
+            template <class T>
+            inline std::uint32_t append(std::vector<T>& v, const T& el)
+            {
+                if (v.size() == limit_) {
+                    throw too_many_nodes();
+                }
+                v.push_back(el);
+                return static_cast<std::uint32_t>(v.size() - 1);
+            }
+
+            std::uint32_t add_variable(const variable* v)
+            {
+                return append(tree_.variables, flat_tree::variable_rec{ v->name(), v->depth(), v->slot() });
+            }
+
+            bool enter(const node* n)
+            {
+                if (n->kind() == node_kind::ASSIGN) {
+                    // the variable is recorded before the right side
+                    vars_.push_back(add_variable(static_cast<const assign*>(n)->var()));
+                }
+                return true;
+            }
+
+            node_ref leaf(const node* n)
+            {
+                switch (n->kind()) {
+                    case node_kind::VARIABLE:
+                        return flat_tree::make_ref(node_kind::VARIABLE, add_variable(static_cast<const variable*>(n)));
+                    case node_kind::INT_CONSTANT:
+                        return flat_tree::make_ref(node_kind::INT_CONSTANT, append(tree_.ints, static_cast<const int_constant*>(n)->value()));
+                    case node_kind::FLOAT_CONSTANT:
+                        return flat_tree::make_ref(node_kind::FLOAT_CONSTANT, append(tree_.floats, static_cast<const float_constant*>(n)->value()));
+                    case node_kind::STRING_CONSTANT:
+                        return flat_tree::make_ref(node_kind::STRING_CONSTANT, append(tree_.strings, static_cast<const string_constant*>(n)->value()));
+                    default:
+                        PCSH_ASSERT_MSG(false, "Statement used as an expression.");
+                        return flat_tree::NO_NODE;
+                }
+            }
+
+            node_ref unary(const node* n, node_ref operand)
+            {
+                if (n->kind() == node_kind::ASSIGN) {
+                    auto var = vars_.back();
+                    vars_.pop_back();
+                    return flat_tree::make_ref(node_kind::ASSIGN, append(tree_.assigns, flat_tree::assign_rec{ var, operand }));
+                }
+                return flat_tree::make_ref(n->kind(), append(tree_.unaries, operand));
+            }
+
+            node_ref binary(const node* n, node_ref l, node_ref r)
+            {
+                if (n->kind() == node_kind::COMP_EQUALS) {
+                    auto type = static_cast<const comp_equals*>(n)->comp_type();
+                    return flat_tree::make_ref(node_kind::COMP_EQUALS, append(tree_.comparisons, flat_tree::comp_rec{ l, r, type }));
+                }
+                return flat_tree::make_ref(n->kind(), append(tree_.binaries, flat_tree::binary_rec{ l, r }));
+            }
+
+            // nested blocks append their own ranges while the statements
+            // are flattened, so the range is appended once they all are
+            node_ref flatten_block(const block* v, size_t mark)
+            {
+                auto first = static_cast<std::uint32_t>(tree_.stmts.size());
+                tree_.stmts.insert(tree_.stmts.end(), done_.begin() + mark, done_.end());
+                auto count = static_cast<std::uint32_t>(done_.size() - mark);
+                done_.resize(mark);
+                return flat_tree::make_ref(node_kind::BLOCK, append(tree_.blocks, flat_tree::block_rec{ first, count, &(v->table()) }));
+            }
+        };
+
+    }//namespace
+
+    size_t flat_tree::size_in_bytes() const
+    {
+        return bytes_of(variables) + bytes_of(ints) + bytes_of(floats) + bytes_of(strings)
+             + bytes_of(unaries) + bytes_of(binaries) + bytes_of(assigns) + bytes_of(comparisons)
+             + bytes_of(blocks) + bytes_of(ifs) + bytes_of(stmts);
+    }
+
+    flat_tree flatten(const tree* ptree)
+    {
+        flat_tree t;
+        flattener f(t);
+        try {
+            t.root = f.flatten(ptree->root());
+        } catch (const too_many_nodes&) {
+            t = flat_tree();
+            t.root = flat_tree::NO_NODE;
+        }
+        return t;
+    }
+
+    const flat_tree* flattened(const tree* ptree)
+    {
+        if (!ptree->flattened()) {
+            // a tree that does not fit is remembered as an empty one
+            auto p = ptree->get_arena().create<flat_tree>(flatten(ptree));
+            ptree->set_flattened(p);
+        }
+        auto p = ptree->flattened();
+        return (p->root != flat_tree::NO_NODE) ? p : nullptr;
+    }
+
+    size_t flat_tree_limit()
+    {
+        return max_entries.load(std::memory_order_relaxed);
+    }
+
+    void set_flat_tree_limit(size_t n)
+    {
+        max_entries.store(std::min<size_t>(n, flat_tree::INDEX_MASK), std::memory_order_relaxed);
+    }
+
+}//namespace ir
+}//namespace pcsh
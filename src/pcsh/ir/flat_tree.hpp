@@ -0,0 +1,122 @@
+/**
+ * \file flat_tree.hpp
+ * \date Oct 17, 2026
+ */
+
+#ifndef PCSH_IR_FLAT_TREE_HPP
+#define PCSH_IR_FLAT_TREE_HPP
+
+#include "pcsh/ir.hpp"
+#include "pcsh/result_type.hpp"
+#include "pcsh/types.hpp"
+
+#include "ir/nodes_fwd.hpp"
+#include "ir/symbol_table.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace pcsh {
+namespace ir {
+
+    //////////////////////////////////////////////////////////////////////////
+    /// flat_tree
+    //////////////////////////////////////////////////////////////////////////
+
+    // Compact form of a validated tree. Nodes live in one array per shape
+    // and refer to their children with 32-bit references that carry the
+    // node kind in the top bits. The statements of a block are a contiguous
+    // range of `stmts', so a block is walked with a plain loop.
+    typedef std::uint32_t node_ref;
+
+    struct flat_tree
+    {
+        static const unsigned INDEX_BITS = 28;
+        static const node_ref INDEX_MASK = (node_ref(1) << INDEX_BITS) - 1;
+        static const node_ref NO_NODE = ~node_ref(0);
+
+        static inline node_ref make_ref(node_kind k, std::uint32_t idx)
+        {
+            return (static_cast<node_ref>(k) << INDEX_BITS) | idx;
+        }
+
+        static inline node_kind kind(node_ref r)
+        {
+            return static_cast<node_kind>(r >> INDEX_BITS);
+        }
+
+        static inline std::uint32_t index(node_ref r)
+        {
+            return r & INDEX_MASK;
+        }
+
+        struct variable_rec
+        {
+            cstring name;
+            std::uint32_t depth;
+            std::uint32_t slot;
+        };
+
+        /// plus, minus, mult and div
+        struct binary_rec
+        {
+            node_ref left;
+            node_ref right;
+        };
+
+        struct assign_rec
+        {
+            std::uint32_t var;  // index into `variables'
+            node_ref right;
+        };
+
+        struct comp_rec
+        {
+            node_ref left;
+            node_ref right;
+            result_type type;
+        };
+
+        struct block_rec
+        {
+            std::uint32_t first;  // index into `stmts'
+            std::uint32_t count;
+            const symbol_table::ptr* table;
+        };
+
+        struct if_rec
+        {
+            node_ref cond;
+            node_ref body;
+            result_type cond_type;
+        };
+
+        std::vector<variable_rec> variables;
+        std::vector<int> ints;
+        std::vector<double> floats;
+        std::vector<cstring> strings;
+        std::vector<node_ref> unaries;  // operand of plus and minus
+        std::vector<binary_rec> binaries;
+        std::vector<assign_rec> assigns;
+        std::vector<comp_rec> comparisons;
+        std::vector<block_rec> blocks;
+        std::vector<if_rec> ifs;
+        std::vector<node_ref> stmts;
+        node_ref root;
+
+        /// bytes used by the node arrays
+        size_t size_in_bytes() const;
+    };
+
+    /// builds the flat form of a validated and resolved tree; its root is
+    /// NO_NODE if an array would pass flat_tree_limit()
+    flat_tree flatten(const tree* ptree);
+
+    /// returns the flat form cached in the tree, building it on first use;
+    /// nullptr if the tree is too large for one
+    const flat_tree* flattened(const tree* ptree);
+
+}//namespace ir
+}//namespace pcsh
+
+#endif/*PCSH_IR_FLAT_TREE_HPP*/
@@ -13,6 +13,7 @@
 #include "ir/visitor.hpp"
 #include "ir/symbol_table.hpp"
 
+#include <algorithm>
 #include <sstream>
 
 // Disable MSVC warnings for dominant method inheritance in
@@ -30,6 +31,9 @@ namespace ir {
 
     class untyped_atom_base : public node
     {
+      public:
+        untyped_atom_base(node_kind k) : node(k)
+        { }
       private:
         node* left_impl() const override
         {
@@ -45,6 +49,9 @@ namespace ir {
     template <class T>
     class atom_base : public untyped_atom_base
     {
+      public:
+        atom_base() : untyped_atom_base(node_kind_of<T>::value)
+        { }
       private:
         void accept_impl(node_visitor* v) const
         {
@@ -57,7 +64,9 @@ namespace ir {
     class variable final : public atom_base<variable>
     {
       public:
-        variable(cstring nm) : name_(nm)
+        // `nm' comes from the tree's string_table; symbol tables compare
+        // names by address
+        variable(cstring nm) : name_(nm), depth_(symbol_table::NO_SLOT), slot_(symbol_table::NO_SLOT)
         { }
 
         inline cstring name() const
@@ -68,9 +77,35 @@ namespace ir {
         inline void set_name(cstring n)
         {
             name_ = n;
+            depth_ = slot_ = symbol_table::NO_SLOT;
+        }
+
+        // nesting depth of the declaring block; valid once resolved
+        inline std::uint32_t depth() const
+        {
+            return depth_;
+        }
+
+        // slot in the declaring block's symbol table; valid once resolved
+        inline std::uint32_t slot() const
+        {
+            return slot_;
+        }
+
+        inline bool resolved() const
+        {
+            return slot_ != symbol_table::NO_SLOT;
+        }
+
+        inline void resolve(std::uint32_t depth, std::uint32_t slot) const
+        {
+            depth_ = depth;
+            slot_ = slot;
         }
       private:
         cstring name_;
+        mutable std::uint32_t depth_;
+        mutable std::uint32_t slot_;
     };
 
     class int_constant final : public atom_base<int_constant>
@@ -120,7 +155,7 @@ namespace ir {
     class untyped_unary_op_base : public node
     {
       public:
-        untyped_unary_op_base() : operand_(nullptr)
+        untyped_unary_op_base(node_kind k) : node(k), operand_(nullptr)
         { }
 
         const node* operand() const
@@ -149,6 +184,9 @@ namespace ir {
     template <class T>
     class unary_op : public untyped_unary_op_base
     {
+      public:
+        unary_op() : untyped_unary_op_base(node_kind_of<T>::value)
+        { }
       private:
         void accept_impl(node_visitor* v) const
         {
@@ -167,7 +205,7 @@ namespace ir {
     class untyped_binary_op_base : public node
     {
       public:
-        untyped_binary_op_base() : left_(nullptr), right_(nullptr)
+        untyped_binary_op_base(node_kind k) : node(k), left_(nullptr), right_(nullptr)
         { }
 
         void set_left(node* n)
@@ -180,6 +218,17 @@ namespace ir {
             right_ = n;
         }
 
+        // left() and right() without the virtual call
+        inline node* lhs() const
+        {
+            return left_;
+        }
+
+        inline node* rhs() const
+        {
+            return right_;
+        }
+
       protected:
         node* left_;
         node* right_;
@@ -198,6 +247,9 @@ namespace ir {
     template <class T>
     class binary_op : public untyped_binary_op_base
     {
+      public:
+        binary_op() : untyped_binary_op_base(node_kind_of<T>::value)
+        { }
       private:
         void accept_impl(node_visitor* v) const
         {
@@ -222,7 +274,7 @@ namespace ir {
       public:
         inline variable* var() const
         {
-            PCSH_ASSERT_MSG(dynamic_cast<variable*>(left_) != nullptr, "Assignment node left must be a variable.");
+            PCSH_ASSERT_MSG(left_->kind() == node_kind::VARIABLE, "Assignment node left must be a variable.");
             return reinterpret_cast<variable*>(left_);
         }
     };
@@ -251,14 +303,7 @@ namespace ir {
     class block final : public atom_base<block>
     {
       public:
-        struct list_node
-        {
-            list_node* next;
-            const node* entry;
-        };
-
-      public:
-        block(arena& ar) : arena_(ar), head_(nullptr), symtab_(symbol_table::make_new())
+        block(arena& ar) : arena_(ar), stmts_(nullptr), count_(0), symtab_(ar)
         { }
 
         inline void insert(ir::variable* v, ir::node* value) const
@@ -271,16 +316,49 @@ namespace ir {
             return symtab_;
         }
 
-        void push_front_statement(node* n)
+        // statements are one array in the arena, in program order
+
+        inline size_t statement_count() const
+        {
+            return count_;
+        }
+
+        inline node* statement(size_t i) const
         {
-            auto newstmt = arena_.create<list_node>();
-            *newstmt = { head_, n };
-            head_ = newstmt;
+            PCSH_ASSERT_MSG(i < count_, "Statement index out of range.");
+            return stmts_[i];
         }
 
-        list_node* head() const
+        inline node* const* begin() const
         {
-            return head_;
+            return stmts_;
+        }
+
+        inline node* const* end() const
+        {
+            return stmts_ + count_;
+        }
+
+        // replaces the statements with a copy of [first, first + n)
+        void assign_statements(node* const* first, size_t n)
+        {
+            stmts_ = arena_.create_array<node*>(n);
+            std::copy(first, first + n, stmts_);
+            count_ = n;
+        }
+
+        // drops the statements `pred' holds for, keeping the others in
+        // order; `pred' sees each statement once, first to last
+        template <class Pred>
+        void remove_statements_if(Pred pred)
+        {
+            size_t kept = 0;
+            for (size_t i = 0; i != count_; ++i) {
+                if (!pred(stmts_[i])) {
+                    stmts_[kept++] = stmts_[i];
+                }
+            }
+            count_ = kept;
         }
 
         arena& get_arena() const
@@ -290,7 +368,8 @@ namespace ir {
 
       private:
         arena& arena_;
-        list_node* head_;
+        node** stmts_;
+        size_t count_;
         symbol_table::ptr symtab_;
     };
 
@@ -337,6 +416,32 @@ namespace ir {
     };
 
 }//namespace ir
+
+    // Nodes own nothing; only their virtual destructor is non-trivial, so
+    // the arena need not track them. A block's symbol table lives in the
+    // same arena.
+#define PCSH_NODE_SKIPS_DESTRUCTOR(T)                                  \
+    template <>                                                        \
+    struct arena_skips_destructor<ir::T> : public std::true_type       \
+    { }
+
+    PCSH_NODE_SKIPS_DESTRUCTOR(variable);
+    PCSH_NODE_SKIPS_DESTRUCTOR(int_constant);
+    PCSH_NODE_SKIPS_DESTRUCTOR(float_constant);
+    PCSH_NODE_SKIPS_DESTRUCTOR(string_constant);
+    PCSH_NODE_SKIPS_DESTRUCTOR(unary_plus);
+    PCSH_NODE_SKIPS_DESTRUCTOR(unary_minus);
+    PCSH_NODE_SKIPS_DESTRUCTOR(binary_plus);
+    PCSH_NODE_SKIPS_DESTRUCTOR(binary_minus);
+    PCSH_NODE_SKIPS_DESTRUCTOR(binary_mult);
+    PCSH_NODE_SKIPS_DESTRUCTOR(binary_div);
+    PCSH_NODE_SKIPS_DESTRUCTOR(assign);
+    PCSH_NODE_SKIPS_DESTRUCTOR(comp_equals);
+    PCSH_NODE_SKIPS_DESTRUCTOR(if_stmt);
+    PCSH_NODE_SKIPS_DESTRUCTOR(block);
+
+#undef PCSH_NODE_SKIPS_DESTRUCTOR
+
 }//namespace pcsh
 
 #if defined(_MSC_VER)
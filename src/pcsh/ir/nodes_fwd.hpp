@@ -6,6 +6,8 @@
 #ifndef PCSH_IR_NODES_FWD_HPP
 #define PCSH_IR_NODES_FWD_HPP
 
+#include "pcsh/ir.hpp"
+
 namespace pcsh {
 namespace ir {
 
@@ -42,6 +44,22 @@ namespace ir {
     // keyword statements
     class if_stmt;
 
+    template <class T> struct node_kind_of;
+    template <> struct node_kind_of<variable> { static const auto value = node_kind::VARIABLE; };
+    template <> struct node_kind_of<int_constant> { static const auto value = node_kind::INT_CONSTANT; };
+    template <> struct node_kind_of<float_constant> { static const auto value = node_kind::FLOAT_CONSTANT; };
+    template <> struct node_kind_of<string_constant> { static const auto value = node_kind::STRING_CONSTANT; };
+    template <> struct node_kind_of<unary_plus> { static const auto value = node_kind::UNARY_PLUS; };
+    template <> struct node_kind_of<unary_minus> { static const auto value = node_kind::UNARY_MINUS; };
+    template <> struct node_kind_of<binary_div> { static const auto value = node_kind::BINARY_DIV; };
+    template <> struct node_kind_of<binary_minus> { static const auto value = node_kind::BINARY_MINUS; };
+    template <> struct node_kind_of<binary_mult> { static const auto value = node_kind::BINARY_MULT; };
+    template <> struct node_kind_of<binary_plus> { static const auto value = node_kind::BINARY_PLUS; };
+    template <> struct node_kind_of<assign> { static const auto value = node_kind::ASSIGN; };
+    template <> struct node_kind_of<comp_equals> { static const auto value = node_kind::COMP_EQUALS; };
+    template <> struct node_kind_of<block> { static const auto value = node_kind::BLOCK; };
+    template <> struct node_kind_of<if_stmt> { static const auto value = node_kind::IF_STMT; };
+
 }//namespace ir
 }//namespace pcsh
 
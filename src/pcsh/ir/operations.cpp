@@ -6,11 +6,16 @@
 #include "pcsh/ir.hpp"
 #include "pcsh/ir_operations.hpp"
 
+#include "execution/bytecode.hpp"
+#include "execution/closures.hpp"
+#include "execution/flat_interpreter.hpp"
 #include "execution/interpreter.hpp"
+#include "ir/flat_tree.hpp"
 #include "ir/nodes.hpp"
 #include "ir/ops/printer.hpp"
 #include "ir/ops/tree_cloner.hpp"
 #include "ir/ops/variable_printer.hpp"
+#include "ir/passes/resolve_variables.hpp"
 #include "ir/symbol_table.hpp"
 
 namespace pcsh {
@@ -19,7 +24,7 @@ namespace ir {
     void print(const tree* ptree, ostream& os, bool types)
     {
         printer p(os, types);
-        ptree->accept(&p);
+        p.visit(ptree->root());
     }
 
     void print_variables(const tree* ptree, ostream& os)
@@ -31,34 +36,69 @@ namespace ir {
     tree::ptr clone(const tree* ptree)
     {
         tree_cloner c;
-        ptree->accept(&c);
-        return std::move(c.cloned_tree());
+        c.visit(ptree->root());
+        auto p = c.cloned_tree();
+        {// the cloned variables are new nodes with their own slots
+            resolve_variables resolver;
+            resolver.visit(p->root());
+        }
+        return p;
     }
 
-    void evaluate(const tree* ptree)
+    void evaluate(const tree* ptree, evaluator ev)
     {
-        execution::interpreter e;
-        ptree->accept(&e);
+        switch (ev) {
+            case evaluator::TREE_WALKER: {
+                execution::interpreter e;
+                e.visit(ptree->root());
+                break;
+            }
+            case evaluator::FLAT_TREE: {
+                if (auto flat = flattened(ptree)) {
+                    execution::run(*flat);
+                } else {// too large for node references
+                    execution::run(*execution::compiled_program(ptree));
+                }
+                break;
+            }
+            case evaluator::BYTECODE: {
+                execution::run(*execution::compiled_program(ptree));
+                break;
+            }
+            case evaluator::CLOSURE: {
+                execution::run(*execution::compiled_closures(ptree));
+                break;
+            }
+        }
     }
 
     var_value query(const tree* ptree, cstring name)
     {
         struct sym_list_extractor : public node_visitor
         {
-            sym_table_list tablist;
+            scope_stack tablist;
           private:
-            void visit_impl(const block* v) override
+            void enter_block(const block* v) override
             {
                 tablist.push_back(&(v->table()));
-                visit_block(v);
             }
         };
 
         sym_list_extractor xtrac;
         ptree->accept(&xtrac);
+        // tables hold interned names; find this tree's copy of `name'
+        cstring interned = nullptr;
+        for (auto tbl : xtrac.tablist) {
+            if ((interned = symbol_table::find_name(*tbl, name)) != nullptr) {
+                break;
+            }
+        }
         variable_accessor acc(xtrac.tablist);
-        variable v(name);
-        auto res = acc.lookup(&v);
+        variable v(interned);
+        symbol_table::entry res = { nullptr, result_type::UNDETERMINED, false };
+        if (interned) {
+            res = acc.lookup(&v);
+        }
 
         var_value rv;
         rv.type = result_type::FAILED;
@@ -67,13 +107,13 @@ namespace ir {
             rv.type = res.type;
             switch (res.type) {
                 case result_type::INTEGER:
-                    rv.int_val = static_cast<int_constant*>(res.ptr)->value();
+                    rv.int_val = res.val.int_val;
                     break;
                 case result_type::FLOATING:
-                    rv.dbl_val = static_cast<float_constant*>(res.ptr)->value();
+                    rv.dbl_val = res.val.dbl_val;
                     break;
                 case result_type::STRING:
-                    rv.str_val = static_cast<string_constant*>(res.ptr)->value();
+                    rv.str_val = res.val.str_val;
                     break;
                 default:
                     rv.type = result_type::FAILED;
@@ -22,133 +22,104 @@ namespace ir {
         print_spacing();
     }
 
-    void printer::visit_impl(const variable* v)
+    void printer::print_expr(const node* v)
     {
-        strm_ << "<var:" << v->name() << ">";
+        expr_ = v;
+        walker_.walk(v, *this);
     }
 
-    void printer::visit_impl(const int_constant* v)
+    bool printer::enter(const node* n)
     {
-        strm_ << "<int:";
-        print(strm_, v) << ">";
-    }
-
-    void printer::visit_impl(const float_constant* v)
-    {
-        strm_ << "<double:";
-        print(strm_, v) << ">";
-    }
-
-    void printer::visit_impl(const string_constant* v)
-    {
-        strm_ << "<string:\"";
-        print(strm_, v) << "\">";
-    }
-
-    void printer::visit_impl(const unary_plus* v)
-    {
-        strm_ << "(un-plus ";
-        v->operand()->accept(this);
-        strm_ << ")";
-    }
-
-    void printer::visit_impl(const unary_minus* v)
-    {
-        strm_ << "(un-minus ";
-        v->operand()->accept(this);
-        strm_ << ")";
-    }
-
-    void printer::visit_impl(const binary_div* v)
-    {
-        strm_ << "(divide ";
-        v->left()->accept(this);
-        strm_ << " ";
-        v->right()->accept(this);
-        strm_ << ")";
-    }
-
-    void printer::visit_impl(const binary_minus* v)
-    {
-        strm_ << "(minus ";
-        v->left()->accept(this);
-        strm_ << " ";
-        v->right()->accept(this);
-        strm_ << ")";
-    }
-
-    void printer::visit_impl(const binary_mult* v)
-    {
-        strm_ << "(mult ";
-        v->left()->accept(this);
-        strm_ << " ";
-        v->right()->accept(this);
-        strm_ << ")";
+        if (n != expr_) {
+            strm_ << " ";
+        }
+        switch (n->kind()) {
+            case node_kind::VARIABLE:
+                strm_ << "<var:" << static_cast<const variable*>(n)->name() << ">";
+                break;
+            case node_kind::INT_CONSTANT:
+                strm_ << "<int:";
+                print(strm_, static_cast<const int_constant*>(n)) << ">";
+                break;
+            case node_kind::FLOAT_CONSTANT:
+                strm_ << "<double:";
+                print(strm_, static_cast<const float_constant*>(n)) << ">";
+                break;
+            case node_kind::STRING_CONSTANT:
+                strm_ << "<string:\"";
+                print(strm_, static_cast<const string_constant*>(n)) << "\">";
+                break;
+            case node_kind::UNARY_PLUS:
+                strm_ << "(un-plus";
+                break;
+            case node_kind::UNARY_MINUS:
+                strm_ << "(un-minus";
+                break;
+            case node_kind::BINARY_DIV:
+                strm_ << "(divide";
+                break;
+            case node_kind::BINARY_MINUS:
+                strm_ << "(minus";
+                break;
+            case node_kind::BINARY_MULT:
+                strm_ << "(mult";
+                break;
+            case node_kind::BINARY_PLUS:
+                strm_ << "(plus";
+                break;
+            case node_kind::ASSIGN:
+                strm_ << "(assign <var:" << static_cast<const assign*>(n)->var()->name() << ">";
+                break;
+            case node_kind::COMP_EQUALS:
+                strm_ << "(eq";
+                break;
+            default:
+                PCSH_ASSERT_MSG(false, "Statement printed as an expression.");
+                break;
+        }
+        return true;
     }
 
-    void printer::visit_impl(const binary_plus* v)
+    void printer::enter_block(const block* v)
     {
-        strm_ << "(plus ";
-        v->left()->accept(this);
-        strm_ << " ";
-        v->right()->accept(this);
-        strm_ << ")";
+        strm_ << "(block) at " << v;
+        print_types(v);
+        ++nesting_;
+        print_spacing_newline();
     }
 
-    void printer::visit_impl(const assign* v)
+    void printer::after_statement(const block* v, size_t i)
     {
-        strm_ << "(assign ";
-        this->visit(v->var()); //optimize
-        strm_ << " ";
-        v->right()->accept(this);
-        strm_ << ")";
+        if (i + 1 != v->statement_count()) {
+            strm_ << "\n";
+            print_spacing();
+        }
     }
 
-    void printer::visit_impl(const block* v)
+    void printer::leave_block(const block* v)
     {
-        {
-            strm_ << "(block) at " << v;
-            print_types(v);
-            ++nesting_;
-            print_spacing_newline();
-            visit_block_postcbk(v,
-                [this](const node* a, bool islast) -> void {
-                    if (!islast) {
-                        strm_ << "\n";
-                        print_spacing();
-                    }
-                });
-            --nesting_;
-        }
+        --nesting_;
 
         if (nesting_ == 0) {
             strm_ << "\n";
         }
     }
 
-    void printer::visit_impl(const if_stmt* v)
+    bool printer::enter_if(const if_stmt* v)
     {
         strm_ << "(if-cond-body ";
-        v->condition()->accept(this);
+        visit(v->condition());
         strm_ << " ";
-        auto b = v->body();
         ++nesting_;
-        if (dynamic_cast<block*>(b)) {
+        if (v->body()->kind() == node_kind::BLOCK) {
             print_spacing_newline();
-            b->accept(this);
-        } else {
-            b->accept(this);
         }
-        --nesting_;
-        strm_ << ")";
+        return true;
     }
 
-    void printer::visit_impl(const comp_equals* v)
+    void printer::leave_if(const if_stmt* v)
     {
-        strm_ << "(eq ";
-        v->left()->accept(this);
-        strm_ << " ";
-        v->right()->accept(this);
+        --nesting_;
         strm_ << ")";
     }
 
@@ -8,7 +8,8 @@
 
 #include "pcsh/ostream.hpp"
 
-#include "ir/visitor.hpp"
+#include "ir/expression_walker.hpp"
+#include "ir/static_visitor.hpp"
 
 namespace pcsh {
 namespace ir {
@@ -21,31 +22,56 @@ namespace ir {
 
     ostream& print(ostream& os, const string_constant* v);
 
-    class printer final : public node_visitor
+    class printer final : public static_visitor<printer>
     {
+        friend class static_visitor<printer>;
+        friend class expression_walker;
       public:
-        printer(ostream& os, bool types) : strm_(os), nesting_(0), types_(types)
+        printer(ostream& os, bool types) : strm_(os), nesting_(0), types_(types), walker_(), expr_(nullptr)
         { }
       private:
         ostream& strm_;
         int nesting_;
         bool types_;
+        expression_walker walker_;
+        const node* expr_;      // root of the expression being printed
 
-        void visit_impl(const variable* v) override;
-        void visit_impl(const int_constant* v) override;
-        void visit_impl(const float_constant* v) override;
-        void visit_impl(const string_constant* v) override;
-        void visit_impl(const unary_plus* v) override;
-        void visit_impl(const unary_minus* v) override;
-        void visit_impl(const binary_div* v) override;
-        void visit_impl(const binary_minus* v) override;
-        void visit_impl(const binary_mult* v) override;
-        void visit_impl(const binary_plus* v) override;
-        void visit_impl(const assign* v) override;
-        void visit_impl(const comp_equals* v) override;
-        void visit_impl(const block* v) override;
-        void visit_impl(const if_stmt* v) override;
+        template <class Expr>
+        void visit_impl(const Expr* v)
+        {
+            print_expr(v);
+        }
 
+        void enter_block(const block* v);
+        void after_statement(const block* v, size_t i);
+        void leave_block(const block* v);
+        bool enter_if(const if_stmt* v);
+        void leave_if(const if_stmt* v);
+
+        // nothing flows between the nodes of an expression here
+        typedef bool result;
+
+        // operands are separated from what precedes them by a space
+        bool enter(const node* n);
+
+        bool leaf(const node*)
+        {
+            return true;
+        }
+
+        bool unary(const node*, bool)
+        {
+            strm_ << ")";
+            return true;
+        }
+
+        bool binary(const node*, bool, bool)
+        {
+            strm_ << ")";
+            return true;
+        }
+
+        void print_expr(const node* v);
         void print_types(const block* v);
         void print_spacing_newline();
         void print_spacing();
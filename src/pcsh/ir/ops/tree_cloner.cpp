@@ -10,189 +10,144 @@
 namespace pcsh {
 namespace ir {
 
-    void tree_cloner::visit_impl(const variable* v)
+    variable* tree_cloner::clone_variable(const variable* v)
     {
-        auto& ar = root_->get_arena();
-        cloned_ = ar.create<variable>(ar.create_string(v->name()));
+        auto& ar = tree_->get_arena();
+        return ar.create<variable>(strings_.intern(v->name(), string_table::length_of(v->name())));
     }
 
-    void tree_cloner::visit_impl(const int_constant* v)
+    template <class T>
+    node* tree_cloner::clone_unary(node* operand)
     {
-        auto& ar = root_->get_arena();
-        cloned_ = ar.create<int_constant>(v->value());
+        auto& ar = tree_->get_arena();
+        auto op = ar.create<T>();
+        op->set_operand(operand);
+        return op;
     }
 
-    void tree_cloner::visit_impl(const float_constant* v)
+    template <class T>
+    node* tree_cloner::clone_binary(node* newleft, node* newright)
     {
-        auto& ar = root_->get_arena();
-        cloned_ = ar.create<float_constant>(v->value());
+        auto& ar = tree_->get_arena();
+        auto op = ar.create<T>();
+        op->set_left(newleft);
+        op->set_right(newright);
+        return op;
     }
 
-    void tree_cloner::visit_impl(const string_constant* v)
+    node* tree_cloner::leaf(const node* n)
     {
-        auto& ar = root_->get_arena();
-        cloned_ = ar.create<string_constant>(ar.create_string(v->value()));
-    }
-
-    void tree_cloner::visit_impl(const unary_plus* v)
-    {
-        v->operand()->accept(this);
-        auto newoperand = cloned_;
-
-        auto& ar = root_->get_arena();
-        auto newuplus = ar.create<unary_plus>();
-        newuplus->set_operand(newoperand);
-        cloned_ = newuplus;
+        auto& ar = tree_->get_arena();
+        switch (n->kind()) {
+            case node_kind::VARIABLE:
+                return clone_variable(static_cast<const variable*>(n));
+            case node_kind::INT_CONSTANT:
+                return ar.create<int_constant>(static_cast<const int_constant*>(n)->value());
+            case node_kind::FLOAT_CONSTANT:
+                return ar.create<float_constant>(static_cast<const float_constant*>(n)->value());
+            case node_kind::STRING_CONSTANT: {
+                auto val = static_cast<const string_constant*>(n)->value();
+                return ar.create<string_constant>(strings_.intern(val, string_table::length_of(val)));
+            }
+            default:
+                PCSH_ASSERT_MSG(false, "Statement cloned as an expression.");
+                return nullptr;
+        }
     }
 
-    void tree_cloner::visit_impl(const unary_minus* v)
+    node* tree_cloner::unary(const node* n, node* operand)
     {
-        v->operand()->accept(this);
-        auto newoperand = cloned_;
-
-        auto& ar = root_->get_arena();
-        auto newuminus = ar.create<unary_minus>();
-        newuminus->set_operand(newoperand);
-        cloned_ = newuminus;
-    }
+        switch (n->kind()) {
+            case node_kind::UNARY_PLUS:
+                return clone_unary<unary_plus>(operand);
+            case node_kind::UNARY_MINUS:
+                return clone_unary<unary_minus>(operand);
+            default: {
+                auto v = static_cast<const assign*>(n);
+                auto newvar = clone_variable(v->var());
+
+                auto newasgn = tree_->get_arena().create<assign>();
+                newasgn->set_left(newvar);
+                newasgn->set_right(operand);
+
+                // declared in the clone of the declaring block; an
+                // undeclared condition assignment declares nothing
+                auto var = v->var();
+                if (var->resolved()) {
+                    auto ty = symbol_table::at(*scopes_[var->depth()], var->slot()).type;
+                    symbol_table::set(blocks_[var->depth()]->table(), newvar, operand, ty);
+                }
 
-    void tree_cloner::visit_impl(const binary_div* v)
-    {
-        v->left()->accept(this);
-        auto newleft = cloned_;
-        v->right()->accept(this);
-        auto newright = cloned_;
-
-        auto& ar = root_->get_arena();
-        auto newbinop = ar.create<binary_div>();
-        newbinop->set_left(newleft);
-        newbinop->set_right(newright);
-        cloned_ = newbinop;
+                return newasgn;
+            }
+        }
     }
 
-    void tree_cloner::visit_impl(const binary_minus* v)
+    node* tree_cloner::binary(const node* n, node* newleft, node* newright)
     {
-        v->left()->accept(this);
-        auto newleft = cloned_;
-        v->right()->accept(this);
-        auto newright = cloned_;
-
-        auto& ar = root_->get_arena();
-        auto newbinop = ar.create<binary_minus>();
-        newbinop->set_left(newleft);
-        newbinop->set_right(newright);
-        cloned_ = newbinop;
+        switch (n->kind()) {
+            case node_kind::BINARY_DIV:
+                return clone_binary<binary_div>(newleft, newright);
+            case node_kind::BINARY_MINUS:
+                return clone_binary<binary_minus>(newleft, newright);
+            case node_kind::BINARY_MULT:
+                return clone_binary<binary_mult>(newleft, newright);
+            case node_kind::BINARY_PLUS:
+                return clone_binary<binary_plus>(newleft, newright);
+            default: {
+                auto op = static_cast<comp_equals*>(clone_binary<comp_equals>(newleft, newright));
+                op->set_comp_type(static_cast<const comp_equals*>(n)->comp_type());
+                return op;
+            }
+        }
     }
 
-    void tree_cloner::visit_impl(const binary_mult* v)
+    void tree_cloner::enter_block(const block* v)
     {
-        v->left()->accept(this);
-        auto newleft = cloned_;
-        v->right()->accept(this);
-        auto newright = cloned_;
-
-        auto& ar = root_->get_arena();
-        auto newbinop = ar.create<binary_mult>();
-        newbinop->set_left(newleft);
-        newbinop->set_right(newright);
-        cloned_ = newbinop;
+        arena& ar = tree_->get_arena();
+        scopes_.push_back(&(v->table()));
+        blocks_.push_back(ar.create<block>(ar));
+        firsts_.push_back(out_stmts_.size());
     }
 
-    void tree_cloner::visit_impl(const binary_plus* v)
+    void tree_cloner::after_statement(const block* v, size_t i)
     {
-        v->left()->accept(this);
-        auto newleft = cloned_;
-        v->right()->accept(this);
-        auto newright = cloned_;
-
-        auto& ar = root_->get_arena();
-        auto newbinop = ar.create<binary_plus>();
-        newbinop->set_left(newleft);
-        newbinop->set_right(newright);
-        cloned_ = newbinop;
+        out_stmts_.push_back(cloned_);
     }
 
-    void tree_cloner::visit_impl(const assign* v)
+    void tree_cloner::leave_block(const block* v)
     {
-        v->var()->accept(this);
-        auto newvar = reinterpret_cast<variable*>(cloned_);
-        v->right()->accept(this);
-        auto newval = cloned_;
-
-        auto& ar = root_->get_arena();
-        auto newasgn = ar.create<assign>();
-        newasgn->set_left(newvar);
-        newasgn->set_right(newval);
-
-        auto ty = symbol_table::lookup(curr_->table(), v->var()).type;
-        symbol_table::set(root_->table(), newvar, newval, ty);
-
-        cloned_ = newasgn;
+        auto b = blocks_.back();
+        const auto first = firsts_.back();
+        b->assign_statements(out_stmts_.data() + first, out_stmts_.size() - first);
+        out_stmts_.resize(first);
+        scopes_.pop_back();
+        blocks_.pop_back();
+        firsts_.pop_back();
+
+        // a nested block is the clone its parent collects
+        cloned_ = b;
+        if (blocks_.empty()) {
+            root_ = b;
+        }
     }
 
-    void tree_cloner::visit_impl(const block* v)
+    bool tree_cloner::enter_if(const if_stmt* v)
     {
-        auto oldblk = curr_;
-        auto oldstmts = out_stmts_;
-        auto oldroot = root_;
-        auto oldcloned = cloned_;
-
-        {// visit this block
-            arena& ar = tree_->get_arena();
-
-            curr_ = v;
-            out_stmts_.clear();
-            root_ = ar.create<block>(ar);
-            cloned_ = nullptr;
-
-            visit_block_postcbk(v,
-                [this] (const node* a, bool) -> void {
-                    out_stmts_.push_back(cloned_);
-                });
-
-            {// make a block out of all statements
-                auto beg = out_stmts_.rbegin();
-                const auto end = out_stmts_.rend();
-                for (; beg != end; ++beg) {
-                    root_->push_front_statement(*beg);
-                }
-            }
-        }
-
-        curr_ = oldblk;
-        out_stmts_ = std::move(oldstmts);
-        if (oldroot != nullptr) {
-            root_ = oldroot;
-        }
-        cloned_ = oldcloned;
+        visit(v->condition());
+        conds_.push_back(cloned_);
+        return true;
     }
 
-    void tree_cloner::visit_impl(const if_stmt* v)
+    void tree_cloner::leave_if(const if_stmt* v)
     {
-        v->condition()->accept(this);
-        auto cclone = cloned_;
-        v->body()->accept(this);
-        auto bclone = cloned_;
         arena& ar = tree_->get_arena();
-        auto ifs = ar.create<if_stmt>(cclone, bclone);
+        auto ifs = ar.create<if_stmt>(conds_.back(), cloned_);
         ifs->set_condition_type(v->condition_type());
+        conds_.pop_back();
         cloned_ = ifs;
     }
 
-    void tree_cloner::visit_impl(const comp_equals* v)
-    {
-        v->left()->accept(this);
-        auto newleft = cloned_;
-        v->right()->accept(this);
-        auto newright = cloned_;
-
-        auto& ar = root_->get_arena();
-        auto newbinop = ar.create<comp_equals>();
-        newbinop->set_left(newleft);
-        newbinop->set_right(newright);
-        cloned_ = newbinop;
-    }
-
     tree::ptr tree_cloner::cloned_tree()
     {
         tree_->set_root(root_);
@@ -6,20 +6,35 @@
 #ifndef PCSH_TREE_CLONER_HPP
 #define PCSH_TREE_CLONER_HPP
 
-#include "ir/visitor.hpp"
+#include "ir/expression_walker.hpp"
+#include "ir/static_visitor.hpp"
+#include "ir/string_table.hpp"
+#include "ir/symbol_table.hpp"
+
+#include <vector>
 
 namespace pcsh {
 namespace ir {
 
-    class tree_cloner final : public node_visitor
+    class tree_cloner final : public static_visitor<tree_cloner>
     {
+        friend class static_visitor<tree_cloner>;
+        friend class expression_walker;
       public:
-        tree_cloner() : curr_(nullptr), tree_(tree::create()), root_(nullptr), out_stmts_(), cloned_(nullptr)
+        tree_cloner()
+          : scopes_(), blocks_(), firsts_(), conds_(), tree_(tree::create()), root_(nullptr), out_stmts_(), cloned_(nullptr)
+          , scratch_(), strings_(tree_->get_arena(), scratch_), walker_()
         { }
 
         tree::ptr cloned_tree();
       private:
-        const block* curr_;
+        // tables of the blocks being cloned, and their clones
+        scope_stack scopes_;
+        std::vector<block*> blocks_;
+        // where the statements of each of `blocks_' start in `out_stmts_'
+        std::vector<size_t> firsts_;
+        // cloned conditions of the if statements being cloned
+        std::vector<node*> conds_;
 
         tree::ptr tree_;
         block* root_;
@@ -27,20 +42,41 @@ namespace ir {
 
         node* cloned_;
 
-        void visit_impl(const variable* v) override;
-        void visit_impl(const int_constant* v) override;
-        void visit_impl(const float_constant* v) override;
-        void visit_impl(const string_constant* v) override;
-        void visit_impl(const unary_plus* v) override;
-        void visit_impl(const unary_minus* v) override;
-        void visit_impl(const binary_div* v) override;
-        void visit_impl(const binary_minus* v) override;
-        void visit_impl(const binary_mult* v) override;
-        void visit_impl(const binary_plus* v) override;
-        void visit_impl(const assign* v) override;
-        void visit_impl(const comp_equals* v) override;
-        void visit_impl(const block* v) override;
-        void visit_impl(const if_stmt* v) override;
+        arena scratch_;
+        string_table strings_;
+
+        expression_walker walker_;
+
+        template <class Expr>
+        void visit_impl(const Expr* v)
+        {
+            cloned_ = walker_.walk(v, *this);
+        }
+
+        void enter_block(const block* v);
+        void after_statement(const block* v, size_t i);
+        void leave_block(const block* v);
+        bool enter_if(const if_stmt* v);
+        void leave_if(const if_stmt* v);
+
+        // the walk hands each node the clones of its operands
+        typedef node* result;
+
+        bool enter(const node*)
+        {
+            return true;
+        }
+
+        node* leaf(const node* n);
+        node* unary(const node* n, node* operand);
+        node* binary(const node* n, node* newleft, node* newright);
+
+        variable* clone_variable(const variable* v);
+
+        template <class T>
+        node* clone_unary(node* operand);
+        template <class T>
+        node* clone_binary(node* newleft, node* newright);
     };
 
 }//namespace ir
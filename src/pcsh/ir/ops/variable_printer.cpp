@@ -10,7 +10,7 @@
 namespace pcsh {
 namespace ir {
 
-    void var_value_printer::visit_impl(const block* v)
+    void var_value_printer::enter_block(const block* v)
     {
         if (!prn_) {
             prn_ = new printer(strm_, true);
@@ -20,39 +20,63 @@ namespace ir {
 
         strm_ << "(block) at " << v;
 
-        auto oldtbl = tbl_;
         ++nesting_;
         print_spacing();
-        tbl_ = &v->table();
-        {// visit this block
-            {// print this block
-                auto nv = symbol_table::all_entries(*tbl_);
-                variable tmp(nullptr);
-                for (const auto& el : nv) {
-                    tmp.set_name(el.name);
-                    strm_ << "\n";
-                    print_spacing();
-                    tmp.accept(prn_);
-                    strm_ << " -> ";
-                    if (el.evaluated) {
-                        symbol_table::lookup((*tbl_), &tmp).ptr->accept(prn_);
-                    } else {
-                        strm_ << "<unassigned>";
-                    }
+        {// print this block
+            const auto& tbl = v->table();
+            auto nv = symbol_table::all_entries(tbl);
+            variable tmp(nullptr);
+            std::uint32_t slot = 0;
+            for (const auto& el : nv) {
+                tmp.set_name(el.name);
+                strm_ << "\n";
+                print_spacing();
+                prn_->visit(&tmp);
+                strm_ << " -> ";
+                if (el.evaluated) {
+                    print_value(symbol_table::at(tbl, slot));
+                } else {
+                    strm_ << "<unassigned>";
                 }
+                ++slot;
             }
-            visit_block(v);
         }
+    }
 
+    void var_value_printer::leave_block(const block* v)
+    {
         --nesting_;
-        tbl_ = oldtbl;
 
-        if (tbl_ == nullptr) {
+        if (nesting_ == 0) {
             // print ending new line
             strm_ << "\n";
         }
     }
 
+    void var_value_printer::print_value(const symbol_table::entry& e) const
+    {
+        switch (e.type) {
+            case result_type::INTEGER: {
+                int_constant c(e.val.int_val);
+                prn_->visit(&c);
+                break;
+            }
+            case result_type::FLOATING: {
+                float_constant c(e.val.dbl_val);
+                prn_->visit(&c);
+                break;
+            }
+            case result_type::STRING: {
+                string_constant c(e.val.str_val);
+                prn_->visit(&c);
+                break;
+            }
+            default:
+                strm_ << "<unassigned>";
+                break;
+        }
+    }
+
     void var_value_printer::print_spacing() const
     {
         for (int i = 0; i != nesting_; ++i) {
@@ -16,7 +16,7 @@ namespace ir {
     class var_value_printer final : public node_visitor
     {
       public:
-        var_value_printer(ostream& os) : strm_(os), nesting_(0), tbl_(nullptr), prn_(nullptr)
+        var_value_printer(ostream& os) : strm_(os), nesting_(0), prn_(nullptr)
         { }
 
         ~var_value_printer()
@@ -28,10 +28,12 @@ namespace ir {
       private:
         ostream& strm_;
         int nesting_;
-        const symbol_table::ptr* tbl_;
-        node_visitor* prn_;
+        printer* prn_;
 
-        void visit_impl(const block* v) override;
+        void enter_block(const block* v) override;
+        void leave_block(const block* v) override;
+
+        void print_value(const symbol_table::entry& e) const;
 
         void print_spacing() const;
     };
@@ -0,0 +1,167 @@
+/**
+ * \file pass_manager.cpp
+ * \date Oct 17, 2026
+ */
+
+#include "pcsh/pass_manager.hpp"
+
+#include "execution/bytecode.hpp"
+#include "ir/nodes.hpp"
+#include "ir/passes/constant_folder.hpp"
+#include "ir/passes/type_checker.hpp"
+
+#include <chrono>
+#include <iomanip>
+#include <vector>
+
+namespace pcsh {
+namespace ir {
+
+    namespace {
+
+        size_t count_nodes(const node* n)
+        {
+            // an explicit stack, as expressions can be arbitrarily deep
+            std::vector<const node*> pending(1, n);
+            size_t count = 0;
+            while (!pending.empty()) {
+                n = pending.back();
+                pending.pop_back();
+                if (!n) {
+                    continue;
+                }
+                ++count;
+                switch (n->kind()) {
+                    case node_kind::BLOCK:
+                        for (auto stmt : *static_cast<const block*>(n)) {
+                            pending.push_back(stmt);
+                        }
+                        break;
+                    case node_kind::IF_STMT: {
+                        auto ifs = static_cast<const if_stmt*>(n);
+                        pending.push_back(ifs->condition());
+                        pending.push_back(ifs->body());
+                        break;
+                    }
+                    default:
+                        pending.push_back(n->left());
+                        pending.push_back(n->right());
+                        break;
+                }
+            }
+            return count;
+        }
+
+    }//namespace
+
+    pass_manager::pass_manager() : passes_(), stats_(), timing_(false)
+    {
+        // fills the symbol tables, checks types and binds variables to
+        // their declarations
+        passes_.push_back({ "type-check", [] (const tree& t) {
+                type_checker checker;
+                checker.visit(t.root());
+            }, true, true });
+        // folds constant expressions and drops dead branches
+        passes_.push_back({ "fold", [] (const tree& t) {
+                constant_folder folder(t.get_arena());
+                folder.visit(t.root());
+            }, false, true });
+        // compiles to bytecode now rather than on first evaluation
+        passes_.push_back({ "compile", [] (const tree& t) {
+                execution::compiled_program(&t);
+            }, false, true });
+    }
+
+    bool pass_manager::add(const std::string& name, pass_fn fn)
+    {
+        for (auto& p : passes_) {
+            if (p.name == name) {
+                if (p.required) {
+                    return false;
+                }
+                p.fn = fn;
+                return true;
+            }
+        }
+        passes_.push_back({ name, fn, false, true });
+        return true;
+    }
+
+    bool pass_manager::enable(const std::string& name, bool on)
+    {
+        for (auto& p : passes_) {
+            if (p.name == name) {
+                if (p.required) {
+                    return false;
+                }
+                p.enabled = on;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::vector<std::string> pass_manager::passes() const
+    {
+        std::vector<std::string> names;
+        for (const auto& p : passes_) {
+            if (p.enabled) {
+                names.push_back(p.name);
+            }
+        }
+        return names;
+    }
+
+    void pass_manager::run(const tree& t)
+    {
+        for (const auto& p : passes_) {
+            if (!p.enabled) {
+                continue;
+            }
+            if (timing_) {
+                measure(p.name, t, [&] { p.fn(t); });
+            } else {
+                p.fn(t);
+            }
+        }
+    }
+
+    void pass_manager::measure(const std::string& name, const tree& t, const std::function<void()>& fn)
+    {
+        if (!timing_) {
+            fn();
+            return;
+        }
+        using clock = std::chrono::steady_clock;
+        auto bytes = t.get_arena().bytes_used();
+        auto start = clock::now();
+        fn();
+        std::chrono::duration<double> elapsed = clock::now() - start;
+        stats_.push_back({ name, elapsed.count(), count_nodes(t.root()), t.get_arena().bytes_used() - bytes });
+    }
+
+    void pass_manager::report(ostream& os) const
+    {
+        double total = 0;
+        size_t bytes = 0;
+        os << std::left << std::setw(12) << "pass" << std::right
+           << std::setw(12) << "time (ms)" << std::setw(12) << "nodes" << std::setw(14) << "arena (KB)" << "\n";
+        auto flags = os.flags();
+        auto precision = os.precision();
+        os << std::fixed << std::setprecision(3);
+        for (const auto& s : stats_) {
+            os << std::left << std::setw(12) << s.name << std::right
+               << std::setw(12) << s.seconds * 1000 << std::setw(12) << s.nodes
+               << std::setw(14) << s.arena_bytes / 1024.0 << "\n";
+            total += s.seconds;
+            bytes += s.arena_bytes;
+        }
+        os << std::left << std::setw(12) << "total" << std::right
+           << std::setw(12) << total * 1000 << std::setw(12) << "" << std::setw(14) << bytes / 1024.0 << "\n";
+        os.flags(flags);
+        os.precision(precision);
+    }
+
+}//namespace ir
+}//namespace pcsh
@@ -0,0 +1,368 @@
+/**
+ * \file constant_folder.cpp
+ * \date Oct 17, 2026
+ */
+
+#include "ir/nodes.hpp"
+#include "ir/passes/constant_folder.hpp"
+
+#include <climits>
+#include <cstring>
+
+namespace pcsh {
+namespace ir {
+
+    namespace {
+
+        // int arithmetic wraps like the evaluators do on the targets we
+        // support, without relying on signed overflow in the folder itself
+
+        inline int wrap(unsigned v)
+        {
+            return static_cast<int>(v);
+        }
+
+        struct add_op
+        {
+            static bool apply(int a, int b, int& out)
+            {
+                out = wrap(static_cast<unsigned>(a) + static_cast<unsigned>(b));
+                return true;
+            }
+
+            static bool apply(double a, double b, double& out)
+            {
+                out = a + b;
+                return true;
+            }
+        };
+
+        struct sub_op
+        {
+            static bool apply(int a, int b, int& out)
+            {
+                out = wrap(static_cast<unsigned>(a) - static_cast<unsigned>(b));
+                return true;
+            }
+
+            static bool apply(double a, double b, double& out)
+            {
+                out = a - b;
+                return true;
+            }
+        };
+
+        struct mul_op
+        {
+            static bool apply(int a, int b, int& out)
+            {
+                out = wrap(static_cast<unsigned>(a) * static_cast<unsigned>(b));
+                return true;
+            }
+
+            static bool apply(double a, double b, double& out)
+            {
+                out = a * b;
+                return true;
+            }
+        };
+
+        struct div_op
+        {
+            // a faulting division is left for the evaluator to hit, if the
+            // statement ever runs
+            static bool apply(int a, int b, int& out)
+            {
+                if ((b == 0) || ((a == INT_MIN) && (b == -1))) {
+                    return false;
+                }
+                out = a / b;
+                return true;
+            }
+
+            static bool apply(double a, double b, double& out)
+            {
+                out = a / b;
+                return true;
+            }
+        };
+
+        // the tree is being rewritten by its owner, the const is only the
+        // visitor interface
+        template <class T>
+        inline T* mutable_node(const T* n)
+        {
+            return const_cast<T*>(n);
+        }
+
+    }//namespace
+
+    node* constant_folder::make_constant(const node* n, const symbol_table::value& val) const
+    {
+        switch (n->kind()) {
+            case node_kind::INT_CONSTANT:
+            case node_kind::FLOAT_CONSTANT:
+            case node_kind::STRING_CONSTANT:
+                // already as cheap as it gets
+                return mutable_node(n);
+            default:
+                break;
+        }
+        switch (ctx_) {
+            case result_type::INTEGER:
+                return arena_.create<int_constant>(val.int_val);
+            case result_type::FLOATING:
+                return arena_.create<float_constant>(val.dbl_val);
+            case result_type::STRING:
+                return arena_.create<string_constant>(val.str_val);
+            default:
+                PCSH_ASSERT_MSG(false, "Folded a constant of unknown type.");
+                return mutable_node(n);
+        }
+    }
+
+    void constant_folder::fold_assign(const assign* v)
+    {
+        // cascading assignments evaluate in the type of the innermost one
+        while (v->right()->kind() == node_kind::ASSIGN) {
+            v = static_cast<const assign*>(v->right());
+        }
+        variable_accessor acc(nested_tables_);
+        ctx_ = acc.lookup(v->var()).type;
+        fold(v->right());
+        if (isconst_) {
+            mutable_node(v)->set_right(make_constant(v->right(), val_));
+        }
+    }
+
+    bool constant_folder::enter_if(const if_stmt* v)
+    {
+        ctx_ = v->condition_type();
+        fold(v->condition());
+        if (isconst_) {
+            bool taken = false;
+            switch (ctx_) {
+                case result_type::INTEGER:
+                    taken = (val_.int_val != 0);
+                    break;
+                case result_type::FLOATING:
+                    taken = (val_.dbl_val != 0.0);
+                    break;
+                case result_type::STRING:
+                    taken = (val_.str_val[0] != '\0');
+                    break;
+                default:
+                    PCSH_ASSERT_MSG(false, "Unknown condition type in if statement.");
+                    break;
+            }
+            if (!taken) {
+                // only a statement of a block can be dropped
+                if (v == stmt_) {
+                    dead_.push_back(v);
+                }
+                return false;
+            }
+            mutable_node(v)->set_condition(make_constant(v->condition(), val_));
+        }
+        return true;
+    }
+
+    bool constant_folder::enter_comparison(const comp_equals* v)
+    {
+        if (ctx_ != result_type::INTEGER) {
+            // fails at run time, leave it to the evaluator
+            return false;
+        }
+        // operands of a floating comparison are compared as integers
+        ctx_ = (v->comp_type() == result_type::STRING) ? result_type::STRING : result_type::INTEGER;
+        return true;
+    }
+
+    constant_folder::folded constant_folder::leaf(const node* n)
+    {
+        folded f = { false, symbol_table::value() };
+        switch (n->kind()) {
+            case node_kind::VARIABLE:
+            case node_kind::COMP_EQUALS:
+                break;
+            case node_kind::INT_CONSTANT: {
+                auto c = static_cast<const int_constant*>(n)->value();
+                switch (ctx_) {
+                    case result_type::INTEGER:
+                        f.val.int_val = c;
+                        f.isconst = true;
+                        break;
+                    case result_type::FLOATING:
+                        f.val.dbl_val = static_cast<double>(c);
+                        f.isconst = true;
+                        break;
+                    default:
+                        break;
+                }
+                break;
+            }
+            case node_kind::FLOAT_CONSTANT: {
+                auto c = static_cast<const float_constant*>(n)->value();
+                switch (ctx_) {
+                    case result_type::INTEGER:
+                        f.val.int_val = static_cast<int>(c);
+                        f.isconst = true;
+                        break;
+                    case result_type::FLOATING:
+                        f.val.dbl_val = c;
+                        f.isconst = true;
+                        break;
+                    default:
+                        break;
+                }
+                break;
+            }
+            case node_kind::STRING_CONSTANT:
+                f.val.str_val = static_cast<const string_constant*>(n)->value();
+                f.isconst = (ctx_ == result_type::STRING);
+                break;
+            default:
+                PCSH_ASSERT_MSG(false, "Statement used as an expression.");
+                break;
+        }
+        return f;
+    }
+
+    constant_folder::folded constant_folder::unary(const node* n, const folded& operand)
+    {
+        switch (n->kind()) {
+            case node_kind::UNARY_MINUS:
+                return fold_unary_minus(operand);
+            case node_kind::ASSIGN: {
+                // an assignment inside an expression is evaluated in the
+                // enclosing expression's type
+                auto v = static_cast<const assign*>(n);
+                if (operand.isconst) {
+                    mutable_node(v)->set_right(make_constant(v->right(), operand.val));
+                }
+                folded f = { false, symbol_table::value() };
+                return f;
+            }
+            default:
+                return operand;
+        }
+    }
+
+    constant_folder::folded constant_folder::binary(const node* n, const folded& l, const folded& r)
+    {
+        switch (n->kind()) {
+            case node_kind::BINARY_DIV:
+                return fold_arith<div_op>(static_cast<const untyped_binary_op_base*>(n), l, r);
+            case node_kind::BINARY_MINUS:
+                return fold_arith<sub_op>(static_cast<const untyped_binary_op_base*>(n), l, r);
+            case node_kind::BINARY_MULT:
+                return fold_arith<mul_op>(static_cast<const untyped_binary_op_base*>(n), l, r);
+            case node_kind::BINARY_PLUS:
+                return fold_arith<add_op>(static_cast<const untyped_binary_op_base*>(n), l, r);
+            default:
+                return fold_comparison(static_cast<const comp_equals*>(n), l, r);
+        }
+    }
+
+    template <class Op>
+    constant_folder::folded constant_folder::fold_arith(const untyped_binary_op_base* v, const folded& l, const folded& r)
+    {
+        folded f = { false, symbol_table::value() };
+        if (l.isconst && r.isconst) {
+            switch (ctx_) {
+                case result_type::INTEGER:
+                    if (Op::apply(l.val.int_val, r.val.int_val, f.val.int_val)) {
+                        f.isconst = true;
+                        return f;
+                    }
+                    break;
+                case result_type::FLOATING:
+                    if (Op::apply(l.val.dbl_val, r.val.dbl_val, f.val.dbl_val)) {
+                        f.isconst = true;
+                        return f;
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+        auto p = mutable_node(v);
+        if (l.isconst) {
+            p->set_left(make_constant(v->left(), l.val));
+        }
+        if (r.isconst) {
+            p->set_right(make_constant(v->right(), r.val));
+        }
+        return f;
+    }
+
+    constant_folder::folded constant_folder::fold_unary_minus(folded f)
+    {
+        if (!f.isconst) {
+            return f;
+        }
+        switch (ctx_) {
+            case result_type::INTEGER:
+                f.val.int_val = wrap(0u - static_cast<unsigned>(f.val.int_val));
+                break;
+            case result_type::FLOATING:
+                f.val.dbl_val = -f.val.dbl_val;
+                break;
+            default:
+                f.isconst = false;
+                break;
+        }
+        return f;
+    }
+
+    constant_folder::folded constant_folder::fold_comparison(const comp_equals* v, const folded& l, const folded& r)
+    {
+        bool equal = false;
+        if (l.isconst && r.isconst) {
+            equal = (ctx_ == result_type::STRING)
+                ? (::strcmp(l.val.str_val, r.val.str_val) == 0)
+                : (l.val.int_val == r.val.int_val);
+        } else {
+            auto p = mutable_node(v);
+            if (l.isconst) {
+                p->set_left(make_constant(v->left(), l.val));
+            }
+            if (r.isconst) {
+                p->set_right(make_constant(v->right(), r.val));
+            }
+        }
+        ctx_ = result_type::INTEGER;
+        folded f = { l.isconst && r.isconst, symbol_table::value() };
+        f.val.int_val = equal ? 1 : 0;
+        return f;
+    }
+
+    void constant_folder::enter_block(const block* v)
+    {
+        nested_tables_.push_back(&(v->table()));
+        firsts_.push_back(dead_.size());
+    }
+
+    void constant_folder::before_statement(const block* v, size_t i)
+    {
+        stmt_ = v->statement(i);
+    }
+
+    void constant_folder::leave_block(const block* v)
+    {
+        // dead statements were found in order
+        auto next = firsts_.back();
+        mutable_node(v)->remove_statements_if([this, &next] (const node* stmt) {
+            if ((next != dead_.size()) && (dead_[next] == stmt)) {
+                ++next;
+                return true;
+            }
+            return false;
+        });
+        dead_.resize(firsts_.back());
+        firsts_.pop_back();
+        nested_tables_.pop_back();
+    }
+
+}//namespace ir
+}//namespace pcsh
@@ -0,0 +1,109 @@
+/**
+ * \file constant_folder.hpp
+ * \date Oct 17, 2026
+ */
+
+#ifndef PCSH_CONSTANT_FOLDER_HPP
+#define PCSH_CONSTANT_FOLDER_HPP
+
+#include "pcsh/arena.hpp"
+#include "pcsh/result_type.hpp"
+
+#include "ir/expression_walker.hpp"
+#include "ir/static_visitor.hpp"
+#include "ir/symbol_table.hpp"
+
+#include <vector>
+
+namespace pcsh {
+namespace ir {
+
+    // Replaces expressions built only from constants by a single constant and
+    // drops `if' statements whose condition folds to false. Runs after
+    // type_checker.
+    //
+    // The evaluators compute a whole right hand side in the type of the
+    // assigned variable, comparison operands in the comparison type and an
+    // `if' condition in its condition type, so expressions are folded in that
+    // context type rather than in the type of each sub-expression.
+    class constant_folder final : public static_visitor<constant_folder>
+    {
+        friend class static_visitor<constant_folder>;
+        friend class expression_walker;
+      public:
+        constant_folder(arena& ar)
+          : arena_(ar), nested_tables_(), walker_(), ctx_(result_type::UNDETERMINED), isconst_(false), val_()
+          , stmt_(nullptr), dead_(), firsts_()
+        { }
+      private:
+        // what an expression folded to
+        struct folded
+        {
+            bool isconst;
+            symbol_table::value val;
+        };
+
+        typedef folded result;
+
+        arena& arena_;
+        scope_stack nested_tables_;
+        expression_walker walker_;
+        result_type ctx_;
+        bool isconst_;
+        symbol_table::value val_;
+        // the statement of the innermost block being folded
+        const node* stmt_;
+        // statements that can never have an effect, to drop from their
+        // blocks; those of each block being folded start at its `firsts_'
+        std::vector<const node*> dead_;
+        std::vector<size_t> firsts_;
+
+        // bare expressions are not evaluated
+        template <class Expr>
+        void visit_impl(const Expr* v)
+        { }
+
+        void visit_impl(const assign* v)
+        {
+            fold_assign(v);
+        }
+
+        void enter_block(const block* v);
+        void before_statement(const block* v, size_t i);
+        void leave_block(const block* v);
+        bool enter_if(const if_stmt* v);
+
+        void fold_assign(const assign* v);
+
+        // folds an expression in the type `ctx_', leaving the result in
+        // `isconst_' and `val_'
+        void fold(const node* n)
+        {
+            auto f = walker_.walk(n, *this);
+            isconst_ = f.isconst;
+            val_ = f.val;
+        }
+
+        inline bool enter(const node* n)
+        {
+            return (n->kind() != node_kind::COMP_EQUALS) || enter_comparison(static_cast<const comp_equals*>(n));
+        }
+
+        folded leaf(const node* n);
+        folded unary(const node* n, const folded& operand);
+        folded binary(const node* n, const folded& l, const folded& r);
+
+        bool enter_comparison(const comp_equals* v);
+
+        template <class Op>
+        folded fold_arith(const untyped_binary_op_base* v, const folded& l, const folded& r);
+        folded fold_unary_minus(folded f);
+        folded fold_comparison(const comp_equals* v, const folded& l, const folded& r);
+
+        node* make_constant(const node* n, const symbol_table::value& val) const;
+    };
+
+}//namespace ir
+}//namespace pcsh
+
+#endif/*PCSH_CONSTANT_FOLDER_HPP*/
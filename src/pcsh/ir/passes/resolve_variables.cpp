@@ -0,0 +1,31 @@
+/**
+ * \file resolve_variables.cpp
+ * \date Oct 17, 2026
+ */
+
+#include "ir/nodes.hpp"
+#include "ir/passes/resolve_variables.hpp"
+
+namespace pcsh {
+namespace ir {
+
+    void resolve_variables::resolve(const variable* v)
+    {
+        variable_accessor acc(nested_list_);
+        if (!acc.resolve(v)) {
+            v->resolve(symbol_table::NO_SLOT, symbol_table::NO_SLOT);
+        }
+    }
+
+    void resolve_variables::enter_block(const block* v)
+    {
+        nested_list_.push_back(&(v->table()));
+    }
+
+    void resolve_variables::leave_block(const block* v)
+    {
+        nested_list_.pop_back();
+    }
+
+}//namespace ir
+}//namespace pcsh
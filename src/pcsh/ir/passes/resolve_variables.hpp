@@ -0,0 +1,79 @@
+/**
+ * \file resolve_variables.hpp
+ * \date Oct 17, 2026
+ */
+
+#ifndef PCSH_RESOLVE_VARIABLES_HPP
+#define PCSH_RESOLVE_VARIABLES_HPP
+
+#include "ir/expression_walker.hpp"
+#include "ir/static_visitor.hpp"
+#include "ir/symbol_table.hpp"
+
+namespace pcsh {
+namespace ir {
+
+    // Binds every variable to the (depth, slot) of its declaration so later
+    // passes index the symbol tables directly. type_checker does this as it
+    // fills the tables of a parsed tree; this is for trees whose tables are
+    // filled already, such as clones.
+    class resolve_variables final : public static_visitor<resolve_variables>
+    {
+        friend class static_visitor<resolve_variables>;
+        friend class expression_walker;
+      public:
+        resolve_variables() : nested_list_(), walker_()
+        { }
+      private:
+        scope_stack nested_list_;
+        expression_walker walker_;
+
+        template <class Expr>
+        void visit_impl(const Expr* v)
+        {
+            walker_.walk(v, *this);
+        }
+
+        void enter_block(const block* v);
+        void leave_block(const block* v);
+
+        // nothing flows between the nodes of an expression here
+        typedef bool result;
+
+        inline bool enter(const node* n)
+        {
+            switch (n->kind()) {
+                case node_kind::VARIABLE:
+                    resolve(static_cast<const variable*>(n));
+                    break;
+                case node_kind::ASSIGN:
+                    resolve(static_cast<const assign*>(n)->var());
+                    break;
+                default:
+                    break;
+            }
+            return true;
+        }
+
+        bool leaf(const node*)
+        {
+            return true;
+        }
+
+        bool unary(const node*, bool)
+        {
+            return true;
+        }
+
+        bool binary(const node*, bool, bool)
+        {
+            return true;
+        }
+
+        void resolve(const variable* v);
+    };
+
+}//namespace ir
+}//namespace pcsh
+
+#endif/*PCSH_RESOLVE_VARIABLES_HPP*/
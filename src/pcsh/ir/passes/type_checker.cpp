@@ -28,149 +28,216 @@ namespace ir {
         return lfttype;
     }
 
-    void type_checker::visit_impl(const variable* v)
-    {
-        variable_accessor acc(nested_tables_);
-        curr_ = acc.lookup(v).type;
-    }
+    namespace {
 
-    void type_checker::visit_impl(const int_constant* v)
-    {
-        curr_ = result_type::INTEGER;
-    }
+        // records the statements of a block that declare each name, as
+        // type_checker would were the name not yet in scope
+        class site_finder
+        {
+            friend class ir::expression_walker;
+          public:
+            site_finder(std::unordered_map<cstring, size_t>& sites) : sites_(sites), index_(0), walker_()
+            { }
 
-    void type_checker::visit_impl(const float_constant* v)
-    {
-        curr_ = result_type::FLOATING;
-    }
+            void statement(const node* n, size_t index)
+            {
+                // if conditions declare nothing, nested blocks declare in
+                // their own tables
+                while (n->kind() == node_kind::IF_STMT) {
+                    n = static_cast<const if_stmt*>(n)->body();
+                }
+                if (n->kind() != node_kind::BLOCK) {
+                    index_ = index;
+                    walker_.walk(n, *this);
+                }
+            }
+          private:
+            std::unordered_map<cstring, size_t>& sites_;
+            size_t index_;
+            expression_walker walker_;
 
-    void type_checker::visit_impl(const string_constant* v)
-    {
-        curr_ = result_type::STRING;
-    }
+            // nothing flows between the nodes of an expression here
+            typedef bool result;
+
+            bool enter(const node* n)
+            {
+                if (n->kind() == node_kind::ASSIGN) {
+                    sites_[static_cast<const assign*>(n)->var()->name()] = index_;
+                }
+                return true;
+            }
+
+            bool leaf(const node*)
+            {
+                return true;
+            }
+
+            bool unary(const node*, bool)
+            {
+                return true;
+            }
 
-    void type_checker::visit_impl(const unary_plus* v)
+            bool binary(const node*, bool, bool)
+            {
+                return true;
+            }
+        };
+
+    }//namespace
+
+    void type_checker::declare(const assign* v)
     {
-        v->left()->accept(this);
-        auto lfttype = curr_;
-        auto fintype = propagate(lfttype, /*fake value*/result_type::BOOLEAN);
-        if (fintype == result_type::FAILED) {
-            throw type_checker_error("Invalid application of unary `+'.", v->left(), nullptr);
+        // the first assignment to a name not in scope declares it in the
+        // innermost block, before its right side is checked
+        auto var = v->var();
+        variable_accessor acc(nested_tables_);
+        if (acc.resolve(var)) {
+            return;
+        }
+        auto& bindings = scopes_.back().bindings;
+        auto it = bindings.begin();
+        while ((it != bindings.end()) && (it->name != var->name())) {
+            ++it;
+        }
+        auto ty = (it != bindings.end()) ? it->type : result_type::UNDETERMINED;
+        symbol_table::set(*(nested_tables_.back()), var, v->right(), ty);
+        acc.resolve(var);
+        if (it != bindings.end()) {
+            for (auto use : it->uses) {
+                use->resolve(var->depth(), var->slot());
+            }
+            bindings.erase(it);
         }
-        curr_ = fintype;
     }
 
-    void type_checker::visit_impl(const unary_minus* v)
+    type_checker::pending* type_checker::defer(const variable* v)
     {
-        v->left()->accept(this);
-        auto lfttype = curr_;
-        auto fintype = propagate(lfttype, /*fake value*/result_type::BOOLEAN);
-        if (fintype == result_type::FAILED) {
-            throw type_checker_error("Invalid application of unary `-'.", v->left(), nullptr);
+        // the innermost block with a declaration still to come owns it; a
+        // block's declarations are only looked over the first time one of
+        // its names is missing
+        auto depth = scopes_.size();
+        while (depth-- > 0) {
+            auto& sc = scopes_[depth];
+            if (!sc.sites) {
+                sc.sites.reset(new declaration_sites());
+                site_finder finder(*sc.sites);
+                for (size_t i = 0, n = sc.blk->statement_count(); i != n; ++i) {
+                    finder.statement(sc.blk->statement(i), i);
+                }
+            }
+            auto site = sc.sites->find(v->name());
+            if ((site == sc.sites->end()) || (site->second < sc.index)) {
+                continue;
+            }
+            for (auto& p : sc.bindings) {
+                if (p.name == v->name()) {
+                    p.uses.push_back(v);
+                    return &p;
+                }
+            }
+            sc.bindings.push_back({ v->name(), result_type::UNDETERMINED, std::vector<const variable*>(1, v) });
+            return &sc.bindings.back();
         }
-        curr_ = fintype;
+        v->resolve(symbol_table::NO_SLOT, symbol_table::NO_SLOT);
+        return nullptr;
     }
 
-    void type_checker::visit_impl(const binary_div* v)
+    result_type type_checker::check_variable(const variable* v)
     {
-        v->left()->accept(this);
-        auto lfttype = curr_;
-        v->right()->accept(this);
-        auto rgttype = curr_;
-        auto fintype = propagate(lfttype, rgttype, result_type::INTEGER);
-        if (fintype == result_type::FAILED) {
-            throw type_checker_error("Invalid application of `/'.", v->left(), v->right());
+        variable_accessor acc(nested_tables_);
+        if (acc.resolve(v)) {
+            return acc.lookup(v).type;
         }
-        curr_ = fintype;
+        auto p = defer(v);
+        return p ? p->type : result_type::UNDETERMINED;
     }
 
-    void type_checker::visit_impl(const binary_minus* v)
+    result_type type_checker::leaf(const node* n)
     {
-        v->left()->accept(this);
-        auto lfttype = curr_;
-        v->right()->accept(this);
-        auto rgttype = curr_;
-        auto fintype = propagate(lfttype, rgttype);
-        if (fintype == result_type::FAILED) {
-            throw type_checker_error("Invalid application of `-'.", v->left(), v->right());
+        switch (n->kind()) {
+            case node_kind::VARIABLE:
+                return check_variable(static_cast<const variable*>(n));
+            case node_kind::INT_CONSTANT:
+                return result_type::INTEGER;
+            case node_kind::FLOAT_CONSTANT:
+                return result_type::FLOATING;
+            case node_kind::STRING_CONSTANT:
+                return result_type::STRING;
+            default:
+                PCSH_ASSERT_MSG(false, "Statement used as an expression.");
+                return result_type::FAILED;
         }
-        curr_ = (fintype == result_type::BOOLEAN) ? result_type::INTEGER : fintype;
     }
 
-    void type_checker::visit_impl(const binary_mult* v)
+    result_type type_checker::unary(const node* n, result_type operand)
     {
-        v->left()->accept(this);
-        auto lfttype = curr_;
-        v->right()->accept(this);
-        auto rgttype = curr_;
-        auto fintype = propagate(lfttype, rgttype);
+        if (n->kind() == node_kind::ASSIGN) {
+            return check_assign(static_cast<const assign*>(n), operand);
+        }
+        auto fintype = propagate(operand, /*fake value*/result_type::BOOLEAN);
         if (fintype == result_type::FAILED) {
-            throw type_checker_error("Invalid application of `*'.", v->left(), v->right());
+            throw type_checker_error((n->kind() == node_kind::UNARY_PLUS) ? "Invalid application of unary `+'." : "Invalid application of unary `-'.", n->left(), nullptr);
         }
-        curr_ = (fintype == result_type::BOOLEAN) ? result_type::INTEGER : fintype;
+        return fintype;
     }
 
-    void type_checker::visit_impl(const binary_plus* v)
+    result_type type_checker::binary(const node* n, result_type lfttype, result_type rgttype)
     {
-        v->left()->accept(this);
-        auto lfttype = curr_;
-        v->right()->accept(this);
-        auto rgttype = curr_;
-        auto fintype = propagate(lfttype, rgttype);
+        cstring msg = nullptr;
+        auto minvalid = result_type::BOOLEAN;
+        switch (n->kind()) {
+            case node_kind::BINARY_DIV:
+                msg = "Invalid application of `/'.";
+                minvalid = result_type::INTEGER;
+                break;
+            case node_kind::BINARY_MINUS:
+                msg = "Invalid application of `-'.";
+                break;
+            case node_kind::BINARY_MULT:
+                msg = "Invalid application of `*'.";
+                break;
+            case node_kind::BINARY_PLUS:
+                msg = "Invalid application of `+'.";
+                break;
+            default:
+                return check_comparison(static_cast<const comp_equals*>(n), lfttype, rgttype);
+        }
+        auto fintype = propagate(lfttype, rgttype, minvalid);
         if (fintype == result_type::FAILED) {
-            throw type_checker_error("Invalid application of `+'.", v->left(), v->right());
+            throw type_checker_error(msg, n->left(), n->right());
         }
-        curr_ = (fintype == result_type::BOOLEAN) ? result_type::INTEGER : fintype;
+        return (fintype == result_type::BOOLEAN) ? result_type::INTEGER : fintype;
     }
 
-    void type_checker::visit_impl(const assign* v)
+    result_type type_checker::check_assign(const assign* v, result_type ty)
     {
-        v->right()->accept(this);
-        auto ty = curr_;
+        // the assignment has the type of its right side
         PCSH_ASSERT_MSG(ty != result_type::FAILED, "Assigned FAILED result type to variable.");
         if (ty == result_type::UNDETERMINED) {
             throw type_checker_error("Value of variable `" + std::string(v->var()->name()) + "' is undetermined!", v->left(), v->right());
         }
 
         variable_accessor acc(nested_tables_);
-        auto sym = acc.lookup(v->var());
-        if (sym.type == result_type::UNDETERMINED) {
-            acc.set(v->var(), sym.ptr, ty);
-        } else if (sym.type != ty) {
-            throw type_checker_error("Type of variable `" + std::string(v->var()->name()) + "' is changed!", v->right(), nullptr);
+        if (acc.resolve(v->var())) {
+            auto sym = acc.lookup(v->var());
+            if (sym.type == result_type::UNDETERMINED) {
+                acc.set(v->var(), sym.ptr, ty);
+            } else if (sym.type != ty) {
+                throw type_checker_error("Type of variable `" + std::string(v->var()->name()) + "' is changed!", v->right(), nullptr);
+            }
+        } else if (auto p = defer(v->var())) {
+            // an if condition assigning a name declared later
+            if (p->type == result_type::UNDETERMINED) {
+                p->type = ty;
+            } else if (p->type != ty) {
+                throw type_checker_error("Type of variable `" + std::string(v->var()->name()) + "' is changed!", v->right(), nullptr);
+            }
         }
+        return ty;
     }
 
-    void type_checker::visit_impl(const block* v)
+    result_type type_checker::check_comparison(const comp_equals* v, result_type lfttype, result_type rgttype)
     {
-        auto oldtype = curr_;
-        auto oldblk = curr_blk_;
-        {
-            curr_ = result_type::UNDETERMINED;
-            curr_blk_ = v;
-            nested_tables_.push_back(&(v->table()));
-            visit_block(v);
-            nested_tables_.pop_back();
-        }
-        curr_ = oldtype;
-        curr_blk_ = oldblk;
-    }
-
-    void type_checker::visit_impl(const if_stmt* v)
-    {
-        v->condition()->accept(this);
-        auto condty = curr_;
-        PCSH_ASSERT_MSG(condty != result_type::FAILED, "If condition result type is undefined well.");
-        v->set_condition_type(condty);
-        v->body()->accept(this);
-    }
-
-    void type_checker::visit_impl(const comp_equals* v)
-    {
-        v->left()->accept(this);
-        auto lfttype = curr_;
-        v->right()->accept(this);
-        auto rgttype = curr_;
         bool isvalid = false;
         auto ty = lfttype;
         if (lfttype == result_type::STRING || rgttype == result_type::STRING) {
@@ -184,7 +251,37 @@ namespace ir {
         if (!isvalid) {
             throw type_checker_error("Invalid application of `=='.", v->left(), v->right());
         }
-        curr_ = result_type::INTEGER;
+        return result_type::INTEGER;
+    }
+
+    void type_checker::enter_block(const block* v)
+    {
+        nested_tables_.push_back(&(v->table()));
+        scopes_.emplace_back(v);
+    }
+
+    void type_checker::before_statement(const block* v, size_t i)
+    {
+        scopes_.back().index = i;
+    }
+
+    void type_checker::leave_block(const block* v)
+    {
+        PCSH_ASSERT_MSG(scopes_.back().bindings.empty(), "Pending binding outlived its block.");
+        scopes_.pop_back();
+        nested_tables_.pop_back();
+    }
+
+    bool type_checker::enter_if(const if_stmt* v)
+    {
+        auto oldcond = in_condition_;
+        in_condition_ = true;
+        visit(v->condition());
+        in_condition_ = oldcond;
+        auto condty = curr_;
+        PCSH_ASSERT_MSG(condty != result_type::FAILED, "If condition result type is undefined well.");
+        v->set_condition_type(condty);
+        return true;
     }
 
 }//namespace ir
@@ -8,9 +8,15 @@
 
 #include "pcsh/result_type.hpp"
 
-#include "ir/visitor.hpp"
+#include "ir/expression_walker.hpp"
+#include "ir/static_visitor.hpp"
 #include "ir/symbol_table.hpp"
 
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 namespace pcsh {
 namespace ir {
 
@@ -27,30 +33,88 @@ namespace ir {
         { }
     };
 
-    class type_checker final : public node_visitor
+    // Fills the symbol tables, checks types and binds every variable to the
+    // (depth, slot) of its declaration, in one walk. Assignments are
+    // declarations and scoping is lexical, so every name a statement reads
+    // has been declared, if ever, by an earlier statement.
+    //
+    // Assignments in an if condition declare nothing; only statements do.
+    // Those to a name not yet in scope, and reads of one, belong to the
+    // declaration a later statement of an enclosing block will make. That
+    // binding is kept pending in the block, with the type the conditions
+    // gave it, and settled when the declaration is made.
+    //
+    // Expressions are checked with an expression_walker, which hands each
+    // node the types of its operands.
+    class type_checker final : public static_visitor<type_checker>
     {
+        friend class static_visitor<type_checker>;
+        friend class expression_walker;
       public:
-        type_checker() : curr_(result_type::UNDETERMINED), curr_blk_(nullptr), nested_tables_()
+        type_checker()
+          : curr_(result_type::UNDETERMINED), in_condition_(false), nested_tables_(), scopes_(), walker_()
         { }
       private:
+        // for each name a block's statements declare, the index of the last
+        // statement that would
+        typedef std::unordered_map<cstring, size_t> declaration_sites;
+
+        // uses of a name that a later statement of the block declares
+        struct pending
+        {
+            cstring name;
+            result_type type;
+            std::vector<const variable*> uses;
+        };
+
+        struct scope
+        {
+            const block* blk;
+            size_t index;       // of the statement being checked
+            std::unique_ptr<declaration_sites> sites;   // built on first need
+            std::vector<pending> bindings;
+
+            scope(const block* b) : blk(b), index(0), sites(), bindings()
+            { }
+        };
+
         result_type curr_;
-        const block* curr_blk_;
-        sym_table_list nested_tables_;
-
-        void visit_impl(const variable* v) override;
-        void visit_impl(const int_constant* v) override;
-        void visit_impl(const float_constant* v) override;
-        void visit_impl(const string_constant* v) override;
-        void visit_impl(const unary_plus* v) override;
-        void visit_impl(const unary_minus* v) override;
-        void visit_impl(const binary_div* v) override;
-        void visit_impl(const binary_minus* v) override;
-        void visit_impl(const binary_mult* v) override;
-        void visit_impl(const binary_plus* v) override;
-        void visit_impl(const assign* v) override;
-        void visit_impl(const comp_equals* v) override;
-        void visit_impl(const block* v) override;
-        void visit_impl(const if_stmt* v) override;
+        bool in_condition_;
+        scope_stack nested_tables_;
+        std::vector<scope> scopes_;
+        expression_walker walker_;
+
+        template <class Expr>
+        void visit_impl(const Expr* v)
+        {
+            curr_ = walker_.walk(v, *this);
+        }
+
+        void enter_block(const block* v);
+        void before_statement(const block* v, size_t i);
+        void leave_block(const block* v);
+        bool enter_if(const if_stmt* v);
+
+        typedef result_type result;
+
+        inline bool enter(const node* n)
+        {
+            if ((n->kind() == node_kind::ASSIGN) && !in_condition_) {
+                declare(static_cast<const assign*>(n));
+            }
+            return true;
+        }
+
+        result_type leaf(const node* n);
+        result_type unary(const node* n, result_type operand);
+        result_type binary(const node* n, result_type lfttype, result_type rgttype);
+
+        void declare(const assign* v);
+        pending* defer(const variable* v);
+
+        result_type check_variable(const variable* v);
+        result_type check_assign(const assign* v, result_type ty);
+        result_type check_comparison(const comp_equals* v, result_type lfttype, result_type rgttype);
     };
 
 }//namespace ir
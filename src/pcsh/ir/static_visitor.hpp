@@ -0,0 +1,236 @@
+/**
+ * \file static_visitor.hpp
+ * \date Oct 17, 2026
+ */
+
+#ifndef PCSH_IR_STATIC_VISITOR_HPP
+#define PCSH_IR_STATIC_VISITOR_HPP
+
+#include "pcsh/assert.hpp"
+#include "pcsh/ir.hpp"
+
+#include "ir/nodes.hpp"
+
+#include <vector>
+
+namespace pcsh {
+namespace ir {
+
+    // Dispatches on node::kind() with a switch instead of the double virtual
+    // call of node_visitor, so the handlers of `Derived' can be inlined.
+    //
+    // `Derived' hides the handlers it implements, brings the defaults back
+    // with `using static_visitor<Derived>::visit_impl;' and befriends
+    // static_visitor<Derived> if its handlers are private.
+    //
+    // Blocks and if statements are walked with the ones being visited kept
+    // on the heap, so statements can nest as deep as memory allows. Instead
+    // of handlers they have hooks, called on the way:
+    //
+    //   enter_block(v), leave_block(v)
+    //   before_statement(v, i), after_statement(v, i)
+    //       around statement i of block v
+    //   enter_if(v)
+    //       visits the condition; false skips the body and leave_if(v)
+    //   leave_if(v)
+    //       after the body
+    //
+    // Expressions used as statements go to their visit_impl handler.
+    template <class Derived>
+    class static_visitor
+    {
+      public:
+        static_visitor() : frames_()
+        { }
+
+        void visit(const node* n)
+        {
+            auto& self = static_cast<Derived&>(*this);
+            switch (n->kind()) {
+                case node_kind::VARIABLE:
+                    self.visit_impl(static_cast<const variable*>(n));
+                    break;
+                case node_kind::INT_CONSTANT:
+                    self.visit_impl(static_cast<const int_constant*>(n));
+                    break;
+                case node_kind::FLOAT_CONSTANT:
+                    self.visit_impl(static_cast<const float_constant*>(n));
+                    break;
+                case node_kind::STRING_CONSTANT:
+                    self.visit_impl(static_cast<const string_constant*>(n));
+                    break;
+                case node_kind::UNARY_PLUS:
+                    self.visit_impl(static_cast<const unary_plus*>(n));
+                    break;
+                case node_kind::UNARY_MINUS:
+                    self.visit_impl(static_cast<const unary_minus*>(n));
+                    break;
+                case node_kind::BINARY_DIV:
+                    self.visit_impl(static_cast<const binary_div*>(n));
+                    break;
+                case node_kind::BINARY_MINUS:
+                    self.visit_impl(static_cast<const binary_minus*>(n));
+                    break;
+                case node_kind::BINARY_MULT:
+                    self.visit_impl(static_cast<const binary_mult*>(n));
+                    break;
+                case node_kind::BINARY_PLUS:
+                    self.visit_impl(static_cast<const binary_plus*>(n));
+                    break;
+                case node_kind::ASSIGN:
+                    self.visit_impl(static_cast<const assign*>(n));
+                    break;
+                case node_kind::COMP_EQUALS:
+                    self.visit_impl(static_cast<const comp_equals*>(n));
+                    break;
+                case node_kind::BLOCK:
+                case node_kind::IF_STMT:
+                    visit_statements(n);
+                    break;
+            }
+        }
+
+      protected:
+        void enter_block(const block* v)
+        { }
+
+        void leave_block(const block* v)
+        { }
+
+        void before_statement(const block* v, size_t i)
+        { }
+
+        void after_statement(const block* v, size_t i)
+        { }
+
+        bool enter_if(const if_stmt* v)
+        {
+            visit(v->condition());
+            return true;
+        }
+
+        void leave_if(const if_stmt* v)
+        { }
+
+        void visit_impl(const variable* v)
+        { }
+
+        void visit_impl(const int_constant* v)
+        { }
+
+        void visit_impl(const float_constant* v)
+        { }
+
+        void visit_impl(const string_constant* v)
+        { }
+
+        void visit_impl(const unary_plus* v)
+        {
+            visit(v->operand());
+        }
+
+        void visit_impl(const unary_minus* v)
+        {
+            visit(v->operand());
+        }
+
+        void visit_impl(const binary_div* v)
+        {
+            visit_binary_op(v);
+        }
+
+        void visit_impl(const binary_minus* v)
+        {
+            visit_binary_op(v);
+        }
+
+        void visit_impl(const binary_mult* v)
+        {
+            visit_binary_op(v);
+        }
+
+        void visit_impl(const binary_plus* v)
+        {
+            visit_binary_op(v);
+        }
+
+        void visit_impl(const comp_equals* v)
+        {
+            visit_binary_op(v);
+        }
+
+        void visit_impl(const assign* v)
+        {
+            visit_binary_op(v);
+        }
+
+      private:
+        // a block or if statement being visited
+        struct frame
+        {
+            const node* n;
+            size_t next;        // statement of a block, or 1 once an if body is visited
+        };
+
+        std::vector<frame> frames_;
+
+        void visit_binary_op(const untyped_binary_op_base* v)
+        {
+            visit(v->left());
+            visit(v->right());
+        }
+
+        void visit_statements(const node* n)
+        {
+            auto& self = static_cast<Derived&>(*this);
+            // hooks may visit other statements, which stack above `base'
+            const auto base = frames_.size();
+            while (n) {
+                switch (n->kind()) {
+                    case node_kind::BLOCK:
+                        self.enter_block(static_cast<const block*>(n));
+                        frames_.push_back({ n, 0 });
+                        break;
+                    case node_kind::IF_STMT:
+                        if (self.enter_if(static_cast<const if_stmt*>(n))) {
+                            frames_.push_back({ n, 0 });
+                        }
+                        break;
+                    default:
+                        visit(n);
+                        break;
+                }
+
+                // the next statement, leaving what has none left
+                n = nullptr;
+                while (!n && (frames_.size() != base)) {
+                    const auto f = frames_.back();
+                    if (f.n->kind() == node_kind::BLOCK) {
+                        auto v = static_cast<const block*>(f.n);
+                        if (f.next != 0) {
+                            self.after_statement(v, f.next - 1);
+                        }
+                        if (f.next != v->statement_count()) {
+                            ++frames_.back().next;
+                            self.before_statement(v, f.next);
+                            n = v->statement(f.next);
+                        } else {
+                            frames_.pop_back();
+                            self.leave_block(v);
+                        }
+                    } else if (f.next == 0) {
+                        frames_.back().next = 1;
+                        n = static_cast<const if_stmt*>(f.n)->body();
+                    } else {
+                        frames_.pop_back();
+                        self.leave_if(static_cast<const if_stmt*>(f.n));
+                    }
+                }
+            }
+        }
+    };
+
+}//namespace ir
+}//namespace pcsh
+
+#endif/*PCSH_IR_STATIC_VISITOR_HPP*/
@@ -0,0 +1,83 @@
+/**
+ * \file string_table.cpp
+ * \date Oct 17, 2026
+ */
+
+#include "ir/string_table.hpp"
+
+namespace pcsh {
+namespace ir {
+
+    namespace {
+
+        // FNV-1a
+        inline size_t hash_bytes(const char* str, size_t len)
+        {
+            size_t hash = size_t(14695981039346656037ULL);
+            for (size_t i = 0; i != len; ++i) {
+                hash = (hash ^ static_cast<unsigned char>(str[i])) * size_t(1099511628211ULL);
+            }
+            return hash;
+        }
+
+        const size_t INITIAL_SLOTS = 64;
+
+    }//namespace
+
+    string_table::string_table(arena& store, arena& scratch)
+      : store_(store)
+      , scratch_(scratch)
+      , slots_(scratch.create_array<cstring>(INITIAL_SLOTS))
+      , mask_(INITIAL_SLOTS - 1)
+      , count_(0)
+    {
+        ::memset(slots_, 0, INITIAL_SLOTS * sizeof(cstring));
+    }
+
+    cstring string_table::intern(const char* str, size_t len)
+    {
+        auto hash = hash_bytes(str, len);
+        auto i = hash & mask_;
+        for (; slots_[i]; i = (i + 1) & mask_) {
+            auto h = header_of(slots_[i]);
+            if ((h->hash == hash) && (h->len == len) && (::memcmp(slots_[i], str, len) == 0)) {
+                return slots_[i];
+            }
+        }
+
+        auto h = reinterpret_cast<header*>(store_.create_array<char>(sizeof(header) + len + 1));
+        h->hash = hash;
+        h->len = len;
+        auto copy = reinterpret_cast<char*>(h + 1);
+        ::memcpy(copy, str, len);
+        copy[len] = '\0';
+        slots_[i] = copy;
+        // kept at most half full
+        if (++count_ > (mask_ + 1) / 2) {
+            grow();
+        }
+        return copy;
+    }
+
+    void string_table::grow()
+    {
+        // the old slots stay in the scratch arena until it goes
+        auto nslots = 2 * (mask_ + 1);
+        auto slots = scratch_.create_array<cstring>(nslots);
+        ::memset(slots, 0, nslots * sizeof(cstring));
+        auto mask = nslots - 1;
+        for (size_t n = 0; n <= mask_; ++n) {
+            if (slots_[n]) {
+                auto i = hash_of(slots_[n]) & mask;
+                while (slots[i]) {
+                    i = (i + 1) & mask;
+                }
+                slots[i] = slots_[n];
+            }
+        }
+        slots_ = slots;
+        mask_ = mask;
+    }
+
+}//namespace ir
+}//namespace pcsh
@@ -0,0 +1,76 @@
+/**
+ * \file string_table.hpp
+ * \date Oct 17, 2026
+ */
+
+#ifndef PCSH_IR_STRING_TABLE_HPP
+#define PCSH_IR_STRING_TABLE_HPP
+
+#include "pcsh/arena.hpp"
+#include "pcsh/noncopyable.hpp"
+#include "pcsh/types.hpp"
+
+#include <cstring>
+
+namespace pcsh {
+namespace ir {
+
+    //////////////////////////////////////////////////////////////////////////
+    /// string_table : one copy of each name and literal in a tree
+    //////////////////////////////////////////////////////////////////////////
+
+    // Interned strings are null terminated and carry their hash and length
+    // just before the first character, so equal strings from one table are
+    // equal pointers and hashing one is a load.
+    class string_table : public noncopyable
+    {
+      public:
+        /// strings go in `store', the index in `scratch'
+        string_table(arena& store, arena& scratch);
+
+        cstring intern(const char* str, size_t len);
+
+        inline cstring intern(const char* str)
+        {
+            return intern(str, ::strlen(str));
+        }
+
+        inline size_t size() const
+        {
+            return count_;
+        }
+
+        static inline size_t hash_of(cstring interned)
+        {
+            return header_of(interned)->hash;
+        }
+
+        static inline size_t length_of(cstring interned)
+        {
+            return header_of(interned)->len;
+        }
+      private:
+        struct header
+        {
+            size_t hash;
+            size_t len;
+        };
+
+        arena& store_;
+        arena& scratch_;
+        cstring* slots_;
+        size_t mask_;
+        size_t count_;
+
+        static inline const header* header_of(cstring interned)
+        {
+            return reinterpret_cast<const header*>(interned) - 1;
+        }
+
+        void grow();
+    };
+
+}//namespace ir
+}//namespace pcsh
+
+#endif/*PCSH_IR_STRING_TABLE_HPP*/
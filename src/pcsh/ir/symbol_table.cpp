@@ -6,126 +6,252 @@
 #include "pcsh/assert.hpp"
 
 #include "ir/nodes.hpp"
+#include "ir/string_table.hpp"
 #include "ir/symbol_table.hpp"
 
-#include <unordered_map>
+#include <algorithm>
+#include <cstring>
 
 namespace pcsh {
 namespace symbol_table {
 
-    struct variable_name_hash
+    // Names are interned, so they hash with the hash stored beside them and
+    // compare by address. `names' and `entries' are dense, in slot order;
+    // `index' holds slot + 1 (0 when empty), probes linearly and is kept at
+    // most half full.
+    class table_impl
     {
-        inline size_t operator()(const ir::variable* v) const
+      public:
+        std::uint32_t* index;
+        std::uint32_t mask;
+        std::uint32_t size;
+        std::uint32_t capacity;
+        cstring* names;
+        entry* entries;
+    };
+
+    namespace {
+
+        const std::uint32_t INITIAL_CAPACITY = 4;
+
+        inline std::uint32_t probe_start(const table_impl* t, cstring name)
+        {
+            return static_cast<std::uint32_t>(ir::string_table::hash_of(name)) & t->mask;
+        }
+
+        std::uint32_t find_slot(const table_impl* t, cstring name)
         {
-            auto s = v->name();
-            size_t hash = 0;
-            for (; *s; ++s) {
-                hash = (hash * 31) + (*s);
+            if (!t) {
+                return NO_SLOT;
+            }
+            for (auto i = probe_start(t, name); t->index[i]; i = (i + 1) & t->mask) {
+                if (t->names[t->index[i] - 1] == name) {
+                    return t->index[i] - 1;
+                }
             }
-            return hash;
+            return NO_SLOT;
         }
-    };
 
-    struct variable_name_comp
-    {
-        inline bool operator()(const ir::variable* v1, const ir::variable* v2) const
+        inline void insert_index(table_impl* t, std::uint32_t slot)
         {
-            return ::strcmp(v1->name(), v2->name()) == 0;
+            auto i = probe_start(t, t->names[slot]);
+            while (t->index[i]) {
+                i = (i + 1) & t->mask;
+            }
+            t->index[i] = slot + 1;
         }
-    };
 
-    class table_impl
-      : public std::unordered_map<const ir::variable*, entry, variable_name_hash, variable_name_comp>
-    { };
+        void make_index(arena& a, table_impl* t, std::uint32_t nprobes)
+        {
+            t->index = a.create_array<std::uint32_t>(nprobes);
+            ::memset(t->index, 0, nprobes * sizeof(std::uint32_t));
+            t->mask = nprobes - 1;
+            for (std::uint32_t slot = 0; slot != t->size; ++slot) {
+                insert_index(t, slot);
+            }
+        }
 
-namespace detail {
-    void destroy_table_impl(table_impl* p)
-    {
-        delete p;
-    }
-}//namespace detail
+        // room for one more entry; arena memory is not reused, so what
+        // was outgrown stays until the tree goes
+        table_impl* reserve_one(const ptr& tbl)
+        {
+            auto& a = tbl.get_arena();
+            auto t = tbl.get();
+            if (!t) {
+                t = a.create<table_impl>();
+                *t = { nullptr, 0, 0, INITIAL_CAPACITY, a.create_array<cstring>(INITIAL_CAPACITY),
+                       a.create_array<entry>(INITIAL_CAPACITY) };
+                make_index(a, t, 2 * INITIAL_CAPACITY);
+                tbl.reset(t);
+            } else if (t->size == t->capacity) {
+                auto cap = 2 * t->capacity;
+                auto names = a.create_array<cstring>(cap);
+                auto entries = a.create_array<entry>(cap);
+                std::copy(t->names, t->names + t->size, names);
+                std::copy(t->entries, t->entries + t->size, entries);
+                t->names = names;
+                t->entries = entries;
+                t->capacity = cap;
+                make_index(a, t, 2 * cap);
+            }
+            return t;
+        }
 
-    ptr make_new()
-    {
-        ptr tableptr(new table_impl());
-        return std::move(tableptr);
-    }
+    }//namespace
 
     void set(const ptr& tbl, const ir::variable* v, ir::node* value, result_type ty, bool eval)
     {
-        (*tbl)[v] = { value, ty, eval };
+        auto slot = find_slot(tbl.get(), v->name());
+        if (slot != NO_SLOT) {
+            tbl.get()->entries[slot] = { value, ty, eval };
+            return;
+        }
+        auto t = reserve_one(tbl);
+        slot = t->size++;
+        t->names[slot] = v->name();
+        t->entries[slot] = { value, ty, eval };
+        insert_index(t, slot);
     }
 
     entry lookup(const ptr& tbl, const ir::variable* v)
     {
-        auto it = tbl->find(v);
-        if (it == tbl->end()) {
+        auto slot = find_slot(tbl.get(), v->name());
+        if (slot == NO_SLOT) {
             return { nullptr, result_type::UNDETERMINED, false };
         } else {
-            return it->second;
+            return tbl.get()->entries[slot];
         }
     }
 
+    entry* find(const ptr& tbl, const ir::variable* v)
+    {
+        auto slot = find_slot(tbl.get(), v->name());
+        return (slot == NO_SLOT) ? nullptr : &(tbl.get()->entries[slot]);
+    }
+
+    std::uint32_t slot_of(const ptr& tbl, const ir::variable* v)
+    {
+        return find_slot(tbl.get(), v->name());
+    }
+
+    entry& at(const ptr& tbl, std::uint32_t slot)
+    {
+        PCSH_ASSERT_MSG(tbl.get() && (slot < tbl.get()->size), "Symbol table slot out of range.");
+        return tbl.get()->entries[slot];
+    }
+
     void set_var_type(const ptr& tbl, const ir::variable* v, result_type ty)
     {
-        auto it = tbl->find(v);
-        PCSH_ASSERT_MSG(it != tbl->end(), "Attempt to set var type of untracked variable.");
-        it->second.type = ty;
+        auto slot = find_slot(tbl.get(), v->name());
+        PCSH_ASSERT_MSG(slot != NO_SLOT, "Attempt to set var type of untracked variable.");
+        tbl.get()->entries[slot].type = ty;
     }
 
     std::vector<name_and_type> all_entries(const ptr& tbl)
     {
         std::vector<name_and_type> v;
-        v.reserve(tbl->size());
-        for (const auto& el : (*tbl)) {
+        auto t = tbl.get();
+        if (!t) {
+            return v;
+        }
+        const auto n = t->size;
+        v.reserve(n);
+        for (std::uint32_t i = 0; i != n; ++i) {
+            const auto& el = t->entries[i];
             name_and_type nt;
-            nt.name = el.first->name();
-            nt.type = el.second.type;
-            nt.evaluated = el.second.evaluated;
+            nt.name = t->names[i];
+            nt.type = el.type;
+            nt.evaluated = el.evaluated;
             v.push_back(nt);
         }
         return v;
     }
 
-    void copy_into(const ptr& psrc, const ptr& pdst)
+    cstring find_name(const ptr& tbl, cstring name)
     {
-        *pdst = *psrc;
+        auto t = tbl.get();
+        for (std::uint32_t i = 0; t && (i != t->size); ++i) {
+            if (::strcmp(t->names[i], name) == 0) {
+                return t->names[i];
+            }
+        }
+        return nullptr;
     }
 
 }//namespace symbol_table
 
 namespace ir {
 
+    void scope_stack::grow()
+    {
+        auto bigger = new value_type[2 * capacity_];
+        std::copy(data_, data_ + size_, bigger);
+        if (data_ != inline_) {
+            delete[] data_;
+        }
+        data_ = bigger;
+        capacity_ *= 2;
+    }
+
     symbol_table::entry variable_accessor::lookup(const variable* v, bool findevaluated) const
     {
-        auto it = list_.rbegin();
-        auto end = list_.rend();
-        for (; it != end; ++it) {
-            const auto& tblptr = *it;
-            auto res = symbol_table::lookup(*tblptr, v);
-            if (res.ptr) {
-                if (!findevaluated || res.evaluated) {
+        auto res = find(v, findevaluated);
+        if (res) {
+            return *res;
+        }
+        return{ nullptr, result_type::UNDETERMINED, false };
+    }
+
+    symbol_table::entry* variable_accessor::find(const variable* v, bool findevaluated) const
+    {
+        if (v->resolved()) {
+            auto& res = symbol_table::at(*list_[v->depth()], v->slot());
+            if (!findevaluated || res.evaluated) {
+                return &res;
+            }
+        }
+        auto depth = list_.size();
+        while (depth-- > 0) {
+            auto res = symbol_table::find(*list_[depth], v);
+            if (res && res->ptr) {
+                if (!findevaluated || res->evaluated) {
                     return res;
                 }
             }
         }
-        return{ nullptr, result_type::UNDETERMINED, false };
+        return nullptr;
     }
 
     void variable_accessor::set(const variable* v, node* value, result_type ty, bool eval) const
     {
-        auto it = list_.rbegin();
-        auto end = list_.rend();
-        for (; it != end; ++it) {
-            const auto& tblptr = *it;
-            auto res = symbol_table::lookup(*tblptr, v);
-            if (res.ptr) {
-                symbol_table::set(*tblptr, v, value, ty, eval);
+        if (v->resolved()) {
+            symbol_table::at(*list_[v->depth()], v->slot()) = { value, ty, eval };
+            return;
+        }
+        auto depth = list_.size();
+        while (depth-- > 0) {
+            auto res = symbol_table::find(*list_[depth], v);
+            if (res && res->ptr) {
+                *res = { value, ty, eval };
                 return;
             }
         }
     }
 
+    bool variable_accessor::resolve(const variable* v) const
+    {
+        auto depth = list_.size();
+        while (depth-- > 0) {
+            const auto& tblptr = *list_[depth];
+            auto slot = symbol_table::slot_of(tblptr, v);
+            if ((slot != symbol_table::NO_SLOT) && symbol_table::at(tblptr, slot).ptr) {
+                v->resolve(static_cast<std::uint32_t>(depth), slot);
+                return true;
+            }
+        }
+        return false;
+    }
+
 }//namespace ir
 
 }//namespace pcsh
@@ -7,13 +7,14 @@
 #define PCSH_SYMBOL_TABLE_HPP
 
 #include "pcsh/arena.hpp"
+#include "pcsh/assert.hpp"
 #include "pcsh/ir.hpp"
+#include "pcsh/noncopyable.hpp"
 #include "pcsh/result_type.hpp"
 
 #include "ir/nodes_fwd.hpp"
 
-#include <list>
-#include <memory>
+#include <cstdint>
 #include <vector>
 
 namespace pcsh {
@@ -21,35 +22,52 @@ namespace symbol_table {
 
     class table_impl;
 
-namespace detail {
-
-    void destroy_table_impl(table_impl* p);
+    //////////////////////////////////////////////////////////////////////////
+    /// symbol table
+    //////////////////////////////////////////////////////////////////////////
 
-    struct table_impl_destroyer
+    /// A block's table, kept in the block's arena. Nothing is allocated
+    /// until the first insert, so a block that declares nothing costs only
+    /// this handle.
+    class ptr : public noncopyable
     {
-        void operator()(table_impl* p) const
+      public:
+        explicit ptr(arena& a) : arena_(a), impl_(nullptr)
+        { }
+
+        inline table_impl* get() const
         {
-            destroy_table_impl(p);
+            return impl_;
         }
-    };
-
-}//namespace detail
-
-    typedef std::unique_ptr<table_impl, detail::table_impl_destroyer> ptr;
 
-    //////////////////////////////////////////////////////////////////////////
-    /// symbol table
-    //////////////////////////////////////////////////////////////////////////
+        inline arena& get_arena() const
+        {
+            return arena_;
+        }
 
-    ptr make_new();
+        inline void reset(table_impl* p) const
+        {
+            impl_ = p;
+        }
+      private:
+        arena& arena_;
+        mutable table_impl* impl_;
+    };
 
-    void copy_into(const ptr& psrc, const ptr& pdst);
+    /// runtime value of a symbol, tagged by the type of its entry
+    union value
+    {
+        int int_val;
+        double dbl_val;
+        cstring str_val;
+    };
 
     struct entry
     {
         ir::node* ptr;
         result_type type;
         bool evaluated;
+        value val;
     };
 
     struct name_and_type
@@ -63,32 +81,175 @@ namespace detail {
 
     entry lookup(const ptr& tbl, const ir::variable* v);
 
+    /// stable address of the entry for `v', or nullptr if it is not in the table
+    entry* find(const ptr& tbl, const ir::variable* v);
+
+    static const std::uint32_t NO_SLOT = ~std::uint32_t(0);
+
+    /// slots are handed out in insertion order and never change
+    std::uint32_t slot_of(const ptr& tbl, const ir::variable* v);
+
+    entry& at(const ptr& tbl, std::uint32_t slot);
+
     void set_var_type(const ptr& tbl, const ir::variable* v, result_type ty);
 
     std::vector<name_and_type> all_entries(const ptr& tbl);
 
+    /// the table's interned copy of `name', or nullptr; a linear scan
+    cstring find_name(const ptr& tbl, cstring name);
+
+    /// reads the value of an evaluated entry converted to T
+    template <class T>
+    inline T read(const entry& e)
+    {
+        switch (e.type) {
+            case result_type::INTEGER:
+                return static_cast<T>(e.val.int_val);
+            case result_type::FLOATING:
+                return static_cast<T>(e.val.dbl_val);
+            default:
+                PCSH_ASSERT_MSG(false, "Numeric read of a non numeric variable.");
+                return T();
+        }
+    }
+
+    template <>
+    inline cstring read<cstring>(const entry& e)
+    {
+        PCSH_ASSERT_MSG(e.type == result_type::STRING, "String read of a non string variable.");
+        return e.val.str_val;
+    }
+
+    /// stores `x' converted to the type the variable was declared with
+    template <class T>
+    inline void store(entry& e, T x)
+    {
+        switch (e.type) {
+            case result_type::INTEGER:
+                e.val.int_val = static_cast<int>(x);
+                break;
+            case result_type::FLOATING:
+                e.val.dbl_val = static_cast<double>(x);
+                break;
+            default:
+                PCSH_ASSERT_MSG(false, "Numeric store to a non numeric variable.");
+                break;
+        }
+        e.evaluated = true;
+    }
+
+    template <>
+    inline void store<cstring>(entry& e, cstring x)
+    {
+        PCSH_ASSERT_MSG(e.type == result_type::STRING, "String store to a non string variable.");
+        e.val.str_val = x;
+        e.evaluated = true;
+    }
+
 }//namespace symbol_table
 
 namespace ir {
 
-    using sym_table_list = std::list<const symbol_table::ptr*>;
+    //////////////////////////////////////////////////////////////////////////
+    /// scope_stack : tables of the blocks being visited
+    //////////////////////////////////////////////////////////////////////////
+
+    // Indexed by nesting depth, the outermost block first. The first
+    // INLINE_DEPTH scopes are stored in the stack itself, so entering and
+    // leaving blocks does not allocate unless a script nests deeper.
+    class scope_stack : public noncopyable
+    {
+      public:
+        typedef const symbol_table::ptr* value_type;
+        typedef const value_type* const_iterator;
+
+        static const size_t INLINE_DEPTH = 16;
+
+        inline scope_stack() : data_(inline_), size_(0), capacity_(INLINE_DEPTH), inline_()
+        { }
+
+        inline ~scope_stack()
+        {
+            if (data_ != inline_) {
+                delete[] data_;
+            }
+        }
+
+        inline void push_back(value_type tbl)
+        {
+            if (size_ == capacity_) {
+                grow();
+            }
+            data_[size_++] = tbl;
+        }
+
+        inline void pop_back()
+        {
+            PCSH_ASSERT_MSG(size_ > 0, "Pop from an empty scope stack.");
+            --size_;
+        }
+
+        inline value_type back() const
+        {
+            return data_[size_ - 1];
+        }
+
+        inline value_type operator[](size_t depth) const
+        {
+            return data_[depth];
+        }
+
+        inline size_t size() const
+        {
+            return size_;
+        }
+
+        inline bool empty() const
+        {
+            return size_ == 0;
+        }
+
+        inline const_iterator begin() const
+        {
+            return data_;
+        }
+
+        inline const_iterator end() const
+        {
+            return data_ + size_;
+        }
+      private:
+        value_type* data_;
+        size_t size_;
+        size_t capacity_;
+        value_type inline_[INLINE_DEPTH];
+
+        void grow();
+    };
 
     class variable_accessor
     {
       public:
-        inline variable_accessor(const sym_table_list& l) : list_(l)
+        inline variable_accessor(const scope_stack& l) : list_(l)
         { }
 
+        // resolved variables are read by (depth, slot), others by name
         symbol_table::entry lookup(const ir::variable* v, bool findevaluated = false) const;
 
+        // the live entry for `v', updated in place on assignment; nullptr if undeclared
+        symbol_table::entry* find(const ir::variable* v, bool findevaluated = false) const;
+
         void set(const ir::variable* v, ir::node* value, result_type ty = result_type::UNDETERMINED, bool eval = false) const;
 
-        inline const sym_table_list& symtab_list() const
+        // binds `v' to the innermost declaration of its name; false if there is none
+        bool resolve(const ir::variable* v) const;
+
+        inline const scope_stack& symtab_list() const
         {
             return list_;
         }
       private:
-        const sym_table_list& list_;
+        const scope_stack& list_;
     };
 
 }//namespace ir
@@ -1,17 +0,0 @@
-/**
- * \file tree_validation.hpp
- * \date Jan 31, 2016
- */
-
-#ifndef PCSH_TREE_VALIDATION_HPP
-#define PCSH_TREE_VALIDATION_HPP
-
-#include "pcsh/ir.hpp"
-
-namespace pcsh {
-
-    void validate_tree(const ir::tree::ptr& p);
-
-}//namespace pcsh
-
-#endif/*PCSH_TREE_VALIDATION_HPP*/
@@ -13,71 +13,101 @@ namespace ir {
 
     void node_visitor::visit_impl_binary_op(const void* v)
     {
+        // last in, first out: the left operand is visited first
         auto n = reinterpret_cast<const untyped_binary_op_base*>(v);
-        n->left()->accept(this);
-        n->right()->accept(this);
+        pending_.push_back(n->right());
+        pending_.push_back(n->left());
     }
 
     void node_visitor::visit_impl_unary_op(const void* v)
     {
         auto n = reinterpret_cast<const untyped_unary_op_base*>(v);
-        n->operand()->accept(this);
+        pending_.push_back(n->operand());
     }
 
     void node_visitor::visit_impl(const assign* v)
     {
-        v->left()->accept(this);
-        v->right()->accept(this);
+        pending_.push_back(v->right());
+        pending_.push_back(v->left());
     }
 
-    void node_visitor::visit_impl(const block* v)
+    void node_visitor::visit_pending(size_t base)
     {
-        visit_block(v);
+        while (pending_.size() > base) {
+            auto n = pending_.back();
+            pending_.pop_back();
+            n->accept(this);
+        }
     }
 
-    void node_visitor::visit_impl(const if_stmt* v)
+    void node_visitor::visit(const block* v)
     {
-        v->condition()->accept(this);
-        v->body()->accept(this);
+        visit_statements(v);
     }
 
-    void node_visitor::visit_block(const block* v)
+    void node_visitor::visit(const if_stmt* v)
     {
-        auto h = v->head();
-        while (h != nullptr) {
-            h->entry->accept(this);
-            h = h->next;
-        }
+        visit_statements(v);
     }
 
-    void node_visitor::visit_block_postcbk(const block* v, stmt_visit_cbk cbk)
+    void node_visitor::visit_expression(const node* n)
     {
-        auto h = v->head();
-        while (h != nullptr) {
-            h->entry->accept(this);
-            cbk(h->entry, h->next == nullptr);
-            h = h->next;
-        }
+        const auto base = pending_.size();
+        n->accept(this);
+        visit_pending(base);
     }
 
-    void node_visitor::visit_block_precbk(const block* v, stmt_visit_cbk cbk)
+    bool node_visitor::enter_if(const if_stmt* v)
     {
-        auto h = v->head();
-        while (h != nullptr) {
-            cbk(h->entry, h->next == nullptr);
-            h->entry->accept(this);
-            h = h->next;
-        }
+        visit_expression(v->condition());
+        return true;
     }
 
-    void node_visitor::visit_block_cbk(const block* v, stmt_visit_cbk precbk, stmt_visit_cbk postcbk)
+    void node_visitor::visit_statements(const node* n)
     {
-        auto h = v->head();
-        while (h != nullptr) {
-            precbk(h->entry, h->next == nullptr);
-            h->entry->accept(this);
-            postcbk(h->entry, h->next == nullptr);
-            h = h->next;
+        // hooks may visit other statements, which stack above `base'
+        const auto base = frames_.size();
+        while (n) {
+            switch (n->kind()) {
+                case node_kind::BLOCK:
+                    enter_block(static_cast<const block*>(n));
+                    frames_.push_back({ n, 0 });
+                    break;
+                case node_kind::IF_STMT:
+                    if (enter_if(static_cast<const if_stmt*>(n))) {
+                        frames_.push_back({ n, 0 });
+                    }
+                    break;
+                default:
+                    visit_expression(n);
+                    break;
+            }
+
+            // the next statement, leaving what has none left
+            n = nullptr;
+            while (!n && (frames_.size() != base)) {
+                const auto f = frames_.back();
+                if (f.n->kind() == node_kind::BLOCK) {
+                    auto v = static_cast<const block*>(f.n);
+                    if (f.next != 0) {
+                        after_statement(v, f.next - 1);
+                    }
+                    if (f.next != v->statement_count()) {
+                        ++frames_.back().next;
+                        before_statement(v, f.next);
+                        n = v->statement(f.next);
+                    } else {
+                        frames_.pop_back();
+                        leave_block(v);
+                    }
+                } else if (f.next == 0) {
+                    frames_.back().next = 1;
+                    n = static_cast<const if_stmt*>(f.n)->body();
+                } else {
+                    frames_.pop_back();
+                    leave_if(static_cast<const if_stmt*>(f.n));
+                }
+            }
         }
     }
 
@@ -10,16 +10,25 @@
 
 #include "ir/nodes_fwd.hpp"
 
-#include <functional>
+#include <vector>
 
 namespace pcsh {
 namespace ir {
 
-    using stmt_visit_cbk = std::function<void(const node* a, bool islast)>;
-
+    // The default handlers of expression nodes queue the operands instead of
+    // visiting them on the call stack; the queue is visited after each
+    // statement and if condition, in the order recursion would have. A
+    // handler that visits operands itself must not rely on the defaults for
+    // them.
+    //
+    // Blocks and if statements are not handled but walked with the ones being
+    // visited kept on the heap, calling the same hooks as static_visitor.
     class node_visitor
     {
       public:
+        inline node_visitor() : pending_(), frames_()
+        { }
+
         inline virtual ~node_visitor()
         { }
 
@@ -78,15 +87,8 @@ namespace ir {
             visit_impl(v);
         }
 
-        inline void visit(const block* v)
-        {
-            visit_impl(v);
-        }
-
-        inline void visit(const if_stmt* v)
-        {
-            visit_impl(v);
-        }
+        void visit(const block* v);
+        void visit(const if_stmt* v);
 
         inline void visit(const comp_equals* v)
         {
@@ -94,16 +96,47 @@ namespace ir {
         }
 
       private:
+        // a block or if statement being visited
+        struct frame
+        {
+            const node* n;
+            size_t next;        // statement of a block, or 1 once an if body is visited
+        };
+
+        std::vector<const node*> pending_;
+        std::vector<frame> frames_;
+
         void visit_impl_binary_op(const void* v);
         void visit_impl_unary_op(const void* v);
 
+        // visits what the statement just visited left queued
+        void visit_pending(size_t base);
+
+        void visit_statements(const node* n);
+
       protected:
-        void visit_block(const block* v);
-        void visit_block_precbk(const block* v, stmt_visit_cbk cbk);
-        void visit_block_postcbk(const block* v, stmt_visit_cbk cbk);
-        void visit_block_cbk(const block* v, stmt_visit_cbk precbk, stmt_visit_cbk postcbk);
+        // visits an expression and what its handlers queue
+        void visit_expression(const node* n);
 
       private:
+        virtual void enter_block(const block* v)
+        { }
+
+        virtual void leave_block(const block* v)
+        { }
+
+        virtual void before_statement(const block* v, size_t i)
+        { }
+
+        virtual void after_statement(const block* v, size_t i)
+        { }
+
+        // visits the condition; false skips the body and leave_if(v)
+        virtual bool enter_if(const if_stmt* v);
+
+        virtual void leave_if(const if_stmt* v)
+        { }
+
         virtual void visit_impl(const variable* v)
         { }
 
@@ -152,8 +185,6 @@ namespace ir {
         }
 
         virtual void visit_impl(const assign* v);
-        virtual void visit_impl(const block* v);
-        virtual void visit_impl(const if_stmt* v);
     };
 
 }//namespace ir
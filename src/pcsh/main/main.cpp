@@ -7,14 +7,17 @@
 #include "pcsh/ir.hpp"
 #include "pcsh/ir_operations.hpp"
 #include "pcsh/parser.hpp"
+#include "pcsh/pass_manager.hpp"
 
 #include "linebufistream.hpp"
+#include "mappedfile.hpp"
 
+#include <cstring>
 #include <fstream>
 
 void die_usage(int e)
 {
-    std::cout << "pcsh [-h | filename]\n";
+    std::cout << "pcsh [-h] [--time-passes] [filename]\n";
     exit(e);
 }
 
@@ -39,16 +42,21 @@ void die_if_unable_to_open_file(std::ifstream& in, const std::string& fn)
     }
 }
 
-void run(std::istream& in, pcsh::ostream& out)
+void run(pcsh::parser::parser&& p, pcsh::ostream& out, bool timepasses)
 {
     using namespace pcsh;
 
     ir::tree::ptr treep;
+    ir::pass_manager passes;
+    passes.set_timing(timepasses);
     try {
-        treep = parser::parser(in).parse_to_tree();
+        treep = p.parse_to_tree(passes);
     } catch(...) {
         die_handling_exception();
     }
+    if (timepasses) {
+        passes.report(std::cerr);
+    }
 
     //ir::print(treep.get(), out);
 
@@ -63,22 +71,39 @@ void run(std::istream& in, pcsh::ostream& out)
 
 int main(int argc, const char* argv[])
 {
-    if (argc == 1) {
-        pcsh::linebuff_istream in(std::cin);
-        auto& out = std::cout;
-        run(in, out);
-    } else if (argc == 2) {
-        if (::strcmp(argv[1], "-h") == 0) {
+    bool timepasses = false;
+    const char* filename = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (::strcmp(argv[i], "-h") == 0) {
             die_usage(0);
+        } else if (::strcmp(argv[i], "--time-passes") == 0) {
+            timepasses = true;
+        } else if (!filename) {
+            filename = argv[i];
+        } else {
+            die_usage(1);
         }
-        std::ifstream fs(argv[1], std::ios_base::in | std::ios_base::binary);
-        die_if_unable_to_open_file(fs, argv[1]);
-        pcsh::linebuff_istream in(fs);
-        auto& out = std::cout;
-        run(in, out);
-    } else {
-        die_usage(1);
     }
 
+    auto& out = std::cout;
+    if (!filename) {
+        pcsh::linebuff_istream in(std::cin);
+        run(pcsh::parser::parser(in), out, timepasses);
+        return 0;
+    }
+    // regular files are lexed straight from the mapping
+    pcsh::mapped_file mf(filename);
+    if (mf.mapped()) {
+        // like linebuff_istream, stop at an end-of-transmission character
+        auto eot = static_cast<const char*>(::memchr(mf.data(), EOT_CHAR_DEF, mf.size()));
+        auto len = eot ? static_cast<size_t>(eot - mf.data()) : mf.size();
+        run(pcsh::parser::parser(mf.data(), len), out, timepasses);
+        return 0;
+    }
+    std::ifstream fs(filename, std::ios_base::in | std::ios_base::binary);
+    die_if_unable_to_open_file(fs, filename);
+    pcsh::linebuff_istream in(fs);
+    run(pcsh::parser::parser(in), out, timepasses);
+
     return 0;
 }
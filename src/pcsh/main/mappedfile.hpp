@@ -0,0 +1,78 @@
+/**
+ * \file mappedfile.hpp
+ * \date Oct 17, 2026
+ */
+
+#ifndef PCSH_MAPPEDFILE_HPP
+#define PCSH_MAPPEDFILE_HPP
+
+#include "pcsh/noncopyable.hpp"
+
+#include <cstddef>
+
+#if !defined(_WIN32)
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif//!defined(_WIN32)
+
+namespace pcsh {
+
+    /// read-only mapping of a regular file. `mapped()' is false for anything
+    /// that cannot be mapped (pipes, devices, empty files) and callers fall
+    /// back to reading a stream.
+    class mapped_file : public noncopyable
+    {
+      private:
+        const char* data_;
+        size_t      size_;
+      public:
+        explicit mapped_file(const char* path) : data_(nullptr), size_(0)
+        {
+#if !defined(_WIN32)
+            int fd = ::open(path, O_RDONLY);
+            if (fd < 0) {
+                return;
+            }
+            struct stat st;
+            if ((::fstat(fd, &st) == 0) && S_ISREG(st.st_mode) && (st.st_size > 0)) {
+                void* p = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p != MAP_FAILED) {
+                    ::madvise(p, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+                    data_ = static_cast<const char*>(p);
+                    size_ = static_cast<size_t>(st.st_size);
+                }
+            }
+            ::close(fd);
+#endif//!defined(_WIN32)
+        }
+
+        ~mapped_file()
+        {
+#if !defined(_WIN32)
+            if (data_) {
+                ::munmap(const_cast<char*>(data_), size_);
+            }
+#endif//!defined(_WIN32)
+        }
+
+        inline bool mapped() const
+        {
+            return data_ != nullptr;
+        }
+
+        inline const char* data() const
+        {
+            return data_;
+        }
+
+        inline size_t size() const
+        {
+            return size_;
+        }
+    };
+
+}//namespace pcsh
+
+#endif/*PCSH_MAPPEDFILE_HPP*/
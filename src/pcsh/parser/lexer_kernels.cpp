@@ -0,0 +1,377 @@
+/**
+ * \file lexer_kernels.cpp
+ * \date Oct 17, 2026
+ */
+
+#include "pcsh/parser.hpp"
+
+#include "parser/lexer_kernels.hpp"
+
+#include <cstring>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#  define PCSH_LEXER_X86 1
+#  include <immintrin.h>
+#endif
+
+namespace pcsh {
+namespace parser {
+namespace kernels {
+
+    namespace {
+
+        //////////////////////////////////////////////////////////////////////
+        /// scalar
+        //////////////////////////////////////////////////////////////////////
+
+        const char* skip_whitespace_scalar(const char* p, const char* end)
+        {
+            while ((p != end) && tokenize::is_whitespace(*p)) {
+                ++p;
+            }
+            return p;
+        }
+
+        const char* find_newline_scalar(const char* p, const char* end)
+        {
+            while ((p != end) && !tokenize::is_newline(*p)) {
+                ++p;
+            }
+            return p;
+        }
+
+        const char* skip_symbol_scalar(const char* p, const char* end)
+        {
+            while ((p != end) && tokenize::is_symbol_char(*p)) {
+                ++p;
+            }
+            return p;
+        }
+
+        const char* skip_digits_scalar(const char* p, const char* end)
+        {
+            while ((p != end) && tokenize::is_digit(*p)) {
+                ++p;
+            }
+            return p;
+        }
+
+        newline_count count_newlines_scalar(const char* p, const char* end, char prev)
+        {
+            newline_count res = { 0, nullptr };
+            for (; p != end; ++p) {
+                char c = *p;
+                if (c == '\n') {
+                    res.lines += (prev != '\r');
+                    res.last = p;
+                } else if (c == '\r') {
+                    ++res.lines;
+                    res.last = p;
+                }
+                prev = c;
+            }
+            return res;
+        }
+
+        const kernel_table scalar_table = {
+            "scalar",
+            skip_whitespace_scalar,
+            find_newline_scalar,
+            skip_symbol_scalar,
+            skip_digits_scalar,
+            count_newlines_scalar
+        };
+
+#if defined(PCSH_LEXER_X86)
+
+        // Both vector widths find the first byte in or out of a class from
+        // a movemask; the scalar kernels finish the last partial block.
+
+        inline unsigned first_bit(unsigned m)
+        {
+            return static_cast<unsigned>(__builtin_ctz(m));
+        }
+
+        inline unsigned last_bit(unsigned m)
+        {
+            return 31u - static_cast<unsigned>(__builtin_clz(m));
+        }
+
+        //////////////////////////////////////////////////////////////////////
+        /// sse2 : 16 bytes at a time
+        //////////////////////////////////////////////////////////////////////
+
+        inline __m128i in_range16(__m128i v, char lo, char hi)
+        {
+            return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1)), _mm_cmpgt_epi8(_mm_set1_epi8(hi + 1), v));
+        }
+
+        inline unsigned whitespace_mask16(__m128i v)
+        {
+            auto sp = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\t')));
+            auto nl = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')));
+            return static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(sp, nl)));
+        }
+
+        inline unsigned digit_mask16(__m128i v)
+        {
+            return static_cast<unsigned>(_mm_movemask_epi8(in_range16(v, '0', '9')));
+        }
+
+        inline unsigned symbol_mask16(__m128i v)
+        {
+            // setting 0x20 folds upper case onto lower case and moves no
+            // other byte into [a-z]
+            auto alpha = in_range16(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z');
+            auto digit = in_range16(v, '0', '9');
+            auto under = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+            return static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(alpha, digit), under)));
+        }
+
+        inline __m128i load16(const char* p)
+        {
+            return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        }
+
+        const char* skip_whitespace_sse2(const char* p, const char* end)
+        {
+            for (; end - p >= 16; p += 16) {
+                unsigned out = ~whitespace_mask16(load16(p)) & 0xFFFFu;
+                if (out) {
+                    return p + first_bit(out);
+                }
+            }
+            return skip_whitespace_scalar(p, end);
+        }
+
+        const char* find_newline_sse2(const char* p, const char* end)
+        {
+            for (; end - p >= 16; p += 16) {
+                auto v = load16(p);
+                auto nl = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')));
+                unsigned in = static_cast<unsigned>(_mm_movemask_epi8(nl));
+                if (in) {
+                    return p + first_bit(in);
+                }
+            }
+            return find_newline_scalar(p, end);
+        }
+
+        const char* skip_symbol_sse2(const char* p, const char* end)
+        {
+            for (; end - p >= 16; p += 16) {
+                unsigned out = ~symbol_mask16(load16(p)) & 0xFFFFu;
+                if (out) {
+                    return p + first_bit(out);
+                }
+            }
+            return skip_symbol_scalar(p, end);
+        }
+
+        const char* skip_digits_sse2(const char* p, const char* end)
+        {
+            for (; end - p >= 16; p += 16) {
+                unsigned out = ~digit_mask16(load16(p)) & 0xFFFFu;
+                if (out) {
+                    return p + first_bit(out);
+                }
+            }
+            return skip_digits_scalar(p, end);
+        }
+
+        newline_count count_newlines_sse2(const char* p, const char* end, char prev)
+        {
+            newline_count res = { 0, nullptr };
+            unsigned carry = (prev == '\r');
+            for (; end - p >= 16; p += 16) {
+                auto v = load16(p);
+                unsigned n = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))));
+                unsigned r = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))));
+                if (n | r) {
+                    // a '\n' right after a '\r' ends the same line
+                    unsigned joined = (r & (n >> 1)) | (carry & n & 1u);
+                    res.lines += __builtin_popcount(n) + __builtin_popcount(r) - __builtin_popcount(joined);
+                    res.last = p + last_bit(n | r);
+                }
+                carry = (r >> 15) & 1u;
+            }
+            if (p != end) {
+                auto tail = count_newlines_scalar(p, end, carry ? '\r' : '\0');
+                res.lines += tail.lines;
+                res.last = tail.last ? tail.last : res.last;
+            }
+            return res;
+        }
+
+        const kernel_table sse2_table = {
+            "sse2",
+            skip_whitespace_sse2,
+            find_newline_sse2,
+            skip_symbol_sse2,
+            skip_digits_sse2,
+            count_newlines_sse2
+        };
+
+        //////////////////////////////////////////////////////////////////////
+        /// avx2 : 32 bytes at a time, selected at run time
+        //////////////////////////////////////////////////////////////////////
+
+#  define PCSH_AVX2 __attribute__((target("avx2,popcnt")))
+
+        PCSH_AVX2 inline __m256i in_range32(__m256i v, char lo, char hi)
+        {
+            return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(lo - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), v));
+        }
+
+        PCSH_AVX2 inline __m256i load32(const char* p)
+        {
+            return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        }
+
+        PCSH_AVX2 const char* skip_whitespace_avx2(const char* p, const char* end)
+        {
+            for (; end - p >= 32; p += 32) {
+                auto v = load32(p);
+                auto sp = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')));
+                auto nl = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')));
+                unsigned out = ~static_cast<unsigned>(_mm256_movemask_epi8(_mm256_or_si256(sp, nl)));
+                if (out) {
+                    return p + first_bit(out);
+                }
+            }
+            return skip_whitespace_sse2(p, end);
+        }
+
+        PCSH_AVX2 const char* find_newline_avx2(const char* p, const char* end)
+        {
+            for (; end - p >= 32; p += 32) {
+                auto v = load32(p);
+                auto nl = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')));
+                unsigned in = static_cast<unsigned>(_mm256_movemask_epi8(nl));
+                if (in) {
+                    return p + first_bit(in);
+                }
+            }
+            return find_newline_sse2(p, end);
+        }
+
+        PCSH_AVX2 const char* skip_symbol_avx2(const char* p, const char* end)
+        {
+            for (; end - p >= 32; p += 32) {
+                auto v = load32(p);
+                auto alpha = in_range32(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 'z');
+                auto digit = in_range32(v, '0', '9');
+                auto under = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'));
+                unsigned out = ~static_cast<unsigned>(_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(alpha, digit), under)));
+                if (out) {
+                    return p + first_bit(out);
+                }
+            }
+            return skip_symbol_sse2(p, end);
+        }
+
+        PCSH_AVX2 const char* skip_digits_avx2(const char* p, const char* end)
+        {
+            for (; end - p >= 32; p += 32) {
+                unsigned out = ~static_cast<unsigned>(_mm256_movemask_epi8(in_range32(load32(p), '0', '9')));
+                if (out) {
+                    return p + first_bit(out);
+                }
+            }
+            return skip_digits_sse2(p, end);
+        }
+
+        PCSH_AVX2 newline_count count_newlines_avx2(const char* p, const char* end, char prev)
+        {
+            newline_count res = { 0, nullptr };
+            unsigned carry = (prev == '\r');
+            for (; end - p >= 32; p += 32) {
+                auto v = load32(p);
+                unsigned n = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))));
+                unsigned r = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r'))));
+                if (n | r) {
+                    unsigned joined = (r & (n >> 1)) | (carry & n & 1u);
+                    res.lines += __builtin_popcount(n) + __builtin_popcount(r) - __builtin_popcount(joined);
+                    res.last = p + last_bit(n | r);
+                }
+                carry = r >> 31;
+            }
+            if (p != end) {
+                auto tail = count_newlines_sse2(p, end, carry ? '\r' : '\0');
+                res.lines += tail.lines;
+                res.last = tail.last ? tail.last : res.last;
+            }
+            return res;
+        }
+
+#  undef PCSH_AVX2
+
+        const kernel_table avx2_table = {
+            "avx2",
+            skip_whitespace_avx2,
+            find_newline_avx2,
+            skip_symbol_avx2,
+            skip_digits_avx2,
+            count_newlines_avx2
+        };
+
+        bool has_avx2()
+        {
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+        }
+
+#endif//defined(PCSH_LEXER_X86)
+
+        const kernel_table* best()
+        {
+#if defined(PCSH_LEXER_X86)
+            return has_avx2() ? &avx2_table : &sse2_table;
+#else
+            return &scalar_table;
+#endif//defined(PCSH_LEXER_X86)
+        }
+
+    }//namespace
+
+    namespace detail {
+        // usable before dynamic initialization, then upgraded below
+        std::atomic<const kernel_table*> active(&scalar_table);
+
+        static const bool selected = (active.store(best(), std::memory_order_relaxed), true);
+    }//namespace detail
+
+    const kernel_table* find(cstring name)
+    {
+        if (::strcmp(name, scalar_table.name) == 0) {
+            return &scalar_table;
+        }
+#if defined(PCSH_LEXER_X86)
+        if (::strcmp(name, sse2_table.name) == 0) {
+            return &sse2_table;
+        }
+        if ((::strcmp(name, avx2_table.name) == 0) && has_avx2()) {
+            return &avx2_table;
+        }
+#endif//defined(PCSH_LEXER_X86)
+        return nullptr;
+    }
+
+}//namespace kernels
+
+    cstring lexer_kernels()
+    {
+        return kernels::active().name;
+    }
+
+    bool select_lexer_kernels(cstring name)
+    {
+        auto k = kernels::find(name);
+        if (k) {
+            kernels::detail::active.store(k, std::memory_order_relaxed);
+        }
+        return k != nullptr;
+    }
+
+}//namespace parser
+}//namespace pcsh
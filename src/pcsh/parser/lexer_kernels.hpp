@@ -0,0 +1,135 @@
+/**
+ * \file lexer_kernels.hpp
+ * \date Oct 17, 2026
+ */
+
+#ifndef PCSH_PARSER_LEXER_KERNELS_HPP
+#define PCSH_PARSER_LEXER_KERNELS_HPP
+
+#include "pcsh/types.hpp"
+
+#include <atomic>
+#include <cstddef>
+
+namespace pcsh {
+namespace parser {
+
+    //////////////////////////////////////////////////////////////////////////
+    /// character classes
+    //////////////////////////////////////////////////////////////////////////
+
+    namespace tokenize {
+
+        inline bool is_sign(char c)
+        {
+            return (c == '+') || (c == '-');
+        }
+
+        inline bool is_newline(char c)
+        {
+            return (c == '\n') || (c == '\r');
+        }
+
+        inline bool is_space(char c)
+        {
+            return (c == '\t') || (c == ' ');
+        }
+
+        inline bool is_whitespace(char c)
+        {
+            return is_newline(c) || is_space(c);
+        }
+
+        inline bool is_digit(char c)
+        {
+            return (c >= '0') && (c <= '9');
+        }
+
+        inline bool is_lower_alpha(char c)
+        {
+            return (c >= 'a') && (c <= 'z');
+        }
+
+        inline bool is_upper_alpha(char c)
+        {
+            return (c >= 'A') && (c <= 'Z');
+        }
+
+        inline char to_lower(char c)
+        {
+            return (c - 'A' + 'a');
+        }
+
+        inline char to_upper(char c)
+        {
+            return (c - 'a' + 'A');
+        }
+
+        inline bool is_comment_char(char c)
+        {
+            return (c == '#');
+        }
+
+        inline bool is_symbol_char(char c)
+        {
+            return is_digit(c) || is_lower_alpha(c) || is_upper_alpha(c) || (c == '_');
+        }
+
+        inline bool is_start_of_number(char c, char n, char o)
+        {
+            return is_digit(c) || ((is_sign(c) || (c == '.')) && is_digit(n)) || (is_sign(c) && (n == '.') && is_digit(o));
+        }
+
+    }//namespace tokenize
+
+    //////////////////////////////////////////////////////////////////////////
+    /// kernels : classify a run of bytes at a time
+    //////////////////////////////////////////////////////////////////////////
+
+    namespace kernels {
+
+        struct newline_count
+        {
+            size_t lines;
+            const char* last;   // last newline character, or nullptr
+        };
+
+        // Each scan returns the first byte in [p, end) outside its class, or
+        // `end'. None of them reads past `end'.
+        using scan_fn = const char* (*)(const char* p, const char* end);
+
+        // Counts line breaks in [p, end); "\r\n" is one break. `prev' is the
+        // byte before `p' so a pair split across calls is counted once.
+        using count_fn = newline_count (*)(const char* p, const char* end, char prev);
+
+        struct kernel_table
+        {
+            cstring name;
+            scan_fn skip_whitespace;
+            scan_fn find_newline;
+            scan_fn skip_symbol;
+            scan_fn skip_digits;
+            count_fn count_newlines;
+        };
+
+        namespace detail {
+            // swapped by select_lexer_kernels while other threads may lex
+            extern std::atomic<const kernel_table*> active;
+        }//namespace detail
+
+        /// kernels picked for this CPU at start up
+        inline const kernel_table& active()
+        {
+            return *detail::active.load(std::memory_order_relaxed);
+        }
+
+        /// kernels by name ("avx2", "sse2" or "scalar"); nullptr if this
+        /// build or CPU does not support them
+        const kernel_table* find(cstring name);
+
+    }//namespace kernels
+
+}//namespace parser
+}//namespace pcsh
+
+#endif/*PCSH_PARSER_LEXER_KERNELS_HPP*/
@@ -13,9 +13,10 @@
 
 #include "ir/nodes.hpp"
 #include "ir/passes/type_checker.hpp"
-#include "ir/tree_validation.hpp"
+#include "parser/lexer_kernels.hpp"
 #include "parser/parser_engine.hpp"
 
+#include <algorithm>
 #include <cstring>
 #include <string>
 
@@ -219,70 +220,6 @@ namespace parser {
     /// parser
     //////////////////////////////////////////////////////////////////////////
 
-    namespace tokenize {
-
-        PCSH_INLINE bool is_sign(char c)
-        {
-            return (c == '+') || (c == '-');
-        }
-
-        PCSH_INLINE bool is_newline(char c)
-        {
-            return (c == '\n') || (c == '\r');
-        }
-
-        PCSH_INLINE bool is_space(char c)
-        {
-            return (c == '\t') || (c == ' ');
-        }
-
-        PCSH_INLINE bool is_whitespace(char c)
-        {
-            return is_newline(c) || is_space(c);
-        }
-
-        PCSH_INLINE bool is_digit(char c)
-        {
-            return (c >= '0') && (c <= '9');
-        }
-
-        PCSH_INLINE bool is_lower_alpha(char c)
-        {
-            return (c >= 'a') && (c <= 'z');
-        }
-
-        PCSH_INLINE bool is_upper_alpha(char c)
-        {
-            return (c >= 'A') && (c <= 'Z');
-        }
-
-        PCSH_INLINE char to_lower(char c)
-        {
-            return (c - 'A' + 'a');
-        }
-
-        PCSH_INLINE char to_upper(char c)
-        {
-            return (c - 'a' + 'A');
-        }
-
-        PCSH_INLINE bool is_comment_char(char c)
-        {
-            return (c == '#');
-        }
-
-        PCSH_INLINE bool is_symbol_char(char c)
-        {
-            return is_digit(c) || is_lower_alpha(c) || is_upper_alpha(c) || (c == '_');
-        }
-
-        PCSH_INLINE bool is_start_of_number(char c, char n, char o)
-        {
-            return is_digit(c) || ((is_sign(c) || (c == '.')) && is_digit(n)) || (is_sign(c) && (n == '.') && is_digit(o));
-        }
-
-    }//namespace tokenize
-
 #if defined(_MSC_VER)
 #  pragma warning(disable:4351)
 #endif // defined(_MSC_VER)
@@ -335,23 +272,35 @@ namespace parser {
 #endif // defined(_MSC_VER)
 
     /// buffered_stream
+    //
+    // Reads either from an std::istream through a sliding window, or directly
+    // from a caller owned memory range that is never copied.
+    //
+    // Token text points into the window and is only valid until the next
+    // peek or advance; the parser copies what it keeps into the tree's arena.
+    // Consumed characters are dropped when the window is refilled, so memory
+    // is bounded by the longest token rather than the input size.
     class parser::buffered_stream
     {
       public:
         static const int EOS = -1;
       public:
-        buffered_stream(std::istream& is) : strm_(is), buffer_(), buffpos_(0), buffsz_(0), pos_(0)
+        buffered_stream(std::istream& is) : strm_(&is), buffer_(), data_(&buffer_[0]), buffpos_(0), buffsz_(0), pos_(0)
+        {
+        }
+
+        buffered_stream(const char* buf, size_t len) : strm_(nullptr), buffer_(), data_(buf), buffpos_(0), buffsz_(len), pos_(0)
         {
         }
 
         PCSH_INLINE const char* buff() const
         {
-            return &buffer_[buffpos_];
+            return data_ + buffpos_;
         }
 
         PCSH_INLINE int peek_at(pos_t pos)
         {
-            return has_chars(pos + 1) ? buffer_[buffpos_ + pos] : EOS;
+            return has_chars(pos + 1) ? data_[buffpos_ + pos] : EOS;
         }
 
         PCSH_INLINE pos_t pos() const
@@ -359,6 +308,61 @@ namespace parser {
             return pos_ + buffpos_;
         }
 
+        // input left to read if known up front, otherwise 0
+        size_t size_hint() const
+        {
+            return strm_ ? 0 : buffsz_ - buffpos_;
+        }
+
+        // first position at or after `p' where `fn' stops, or the end of input
+        PCSH_INLINE pos_t scan(pos_t p, kernels::scan_fn fn)
+        {
+            while (has_chars(p + 1)) {
+                auto b = data_ + buffpos_;
+                auto avail = buffsz_ - buffpos_;
+                auto q = static_cast<pos_t>(fn(b + p, b + avail) - b);
+                if (q < avail) {
+                    return q;
+                }
+                p = q;
+            }
+            return p;
+        }
+
+        // line breaks in the next `len' characters; `*last' is set to the
+        // position of the last one, if any
+        size_t count_newlines(pos_t len, pos_t* last)
+        {
+            size_t lines = 0;
+            char prev = '\0';
+            if (PCSH_LIKELY((len < SHORT_RANGE) && has_chars(len))) {
+                // a token and the blanks before it; not worth a kernel call
+                const char* b = buff();
+                for (pos_t p = 0; p != len; ++p) {
+                    char c = b[p];
+                    if (PCSH_UNLIKELY(tokenize::is_newline(c))) {
+                        lines += (c == '\r') || (prev != '\r');
+                        *last = p;
+                    }
+                    prev = c;
+                }
+                return lines;
+            }
+            pos_t p = 0;
+            while ((p < len) && has_chars(p + 1)) {
+                auto b = data_ + buffpos_;
+                auto stop = std::min(len, buffsz_ - buffpos_);
+                auto res = kernels::active().count_newlines(b + p, b + stop, prev);
+                lines += res.lines;
+                if (res.last) {
+                    *last = static_cast<pos_t>(res.last - b);
+                }
+                prev = b[stop - 1];
+                p = stop;
+            }
+            return lines;
+        }
+
         void advance(pos_t n = 1)
         {
             size_t nleft = buffsz_ - buffpos_;
@@ -386,19 +390,24 @@ namespace parser {
 
         void sync_stream()
         {
-            strm_.seekg(pos_ + buffpos_, strm_.beg);
-            if (!strm_.good()) {
-                strm_.clear();
+            if (!strm_) {
+                return;
+            }
+            strm_->seekg(pos_ + buffpos_, strm_->beg);
+            if (!strm_->good()) {
+                strm_->clear();
             }
             pos_ += buffpos_;
             buffpos_ = 0;
             buffsz_ = 0;
         }
       private:
-        static const int INIT_SIZE = 256;
+        static const int WINDOW_SIZE = 4096;
+        static const int SHORT_RANGE = 16;
 
-        std::istream&          strm_;
-        flex_buffer<INIT_SIZE> buffer_;
+        std::istream*            strm_;
+        flex_buffer<WINDOW_SIZE> buffer_;
+        const char*            data_;
         pos_t                  buffpos_;
         pos_t                  buffsz_;
         pos_t                  pos_;
@@ -414,17 +423,31 @@ namespace parser {
 
         void fill_buffer(pos_t n)
         {
-            n = std::max(n, pos_t(INIT_SIZE));
+            if (!strm_) {
+                // a memory range is complete from the start
+                return;
+            }
+
+            // slide the window past the consumed characters
+            if (buffpos_ > 0) {
+                ::memmove(&buffer_[0], &buffer_[buffpos_], buffsz_ - buffpos_);
+                pos_ += buffpos_;
+                buffsz_ -= buffpos_;
+                buffpos_ = 0;
+            }
 
-            if ((buffpos_ + n) > buffer_.size()) {
-                buffer_.resize(buffpos_ + n);
+            // only grows for a token longer than the window
+            n = std::max(n, pos_t(WINDOW_SIZE));
+            if (n > buffer_.size()) {
+                buffer_.resize(n);
             }
+            data_ = &buffer_[0];
 
-            strm_.read(&buffer_[buffsz_], n - (buffsz_ - buffpos_));
-            buffsz_ += (pos_t)strm_.gcount();
+            strm_->read(&buffer_[buffsz_], buffer_.size() - buffsz_);
+            buffsz_ += (pos_t)strm_->gcount();
 
-            if (!strm_.good()) {
-                strm_.clear();
+            if (!strm_->good()) {
+                strm_->clear();
             }
         }
     };
@@ -475,18 +498,12 @@ namespace parser {
 
     void parser::advance(pos_t len, bool countnl)
     {
-        pos_t p = 0;
         if (PCSH_LIKELY(countnl)) {
-            while (p < len) {
-                int c = strm_->peek_at(p);
-                if (PCSH_UNLIKELY(tokenize::is_newline(c))) {
-                    if (c == '\r' && strm_->peek_at(p + 1) == '\n') {
-                        ++p;
-                    }
-                    ++line_;
-                    line_start_ = strm_->pos() + p;
-                }
-                ++p;
+            pos_t last = 0;
+            auto lines = strm_->count_newlines(len, &last);
+            if (lines) {
+                line_ += static_cast<int>(lines);
+                line_start_ = strm_->pos() + last;
             }
         }
         strm_->advance(len);
@@ -494,6 +511,25 @@ namespace parser {
 
     parser::parser(std::istream& is, const std::string& filename)
       : strm_(new buffered_stream(is))
+      , toks_(nullptr)
+      , line_(1)
+      , line_start_(0)
+      , filename_(filename)
+    {
+    }
+
+    parser::parser(const char* buf, size_t len, const std::string& filename)
+      : strm_(new buffered_stream(buf, len))
+      , toks_(nullptr)
+      , line_(1)
+      , line_start_(0)
+      , filename_(filename)
+    {
+    }
+
+    parser::parser(const token_stream& toks, const std::string& filename)
+      : strm_(new buffered_stream(toks.data(), toks.bytes()))
+      , toks_(&toks)
       , line_(1)
       , line_start_(0)
       , filename_(filename)
@@ -519,30 +555,25 @@ namespace parser {
             return p;
         }
         while (true) {
-            c = strm_->peek_at(p);
             if (is_whitespace(c)) {
-                ++p;
-            } else if (is_comment_char(c)) {
-                ++p;
-                p = skip_till_line_end(p);
-            } else {
+                // most runs are a single blank
+                c = strm_->peek_at(++p);
+                if (is_whitespace(c)) {
+                    p = strm_->scan(p, kernels::active().skip_whitespace);
+                    c = strm_->peek_at(p);
+                }
+            }
+            if (!is_comment_char(c)) {
                 return p;
             }
+            p = skip_till_line_end(p + 1);
+            c = strm_->peek_at(p);
         }
     }
 
     pos_t parser::skip_till_line_end(pos_t p)
     {
-        using namespace tokenize;
-        while (true) {
-            int c = strm_->peek_at(p);
-            if (PCSH_UNLIKELY(is_newline(c))) {
-                return p;
-            } else if (PCSH_UNLIKELY(c == strm_->EOS)) {
-                return p;
-            }
-            ++p;
-        }
+        return strm_->scan(p, kernels::active().find_newline);
     }
 
     token parser::read_string(pos_t p)
@@ -602,19 +633,13 @@ namespace parser {
         auto pstart = p;
 
         // find digits end
-        auto digend = p;
-        while (is_digit(strm_->peek_at(digend))) {
-            ++digend;
-        }
+        auto digend = strm_->scan(p, kernels::active().skip_digits);
 
         // has decimal
         auto hasdec = strm_->peek_at(digend) == '.';
 
         // has fraction
-        auto fracend = digend + hasdec;
-        while (is_digit(strm_->peek_at(fracend))) {
-            ++fracend;
-        }
+        auto fracend = strm_->scan(digend + hasdec, kernels::active().skip_digits);
 
         bool hasbegdig = p != digend;
         bool hasfracpart = hasdec && ((digend + hasdec) != fracend);
@@ -632,9 +657,7 @@ namespace parser {
     {
         using namespace tokenize;
         auto pstart = p;
-        while (is_symbol_char(strm_->peek_at(p))) {
-            ++p;
-        }
+        p = strm_->scan(p, kernels::active().skip_symbol);
         if (p != pstart) {
             buff_string bs { strm_->buff() + pstart, p - pstart };
             if (bs.equals("if")) {
@@ -656,16 +679,38 @@ namespace parser {
 
     ir::tree::ptr parser::parse_to_tree()
     {
-        auto treeptr = ir::tree::create();
-        source_map sm;
-        sm.reserve(20);
-        parser_engine eng(*this, treeptr->get_arena());
-        treeptr->set_root(eng.parse(sm));
+        ir::pass_manager passes;
+        return parse_to_tree(passes);
+    }
+
+    ir::tree::ptr parser::parse_to_tree(ir::pass_manager& passes)
+    {
+        // a tree takes a few bytes per byte of source; sizing the arena for
+        // it up front saves growing through many small segments. The first
+        // segment is capped so a huge script does not ask for one block
+        // several times its size; the rest comes in segments as big.
+        static const size_t TREE_BYTES_PER_BYTE = 8;
+        static const size_t MAX_INITIAL_SEGMENTS = 16;
+        arena_policy policy;
+        auto cap = MAX_INITIAL_SEGMENTS * policy.max_segment;
+        auto hint = strm_->size_hint();
+        policy.initial = std::max(policy.initial, (hint < cap / TREE_BYTES_PER_BYTE) ? TREE_BYTES_PER_BYTE * hint : cap);
+        policy.max_segment = std::max(policy.max_segment, policy.initial);
+        auto treeptr = ir::tree::create(policy);
+        // parse time bookkeeping lives apart from the tree
+        arena scratch;
+        source_map sm(scratch);
+        parser_engine eng(*this, treeptr->get_arena(), scratch);
+        passes.measure("parse", *treeptr, [&] { treeptr->set_root(eng.parse(sm)); });
         try {
-            validate_tree(treeptr);
+            passes.run(*treeptr);
         } catch(const ir::type_checker_error& ex) {
-            const source_info& info = sm[ex.left];
-            throw_parser_exception(ex.msg, info.filename, info.fcn, info.line);
+            auto loc = sm.find(ex.left);
+            if (!loc) {
+                throw_parser_exception(ex.msg, "", "", "");
+            }
+            const auto& linestr = "line " + std::to_string(loc->line) + ", char " + std::to_string(loc->column);
+            throw_parser_exception(ex.msg, sm.name(loc->file), sm.name(loc->fcn), linestr);
         }
         return treeptr;
     }
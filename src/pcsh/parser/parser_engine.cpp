@@ -6,6 +6,9 @@
 #include "ir/nodes.hpp"
 #include "parser/parser_engine.hpp"
 
+#include <cstdlib>
+#include <cstring>
+#include <string>
 #include <vector>
 
 #define ENSURE(x, msg)                    \
@@ -18,6 +21,12 @@ namespace parser {
 
     int parser::parser_engine::throw_error(cstring msg)
     {
+        if (toks_) {
+            const auto& linestr = "line " + std::to_string(toks_->line(idx_)) + ", char " + std::to_string(toks_->column(idx_));
+            std::string message(msg);
+            message += "\n\tnear: \"" + parser_.copy_line(toks_->offset(idx_)) + "\"";
+            throw_parser_exception(message, parser_.filename_, func_, linestr);
+        }
         pos_t ws = 0;
         parser_.peek(ws, &ws);
         parser_.advance(ws);
@@ -39,7 +48,7 @@ namespace parser {
     void parser::parser_engine::do_peek()
     {
         PCSH_ASSERT(ws_ == 0);
-        auto t = parser_.peek(0, &ws_);
+        auto t = toks_ ? toks_->get(idx_) : parser_.peek(0, &ws_);
         if (PCSH_UNLIKELY(t.is_a(token_type::FAIL))) {
             throw_error(t.str().ptr);
         }
@@ -52,7 +61,9 @@ namespace parser {
     {
         PCSH_ASSERT(parsed_);
         token t = curr_;
-        if (!t.is_a(token_type::QUOTE)) {
+        if (toks_) {
+            ++idx_;
+        } else if (!t.is_a(token_type::QUOTE)) {
             parser_.advance(ws_ + t.length());
         } else {
             parser_.advance(ws_ + t.length() + 2, false);
@@ -64,6 +75,20 @@ namespace parser {
 #endif // !defined(NDEBUG)
     }
 
+    PCSH_INLINE source_loc parser::parser_engine::here()
+    {
+        peek();
+        if (toks_) {
+            return { static_cast<std::uint32_t>(toks_->line(idx_)), static_cast<std::uint32_t>(toks_->column(idx_)), file_, fcn_ };
+        }
+        // step over the whitespace before the token so the lexer counts
+        // its line breaks
+        parser_.advance(ws_);
+        ws_ = 0;
+        return { static_cast<std::uint32_t>(parser_.line()), static_cast<std::uint32_t>(parser_.curr_pos() - parser_.line_start()),
+                 file_, fcn_ };
+    }
+
     bool parser::parser_engine::is_unary_op(const token& t)
     {
         return t.is_a(token_type::MINUS) || t.is_a(token_type::PLUS);
@@ -84,12 +109,7 @@ namespace parser {
         }
     }
 
-    PCSH_INLINE ir::node* parser::parser_engine::call_mem_fn(parser_engine* p, nexttermfcn pfn, source_map& m)
-    {
-        return ((*p).*(pfn))(m);
-    }
-
-    ir::untyped_binary_op_base* parser::parser_engine::create_binary_op(const token& currtok, ir::node* a, source_map& m, nexttermfcn rghtgen)
+    void parser::parser_engine::push_binary_op(const token& currtok, ir::node* a, source_map& m, rule& rght)
     {
         ir::untyped_binary_op_base* op = nullptr;
         switch (currtok.type()) {
@@ -112,17 +132,16 @@ namespace parser {
                 op = arena_.create<ir::assign>();
                 ENSURE(dynamic_cast<ir::variable*>(a) != nullptr,
                        "Left term of assignment is not a variable. Variable name must be a non keyword, alpha - numeric and should not start with a digit.");
-                rghtgen = &parser_engine::expr;
+                rght = rule::EXPR;
                 break;
             default:
                 PCSH_ASSERT_MSG(false, "Invalid binary operation!");
                 break;
         }
-        m[op] = source_info{ parser_.filename_, std::to_string(parser_.line()), func_ };
+        m.add(op, here());
         advance();
         op->set_left(a);
-        op->set_right(call_mem_fn(this, rghtgen, m));
-        return op;
+        conts_.push_back({ continuation::BINARY, op });
     }
 
     ir::untyped_unary_op_base* parser::parser_engine::create_unary_op(const token& nxt, source_map& m)
@@ -139,117 +158,192 @@ namespace parser {
                 PCSH_ASSERT_MSG(false, "Invalid binary operation!");
                 break;
         }
-        m[op] = source_info{ parser_.filename_, std::to_string(parser_.line()), func_ };
+        m.add(op, here());
         advance();
-        op->set_operand(factor(m));
         return op;
     }
 
+    // Statements are parsed with the blocks and if statements they are in
+    // kept on opens_, so nesting is limited by memory only:
+    //
+    //   block  := '{' stmt+ '}' | stmt* EOS
+    //   stmt   := 'if' '(' expr ')' stmt | block | expr ';'
+    //
+    // with only the outermost block ended by the end of the stream.
     ir::block* parser::parser_engine::block(source_map& m)
     {
-        std::vector<ir::node*> stmts;
-        stmts.reserve(20);
-
-        auto t = peek();
-        bool startWithLbrace = t.is_a(token_type::LBRACE);
-
-        if (startWithLbrace) {
+        const auto base = opens_.size();
+        opens_.push_back({ nullptr, stmts_.size(), false });
+        if (peek().is_a(token_type::LBRACE)) {
             advance();
+            opens_.back().braced = true;
         }
 
         while (true) {
-            if (t.is_a(token_type::EOS)) {
-                if (!startWithLbrace) {
-                    break;
-                } else {
-                    ENSURE(false, "Unexpected end of stream while reading a block. Expected a `}' before termination.");
+            const auto open = opens_.back();
+            ir::node* done = nullptr;
+            if (!open.cond && (!open.braced || (stmts_.size() != open.first))) {
+                // the end of a block; braces hold at least one statement
+                auto t = peek();
+                if (t.is_a(token_type::EOS)) {
+                    ENSURE(!open.braced, "Unexpected end of stream while reading a block. Expected a `}' before termination.");
+                    done = arena_.create<ir::block>(arena_);
+                } else if (t.is_a(token_type::RBRACE)) {
+                    ENSURE(open.braced, "Unexpected `}'. Did not see a `{' to start a block.");
+                    advance();
+                    done = arena_.create<ir::block>(arena_);
+                }
+                if (done) {
+                    auto blk = static_cast<ir::block*>(done);
+                    blk->assign_statements(stmts_.data() + open.first, stmts_.size() - open.first);
+                    stmts_.resize(open.first);
+                    opens_.pop_back();
                 }
             }
-            if (t.is_a(token_type::RBRACE)) {
-                if (!startWithLbrace) {
-                    ENSURE(false, "Unexpected `}'. Did not see a `{' to start a block.");
-                } else {
+            if (!done) {
+                auto t = peek();
+                if (t.is_a(token_type::IF)) {
+                    opens_.push_back({ ifcond(m), 0, false });
+                    continue;
+                }
+                if (t.is_a(token_type::LBRACE)) {
                     advance();
-                    break;
+                    opens_.push_back({ nullptr, stmts_.size(), true });
+                    continue;
                 }
+                done = expr(m);
+                ENSURE(peek().is_a(token_type::SEMICOLON), "Expected the end of a statement with `;'");
+                advance();
             }
-            stmts.push_back(stmt(m));
-            t = peek();
-    }
 
-        ir::block* blk = arena_.create<ir::block>(arena_);
-        auto beg = stmts.rbegin();
-        const auto end = stmts.rend();
-        for (; beg != end; ++beg) {
-            blk->push_front_statement(*beg);
+            // hand the statement to what it is in, ending the if statements
+            // it is the body of
+            while (opens_.size() != base && opens_.back().cond) {
+                done = arena_.create<ir::if_stmt>(opens_.back().cond, done);
+                opens_.pop_back();
+            }
+            if (opens_.size() == base) {
+                return static_cast<ir::block*>(done);
+            }
+            stmts_.push_back(done);
         }
-        return blk;
     }
 
+    // Expressions are parsed with the rules waiting on an operand kept on
+    // conts_ rather than on the call stack, so long operator chains and
+    // deeply nested parentheses are limited by memory only:
+    //
+    //   expr   := arith (('+' | '-' | '==') arith)*
+    //   arith  := term (binop term)*
+    //   term   := unop [binop unop]
+    //   unop   := ('+' | '-') factor | factor
+    //   factor := '(' expr ')' | atom
+    //
+    // with the right side of `=' always an expr.
     ir::node* parser::parser_engine::expr(source_map& m)
     {
-        ir::node* a = arith(m);
-        auto t = peek();
-        while (t.is_a(token_type::PLUS) || t.is_a(token_type::MINUS) || t.is_a(token_type::ISEQUAL)) {
-            a = create_binary_op(t, a, m, &parser_engine::arith);
-            t = peek();
-        }
-        return a;
-    }
-
-    ir::node* parser::parser_engine::stmt(source_map& m)
-    {
-        auto t = peek();
-        ir::node* op = nullptr;
-        if (t.is_a(token_type::IF)) {
-            op = ifstmt(m);
-        } else if (t.is_a(token_type::LBRACE)) {
-            op = block(m);
-        } else {
-            op = expr(m);
-            ENSURE(peek().is_a(token_type::SEMICOLON), "Expected the end of a statement with `;'");
-            advance();
-        }
-        return op;
-    }
-
-    ir::node* parser::parser_engine::arith(source_map& m)
-    {
-        auto *a = term(m);
-        auto t = peek();
-        while (is_binary_op(t)) {
-            a = create_binary_op(t, a, m, &parser_engine::term);
-            t = peek();
-        }
-        return a;
-    }
-
-    ir::node* parser::parser_engine::term(source_map& m)
-    {
-        ir::node* a = unop(m);
-        auto t = peek();
-        if (is_binary_op(t)) {
-            a = create_binary_op(t, a, m, &parser_engine::unop);
-        }
-        return a;
-    }
+        const auto base = conts_.size();
+        auto r = rule::EXPR;
+        ir::node* a = nullptr;
+        while (true) {
+            // descend to the next atom
+            bool descend = true;
+            while (descend) {
+                switch (r) {
+                    case rule::EXPR:
+                        conts_.push_back({ continuation::EXPR_LOOP, nullptr });
+                        r = rule::ARITH;
+                        break;
+                    case rule::ARITH:
+                        conts_.push_back({ continuation::ARITH_LOOP, nullptr });
+                        r = rule::TERM;
+                        break;
+                    case rule::TERM:
+                        conts_.push_back({ continuation::TERM_OPT, nullptr });
+                        r = rule::UNOP;
+                        break;
+                    case rule::UNOP: {
+                        auto t = peek();
+                        if (is_unary_op(t)) {
+                            conts_.push_back({ continuation::UNARY, create_unary_op(t, m) });
+                        }
+                        r = rule::FACTOR;
+                        break;
+                    }
+                    case rule::FACTOR:
+                        if (peek().is_a(token_type::LPAREN)) {
+                            advance();
+                            conts_.push_back({ continuation::PAREN, nullptr });
+                            r = rule::EXPR;
+                        } else {
+                            a = atom(m);
+                            descend = false;
+                        }
+                        break;
+                }
+            }
 
-    ir::node* parser::parser_engine::factor(source_map& m)
-    {
-        auto t = peek();
-        if (t.is_a(token_type::LPAREN)) {
-            advance();
-            auto e = expr(m);
-            t = peek();
-            ENSURE(t.is_a(token_type::RPAREN), "Unmatched `(' when parsing an expression.");
-            advance();
-            return e;
-        } else {
-            return atom(m);
+            // hand the operand up until a rule wants another one
+            bool more = false;
+            while (!more && conts_.size() != base) {
+                const auto c = conts_.back();
+                switch (c.kind) {
+                    case continuation::EXPR_LOOP: {
+                        auto t = peek();
+                        if (t.is_a(token_type::PLUS) || t.is_a(token_type::MINUS) || t.is_a(token_type::ISEQUAL)) {
+                            r = rule::ARITH;
+                            push_binary_op(t, a, m, r);
+                            more = true;
+                        } else {
+                            conts_.pop_back();
+                        }
+                        break;
+                    }
+                    case continuation::ARITH_LOOP: {
+                        auto t = peek();
+                        if (is_binary_op(t)) {
+                            r = rule::TERM;
+                            push_binary_op(t, a, m, r);
+                            more = true;
+                        } else {
+                            conts_.pop_back();
+                        }
+                        break;
+                    }
+                    case continuation::TERM_OPT: {
+                        auto t = peek();
+                        conts_.pop_back();
+                        if (is_binary_op(t)) {
+                            r = rule::UNOP;
+                            push_binary_op(t, a, m, r);
+                            more = true;
+                        }
+                        break;
+                    }
+                    case continuation::BINARY:
+                        static_cast<ir::untyped_binary_op_base*>(c.op)->set_right(a);
+                        a = c.op;
+                        conts_.pop_back();
+                        break;
+                    case continuation::UNARY:
+                        static_cast<ir::untyped_unary_op_base*>(c.op)->set_operand(a);
+                        a = c.op;
+                        conts_.pop_back();
+                        break;
+                    case continuation::PAREN:
+                        ENSURE(peek().is_a(token_type::RPAREN), "Unmatched `(' when parsing an expression.");
+                        advance();
+                        conts_.pop_back();
+                        break;
+                }
+            }
+            if (!more) {
+                return a;
+            }
         }
     }
 
-    ir::node* parser::parser_engine::ifstmt(source_map& m)
+    ir::node* parser::parser_engine::ifcond(source_map& m)
     {
         auto t = peek();
         PCSH_ASSERT_MSG(t.is_a(token_type::IF), "Expected an `if' statement.");
@@ -261,41 +355,37 @@ namespace parser {
         t = peek();
         ENSURE(t.is_a(token_type::RPAREN), "Expected a `)' after an if statement expression.");
         advance();
-        return arena_.create<ir::if_stmt>(cond, stmt(m));
-    }
-
-    ir::node* parser::parser_engine::unop(source_map& m)
-    {
-        auto t = peek();
-        if (is_unary_op(t)) {
-            return create_unary_op(t, m);
-        } else {
-            return factor(m);
-        }
+        return cond;
     }
 
     namespace conversions {
 
-        PCSH_INLINE int to_int(const token& t)
+        // Tokens may point into read-only memory without a terminator, so
+        // numbers are copied out before conversion.
+
+        template <class Convert>
+        PCSH_INLINE auto convert_number(const token& t, Convert cvt) -> decltype(cvt(""))
         {
+            static const size_t MAX_INLINE = 63;
             size_t len = t.length();
-            char* s = const_cast<char*>(t.str().ptr);
-            auto oldval = s[len];
-            s[len] = '\0';
-            int i = ::atoi(s);
-            s[len] = oldval;
-            return i;
+            if (PCSH_LIKELY(len <= MAX_INLINE)) {
+                char s[MAX_INLINE + 1];
+                ::memcpy(s, t.str().ptr, len);
+                s[len] = '\0';
+                return cvt(s);
+            }
+            std::string s(t.str().ptr, len);
+            return cvt(s.c_str());
+        }
+
+        PCSH_INLINE int to_int(const token& t)
+        {
+            return convert_number(t, [](const char* s) { return ::atoi(s); });
         }
 
         PCSH_INLINE double to_double(const token& t)
         {
-            size_t len = t.length();
-            char* s = const_cast<char*>(t.str().ptr);
-            auto oldval = s[len];
-            s[len] = '\0';
-            double f = ::atof(s);
-            s[len] = oldval;
-            return f;
+            return convert_number(t, [](const char* s) { return ::atof(s); });
         }
 
     }//namespace conversions
@@ -306,7 +396,7 @@ namespace parser {
         ir::untyped_atom_base* v = nullptr;
         switch (t.type()) {
             case token_type::SYMBOL:
-                v = arena_.create<ir::variable>(arena_.create_string(t.str().ptr, t.length()));
+                v = arena_.create<ir::variable>(strings_.intern(t.str().ptr, t.length()));
                 break;
             case token_type::INTEGER:
                 v = arena_.create<ir::int_constant>(conversions::to_int(t));
@@ -315,16 +405,15 @@ namespace parser {
                 v = arena_.create<ir::float_constant>(conversions::to_double(t));
                 break;
             case token_type::QUOTE: {
-                // we have a static string's data here. copy into a new string
-                cstring str = arena_.create_string(t.str().ptr);
-                v = arena_.create<ir::string_constant>(str);
+                // we have a static string's data here. intern a copy
+                v = arena_.create<ir::string_constant>(strings_.intern(t.str().ptr));
                 break;
             }
             default:
-                PCSH_ASSERT_MSG(false, "Invalid atom value!");
+                ENSURE(false, "Expected an expression.");
                 break;
         }
-        m[v] = source_info{ parser_.filename_, std::to_string(parser_.line()), func_ };
+        m.add(v, here());
         advance();
         return v;
     }
@@ -10,9 +10,12 @@
 #include "pcsh/parser.hpp"
 
 #include "ir/nodes_fwd.hpp"
+#include "ir/string_table.hpp"
 
+#include <cstdint>
+#include <cstring>
 #include <string>
-#include <unordered_map>
+#include <vector>
 
 #if !defined(PCSH_INLINE)
 #  if !defined(_MSC_VER)
@@ -33,23 +36,77 @@
 namespace pcsh {
 namespace parser {
 
-    /// map node to source info
-    struct source_info
+    /// where the token that made a node starts
+    struct source_loc
     {
-        std::string filename;
-        std::string line;
-        std::string fcn;
+        std::uint32_t line;
+        std::uint32_t column;
+        std::uint16_t file;     // ids from source_map::name_id()
+        std::uint16_t fcn;
     };
 
-    using source_map = std::unordered_map<ir::node*, source_info>;
+    /// Locations of the nodes of one parse, in parse order. A node's
+    /// location() is its index here; names point into the parser and its
+    /// engine.
+    class source_map : public noncopyable
+    {
+      public:
+        source_map(arena& scratch)
+          : locs_(arena_allocator<source_loc>(scratch))
+          , names_(arena_allocator<cstring>(scratch))
+        { }
+
+        // a parse names one file and a few functions, so a scan will do
+        inline std::uint16_t name_id(cstring name)
+        {
+            for (size_t i = 0; i != names_.size(); ++i) {
+                if (::strcmp(names_[i], name) == 0) {
+                    return static_cast<std::uint16_t>(i);
+                }
+            }
+            PCSH_ASSERT_MSG(names_.size() < 0xFFFF, "Too many source names.");
+            names_.push_back(name);
+            return static_cast<std::uint16_t>(names_.size() - 1);
+        }
+
+        inline cstring name(std::uint16_t id) const
+        {
+            return names_[id];
+        }
+
+        inline void add(ir::node* n, const source_loc& loc)
+        {
+            n->set_location(static_cast<std::uint32_t>(locs_.size()));
+            locs_.push_back(loc);
+        }
+
+        /// nullptr for nodes this parse did not make
+        inline const source_loc* find(const ir::node* n) const
+        {
+            auto i = n->location();
+            return (i < locs_.size()) ? &locs_[i] : nullptr;
+        }
+      private:
+        std::vector<source_loc, arena_allocator<source_loc>> locs_;
+        std::vector<cstring, arena_allocator<cstring>> names_;
+    };
 
     /// parser_engine
     class parser::parser_engine
     {
       public:
-        parser_engine(parser& p, arena& a)
+        // `scratch' holds what is only needed while parsing
+        parser_engine(parser& p, arena& a, arena& scratch)
           : parser_(p), arena_(a)
+          , stmts_(arena_allocator<ir::node*>(scratch))
+          , opens_(arena_allocator<open_stmt>(scratch))
+          , conts_(arena_allocator<continuation>(scratch))
+          , strings_(a, scratch)
+          , toks_(p.toks_)
+          , idx_(0)
           , func_("(main)")
+          , file_(0)
+          , fcn_(0)
           , parsed_(false)
           , ws_(0)
           , curr_(token::get(token_type::EOS, "\xFF", 1))
@@ -60,12 +117,62 @@ namespace parser {
         //
         inline ir::block* parse(source_map& m)
         {
+            file_ = m.name_id(parser_.filename_.c_str());
+            fcn_ = m.name_id(func_.c_str());
             return block(m);
         }
       private:
         parser& parser_;
         arena&  arena_;
+        // what the rules of an expression are parsing
+        enum class rule : std::uint8_t
+        {
+            EXPR,
+            ARITH,
+            TERM,
+            UNOP,
+            FACTOR
+        };
+
+        // what to do with an operand once it is parsed
+        struct continuation
+        {
+            enum kind_t : std::uint8_t
+            {
+                EXPR_LOOP,      // more `+', `-' or `==' in an expr
+                ARITH_LOOP,     // more binary operators in an arith
+                TERM_OPT,       // one optional binary operator in a term
+                BINARY,         // right operand of `op'
+                UNARY,          // operand of `op'
+                PAREN           // the closing `)'
+            };
+
+            kind_t kind;
+            ir::node* op;
+        };
+
+        // a block or if statement whose statements are being parsed
+        struct open_stmt
+        {
+            ir::node* cond;     // of an if statement, nullptr for a block
+            size_t first;       // of a block's statements in stmts_
+            bool braced;        // a block opened by `{'
+        };
+
+        // statements of the blocks being parsed, innermost last
+        std::vector<ir::node*, arena_allocator<ir::node*>> stmts_;
+        // blocks and if statements being parsed, innermost last
+        std::vector<open_stmt, arena_allocator<open_stmt>> opens_;
+        // pending rules of the expressions being parsed, innermost last
+        std::vector<continuation, arena_allocator<continuation>> conts_;
+        // names and literals, one copy each
+        ir::string_table strings_;
+        // pre-lexed tokens, walked by index instead of the lazy lexer
+        const token_stream* toks_;
+        size_t idx_;
         std::string func_;
+        std::uint16_t file_;
+        std::uint16_t fcn_;
         bool parsed_;
         pos_t ws_;
         token curr_;
@@ -74,21 +181,12 @@ namespace parser {
 
         ir::block* block(source_map& m);
 
-        ir::node* stmt(source_map& m);
-
-        ir::node* factor(source_map& m);
-
-        ir::node* term(source_map& m);
-
         ir::node* expr(source_map& m);
 
-        ir::node* arith(source_map& m);
-
-        ir::node* unop(source_map& m);
-
         ir::node* atom(source_map& m);
 
-        ir::node* ifstmt(source_map& m);
+        // `if (cond)', returning cond
+        ir::node* ifcond(source_map& m);
 
         // parser manipulation
 
@@ -98,15 +196,13 @@ namespace parser {
 
         void advance();
 
+        source_loc here();
+
         static bool is_unary_op(const token& t);
 
         static bool is_binary_op(const token& nxt);
 
-        typedef ir::node* (parser_engine::*nexttermfcn)(source_map&);
-
-        ir::node* call_mem_fn(parser_engine* p, nexttermfcn pfn, source_map& m);
-
-        ir::untyped_binary_op_base* create_binary_op(const token& currtok, ir::node* a, source_map& m, nexttermfcn rghtgen);
+        void push_binary_op(const token& currtok, ir::node* a, source_map& m, rule& rght);
 
         ir::untyped_unary_op_base* create_unary_op(const token& nxt, source_map& m);
     };
@@ -0,0 +1,119 @@
+/**
+ * \file token_stream.cpp
+ * \date Oct 17, 2026
+ */
+
+#include "pcsh/parser.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <limits>
+
+namespace pcsh {
+namespace parser {
+
+    //////////////////////////////////////////////////////////////////////////
+    /// token_stream
+    //////////////////////////////////////////////////////////////////////////
+
+    token_stream::token_stream(const char* buf, size_t len)
+      : copy_()
+      , data_(buf)
+      , size_(len)
+      , types_()
+      , offsets_()
+      , lengths_()
+      , lines_()
+      , line_starts_()
+      , quotes_()
+      , literals_()
+      , error_(nullptr)
+    {
+        lex();
+    }
+
+    token_stream::token_stream(std::istream& is)
+      : copy_(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>())
+      , data_(copy_.data())
+      , size_(copy_.size())
+      , types_()
+      , offsets_()
+      , lengths_()
+      , lines_()
+      , line_starts_()
+      , quotes_()
+      , literals_()
+      , error_(nullptr)
+    {
+        lex();
+    }
+
+    token token_stream::get(size_t i) const
+    {
+        auto t = types_[i];
+        switch (t) {
+            case token_type::QUOTE: {
+                auto q = std::lower_bound(quotes_.begin(), quotes_.end(), std::make_pair(uint32_t(i), uint32_t(0)));
+                return token(t, literals_.data() + q->second, lengths_[i]);
+            }
+            case token_type::EOS:
+                return token(t, "\xFF", 1);
+            case token_type::FAIL:
+                return token(t, error_, ::strlen(error_));
+            default:
+                return token(t, data_ + offsets_[i], lengths_[i]);
+        }
+    }
+
+    void token_stream::lex()
+    {
+        if (size_ > std::numeric_limits<uint32_t>::max()) {
+            throw_parser_exception("Input is too large to lex up front.", "", "", "");
+        }
+
+        // dense scripts average a token every few bytes
+        auto guess = size_ / 4 + 1;
+        types_.reserve(guess);
+        offsets_.reserve(guess);
+        lengths_.reserve(guess);
+        lines_.reserve(guess);
+        line_starts_.push_back(0);
+
+        parser p(data_, size_);
+        while (true) {
+            pos_t start = 0;
+            auto t = p.peek(0, &start);
+            p.advance(start);
+            while (line_starts_.size() < size_t(p.line())) {
+                line_starts_.push_back(uint32_t(p.line_start()));
+            }
+
+            auto ty = t.type();
+            types_.push_back(ty);
+            offsets_.push_back(uint32_t(p.curr_pos()));
+            lines_.push_back(uint32_t(p.line()));
+            if (ty == token_type::FAIL) {
+                // lexer messages are string literals
+                lengths_.push_back(0);
+                error_ = t.str().ptr;
+                break;
+            }
+            lengths_.push_back(uint32_t(t.length()));
+            if (ty == token_type::EOS) {
+                break;
+            }
+            if (ty == token_type::QUOTE) {
+                // the escaped text lives in a buffer the next string reuses
+                quotes_.push_back(std::make_pair(uint32_t(types_.size() - 1), uint32_t(literals_.size())));
+                literals_.append(t.str().ptr);
+                literals_.push_back('\0');
+                p.advance(t.length() + 2, false);
+            } else {
+                p.advance(t.length());
+            }
+        }
+    }
+
+}// namespace parser
+}// namespace pcsh
@@ -8,6 +8,36 @@
 #include "pcsh/arena.hpp"
 #include "pcsh/assert.hpp"
 
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+    std::atomic<size_t> allocations(0);
+
+}//namespace
+
+// counts every allocation in the process, the library's included
+void* operator new(size_t sz)
+{
+    ++allocations;
+    if (void* p = ::malloc(sz ? sz : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    ::free(p);
+}
+
 CPP_TEST( arena_none )
 {
     pcsh::arena a;
@@ -62,3 +92,317 @@ CPP_TEST( arena_basic )
         static_cast<void>(pfoo);
     }
 }
+
+namespace {
+
+    struct counted
+    {
+        static int alive;
+
+        char bytes[200];
+
+        counted()
+        {
+            ++alive;
+        }
+
+        ~counted()
+        {
+            --alive;
+        }
+    };
+
+    int counted::alive = 0;
+
+}//namespace
+
+CPP_TEST( arena_rollback )
+{
+    pcsh::arena a;
+    a.create<counted>();
+    auto cp = a.mark();
+    auto first = a.create_string("temporary");
+    for (int n = 0; n < 50; ++n) {
+        // spills into new segments
+        a.create<counted>();
+    }
+    TEST_TRUE(counted::alive == 51);
+    a.rollback(cp);
+    TEST_TRUE(counted::alive == 1);
+    // the memory is handed out again
+    TEST_TRUE(a.create_string("temporary") == first);
+    a.rollback(cp);
+    a.rollback(cp);
+    TEST_TRUE(counted::alive == 1);
+}
+
+CPP_TEST( arena_scope_nested )
+{
+    pcsh::arena a;
+    {
+        pcsh::arena_scope outer(a);
+        a.create<counted>();
+        {
+            pcsh::arena_scope inner(a);
+            for (int n = 0; n < 20; ++n) {
+                a.create<counted>();
+            }
+            TEST_TRUE(counted::alive == 21);
+        }
+        TEST_TRUE(counted::alive == 1);
+        a.create_array<char>(4096);
+    }
+    TEST_TRUE(counted::alive == 0);
+}
+
+namespace {
+
+    struct ordered
+    {
+        static int last;
+        static bool inorder;
+
+        int id;
+
+        ordered(int n) : id(n)
+        { }
+
+        ~ordered()
+        {
+            // destroyed newest first
+            inorder = inorder && ((last == 0) || (last == id + 1));
+            last = id;
+        }
+    };
+
+    int ordered::last = 0;
+    bool ordered::inorder = true;
+
+}//namespace
+
+CPP_TEST( arena_no_headers )
+{
+    ordered::last = 0;
+    pcsh::arena a;
+    {/* trivially destructible objects and arrays are packed */
+        auto p = a.create<double>(1.0);
+        auto q = a.create<double>(2.0);
+        auto arr = a.create_array<char>(16);
+        auto r = a.create<int>(3);
+        TEST_TRUE(reinterpret_cast<char*>(q) - reinterpret_cast<char*>(p) == sizeof(double));
+        TEST_TRUE(arr - reinterpret_cast<char*>(q) == sizeof(double));
+        TEST_TRUE(reinterpret_cast<char*>(r) - arr == 16);
+    }
+    {/* so are objects with destructors */
+        // the first one also starts the destructor list
+        a.create<ordered>(1);
+        auto p = a.create<ordered>(2);
+        auto q = a.create<ordered>(3);
+        TEST_TRUE(reinterpret_cast<char*>(q) - reinterpret_cast<char*>(p) == 8);
+        for (int n = 4; n < 100; ++n) {
+            a.create<ordered>(n);
+        }
+        a.rollback(a.mark());
+        TEST_TRUE(ordered::last == 0);
+    }
+}
+
+CPP_TEST( arena_destroys_newest_first )
+{
+    ordered::last = 0;
+    {
+        pcsh::arena a;
+        for (int n = 1; n < 100; ++n) {
+            a.create<ordered>(n);
+        }
+        auto cp = a.mark();
+        a.create<ordered>(100);
+        a.rollback(cp);
+        TEST_TRUE(ordered::last == 100);
+        ordered::last = 0;
+    }
+    TEST_TRUE(ordered::last == 1);
+    TEST_TRUE(ordered::inorder);
+}
+
+namespace {
+
+    void fill(pcsh::arena& a)
+    {
+        for (int n = 0; n < 20; ++n) {
+            a.create<counted>();
+            a.create_string("scratch");
+        }
+        a.create_array<char>(8192);
+    }
+
+}//namespace
+
+CPP_TEST( arena_reset )
+{
+    pcsh::arena a;
+    fill(a);
+    TEST_TRUE(counted::alive == 20);
+    a.reset();
+    TEST_TRUE(counted::alive == 0);
+    size_t before = allocations;
+    fill(a);
+    a.reset();
+    fill(a);
+    // the segments kept by reset are enough
+    TEST_TRUE(allocations == before);
+    TEST_TRUE(counted::alive == 20);
+}
+
+CPP_TEST( arena_segments_pooled )
+{
+    for (int n = 0; n < 4; ++n) {
+        auto a = pcsh::arena::create();
+        fill(*a);
+        pcsh::arena::destroy(a);
+    }
+    TEST_TRUE(counted::alive == 0);
+    size_t before = allocations;
+    for (int n = 0; n < 1000; ++n) {
+        auto a = pcsh::arena::create();
+        fill(*a);
+        pcsh::arena::destroy(a);
+    }
+    TEST_TRUE(allocations == before);
+    TEST_TRUE(counted::alive == 0);
+}
+
+CPP_TEST( arena_policy_growth )
+{
+    {/* segments double up to the largest size */
+        pcsh::arena a;
+        for (int n = 0; n < 64 * 1024; ++n) {
+            a.create_array<char>(64);
+        }
+        // 4MB in 1KB..1MB segments rather than thousands of 1KB ones
+        TEST_TRUE(a.segment_count() < 16);
+    }
+    {/* a size hint makes one segment */
+        pcsh::arena a(pcsh::arena_policy(8 << 20));
+        for (int n = 0; n < 64 * 1024; ++n) {
+            a.create_array<char>(64);
+        }
+        TEST_TRUE(a.segment_count() == 1);
+    }
+    {/* mapped segments */
+        pcsh::arena_policy policy;
+        policy.growth = 1;
+        policy.mmap_threshold = 4096;
+        policy.max_segment = 4096;
+        auto a = pcsh::arena::create(policy);
+        for (int n = 0; n < 100; ++n) {
+            a->create<counted>();
+        }
+        TEST_TRUE(a->segment_count() > 4);
+        a->reset();
+        TEST_TRUE(counted::alive == 0);
+        pcsh::arena::destroy(a);
+    }
+}
+
+CPP_TEST( arena_allocator_containers )
+{
+    typedef std::pair<const int, int> value;
+    typedef std::unordered_map<int, int, std::hash<int>, std::equal_to<int>, pcsh::arena_allocator<value>> map;
+
+    pcsh::arena a(pcsh::arena_policy(1 << 20));
+    size_t before = allocations;
+    {
+        std::vector<int, pcsh::arena_allocator<int>> v((pcsh::arena_allocator<int>(a)));
+        map m(0, map::hasher(), map::key_equal(), map::allocator_type(a));
+        for (int n = 0; n < 1000; ++n) {
+            v.push_back(n);
+            m[n] = 2 * n;
+        }
+        TEST_TRUE(v[999] == 999);
+        TEST_TRUE(m[500] == 1000);
+        TEST_TRUE(m.get_allocator() == pcsh::arena_allocator<int>(a));
+    }
+    // all of it came from the arena
+    TEST_TRUE(allocations == before);
+}
+
+namespace {
+
+    struct tagged
+    {
+        static std::atomic<int> destroyed;
+
+        int owner;
+        int n;
+
+        tagged(int o, int x) : owner(o), n(x)
+        { }
+
+        ~tagged()
+        {
+            ++destroyed;
+        }
+    };
+
+    std::atomic<int> tagged::destroyed(0);
+
+}//namespace
+
+CPP_TEST( arena_concurrent )
+{
+    const int NTHREADS = 4;
+    const int NOBJS = 2000;
+    const int NBUFS = 100;
+
+    pcsh::arena_policy policy;
+    policy.concurrent = true;
+    auto a = pcsh::arena::create(policy);
+
+    for (int round = 0; round < 2; ++round) {
+        tagged::destroyed = 0;
+        std::vector<std::vector<tagged*>> objs(NTHREADS);
+        std::vector<std::vector<char*>> bufs(NTHREADS);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < NTHREADS; ++t) {
+            threads.emplace_back([&, t] {
+                objs[t].reserve(NOBJS);
+                bufs[t].reserve(NBUFS);
+                for (int n = 0; n < NOBJS; ++n) {
+                    objs[t].push_back(a->create<tagged>(t, n));
+                    if (n % (NOBJS / NBUFS) == 0) {
+                        // some too big for a thread's piece of the arena
+                        size_t len = 1 + (n * 7) % 3000;
+                        char* buf = a->create_array<char>(len + 1);
+                        ::memset(buf, 'a' + t, len);
+                        buf[len] = '\0';
+                        bufs[t].push_back(buf);
+                    }
+                }
+            });
+        }
+        for (auto& th : threads) {
+            th.join();
+        }
+
+        // nothing was handed out twice
+        bool intact = true;
+        for (int t = 0; t < NTHREADS; ++t) {
+            for (int n = 0; n < NOBJS; ++n) {
+                intact = intact && (objs[t][n]->owner == t) && (objs[t][n]->n == n);
+            }
+            for (size_t n = 0; n < bufs[t].size(); ++n) {
+                size_t len = 1 + (n * (NOBJS / NBUFS) * 7) % 3000;
+                intact = intact && (::strlen(bufs[t][n]) == len);
+                for (size_t c = 0; c < len; ++c) {
+                    intact = intact && (bufs[t][n][c] == 'a' + t);
+                }
+            }
+        }
+        TEST_TRUE(intact);
+        TEST_TRUE(tagged::destroyed == 0);
+        a->reset();
+        TEST_TRUE(tagged::destroyed == NTHREADS * NOBJS);
+    }
+    pcsh::arena::destroy(a);
+}
@@ -8,8 +8,15 @@
 #include "pcsh/ir.hpp"
 #include "pcsh/ir_operations.hpp"
 #include "pcsh/parser.hpp"
+#include "pcsh/pass_manager.hpp"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
 #include <sstream>
+#include <string>
+#include <vector>
 
 CPP_TEST( tokenizerCommentsAndLines )
 {
@@ -283,6 +290,95 @@ CPP_TEST( irTreeClone )
     }
 }
 
+CPP_TEST( variablesResolveToTheirScopes )
+{
+    using namespace pcsh;
+    // the first `x' is declared in the inner block, so reads outside it
+    // see another `x'; `ox' holds the outer one, which query() would not
+    // pick over the inner one
+    static const char script[] =
+        "w = 1;\n"
+        "{ x = 1; y = x + 1; }\n"
+        "x = 10;\n"
+        "ox = x;\n"
+        "{ z = x * 2; { v = z + x; { w = w + v; } } }\n";
+
+    auto check = [&] (const ir::tree* ptree) {
+        TEST_TRUE(ir::query(ptree, "y").int_val == 2);
+        TEST_TRUE(ir::query(ptree, "ox").int_val == 10);
+        TEST_TRUE(ir::query(ptree, "z").int_val == 20);
+        TEST_TRUE(ir::query(ptree, "v").int_val == 30);
+        TEST_TRUE(ir::query(ptree, "w").int_val == 31);
+    };
+
+    for (auto e : { ir::evaluator::TREE_WALKER, ir::evaluator::FLAT_TREE, ir::evaluator::BYTECODE, ir::evaluator::CLOSURE }) {
+        auto ptree = parser::parser(script, ::strlen(script)).parse_to_tree();
+        ir::evaluate(ptree.get(), e);
+        check(ptree.get());
+
+        // the clone has its own variables and tables, resolved afresh
+        auto cloned = ir::clone(ptree.get());
+        TEST_TRUE(ir::query(cloned.get(), "w").type == result_type::FAILED);
+        ir::evaluate(cloned.get(), e);
+        check(cloned.get());
+        check(ptree.get());
+    }
+}
+
+CPP_TEST( staticVisitorParity )
+{
+    using namespace pcsh;
+    // every node_kind, printed by the node_visitor printer before the
+    // printer and cloner moved to static dispatch
+    static const char script[] =
+        "f = 1.5;\n"
+        "g = -f + (+f) * (f / 3.0) - f;\n"
+        "s = \"str\";\n"
+        "{ c = (g == 0.0); if (c) h = k = f - 1.0; }\n"
+        "if (s == \"x\") { t = s; }\n"
+        "n = 7;\n";
+    static const char expected[] =
+        "(block) at\n"
+        "  (assign <var:f> <double:1.5>)\n"
+        "  (assign <var:g> (mult (plus (un-minus <var:f>) (un-plus <var:f>)) (minus (divide <var:f> <double:3>) <var:f>)))\n"
+        "  (assign <var:s> <string:\"str\">)\n"
+        "  (block) at\n"
+        "    (assign <var:c> (eq <var:g> <double:0>))\n"
+        "    (if-cond-body <var:c> (assign <var:h> (assign <var:k> (minus <var:f> <double:1>))))\n"
+        "  (if-cond-body (eq <var:s> <string:\"x\">) \n"
+        "    (block) at\n"
+        "      (assign <var:t> <var:s>))\n"
+        "  (assign <var:n> <int:7>)\n";
+
+    // block addresses differ from run to run
+    auto printed = [] (const ir::tree* ptree) {
+        std::ostringstream os;
+        ir::print(ptree, os, false);
+        auto out = os.str();
+        for (size_t p = 0; (p = out.find(" at 0x", p)) != std::string::npos; ) {
+            p += 3;
+            auto e = out.find('\n', p);
+            out.erase(p, e - p);
+        }
+        return out;
+    };
+
+    auto ptree = parser::parser(script, ::strlen(script)).parse_to_tree();
+    TEST_TRUE(printed(ptree.get()) == expected);
+    auto cloned = ir::clone(ptree.get());
+    TEST_TRUE(printed(cloned.get()) == expected);
+
+    // clones keep the types the checker gave comparisons
+    for (auto e : { ir::evaluator::TREE_WALKER, ir::evaluator::FLAT_TREE, ir::evaluator::BYTECODE, ir::evaluator::CLOSURE }) {
+        auto copy = ir::clone(ptree.get());
+        ir::evaluate(copy.get(), e);
+        TEST_TRUE(ir::query(copy.get(), "c").int_val == 1);
+        TEST_TRUE(ir::query(copy.get(), "k").dbl_val == 0.5);
+        TEST_TRUE(ir::query(copy.get(), "t").type == result_type::FAILED);
+        TEST_TRUE(ir::query(copy.get(), "n").int_val == 7);
+    }
+}
+
 CPP_TEST( irCreationBasic )
 {
     using namespace pcsh;
@@ -597,3 +693,882 @@ CPP_TEST( eqOp )
         ir::print_variables(ptree.get(), std::cout);
     }
 }
+
+CPP_TEST( bytecodeMatchesTreeWalker )
+{
+    using namespace pcsh;
+    static const char* const script =
+        "#!/usr/bin/env pcsh\n"
+        "n = 7 / 2;\n"
+        "d = 7.0 / 2;\n"
+        "s = \"str\";\n"
+        "e = (1 == 1.5) + (\"a\" == \"a\") + (s == \"str\");\n"
+        "foo = bar = (1 + (car = (caz = 20.0)));\n"
+        "if (n == 3) {\n"
+        "    n = -n * 2 - +1;\n"
+        "    if (d) d = d * -n;\n"
+        "    inner = n + 1;\n"
+        "}\n"
+        "if (0) z = 1;\n"
+        "if (\"\") s = \"unreached\";\n"
+        "x = (d - 0.5 + (+0.5)) * 9;\n"
+        "m = 1;\n"
+        "m = m = m + 1;\n";
+    static const char* const names[] = { "n", "d", "s", "e", "foo", "bar", "car", "caz", "x", "m" };
+
+    std::istringstream is1(script);
+    auto walked = parser::parser(is1).parse_to_tree();
+    ir::evaluate(walked.get(), ir::evaluator::TREE_WALKER);
+
+    std::istringstream is2(script);
+    auto compiled = parser::parser(is2).parse_to_tree();
+    ir::evaluate(compiled.get(), ir::evaluator::BYTECODE);
+
+    std::istringstream is3(script);
+    auto flat = parser::parser(is3).parse_to_tree();
+    ir::evaluate(flat.get(), ir::evaluator::FLAT_TREE);
+
+    std::istringstream is4(script);
+    auto closures = parser::parser(is4).parse_to_tree();
+    ir::evaluate(closures.get(), ir::evaluator::CLOSURE);
+
+    for (auto name : names) {
+        auto a = ir::query(walked.get(), name);
+        for (auto other : { compiled.get(), flat.get(), closures.get() }) {
+            auto b = ir::query(other, name);
+            TEST_TRUE(a.type == b.type);
+            switch (a.type) {
+                case result_type::INTEGER:
+                    TEST_TRUE(a.int_val == b.int_val);
+                    break;
+                case result_type::FLOATING:
+                    TEST_TRUE(a.dbl_val == b.dbl_val);
+                    break;
+                case result_type::STRING:
+                    TEST_TRUE(std::string(a.str_val) == b.str_val);
+                    break;
+                default:
+                    TEST_TRUE(false);
+                    break;
+            }
+        }
+    }
+    TEST_TRUE(ir::query(compiled.get(), "n").int_val == -7);
+    TEST_TRUE(ir::query(compiled.get(), "d").dbl_val == 24.5);
+    TEST_TRUE(ir::query(compiled.get(), "e").int_val == 3);
+    TEST_TRUE(ir::query(compiled.get(), "z").type == result_type::FAILED);
+    TEST_TRUE(ir::query(compiled.get(), "s").str_val == std::string("str"));
+    TEST_TRUE(ir::query(walked.get(), "m").int_val == 2);
+
+    {// reading a variable that was never assigned fails at run time
+        std::istringstream is(
+            "if (0) y = 1;\n"
+            "w = y;\n");
+        auto ptree = parser::parser(is).parse_to_tree();
+        for (auto e : { ir::evaluator::TREE_WALKER, ir::evaluator::FLAT_TREE, ir::evaluator::BYTECODE, ir::evaluator::CLOSURE }) {
+            bool shouldBeTrue = false;
+            try {
+                ir::evaluate(ptree.get(), e);
+            } catch (const parser::exception& ex) {
+                shouldBeTrue = (ex.message().find("`y'") != std::string::npos);
+            }
+            TEST_TRUE(shouldBeTrue);
+        }
+    }
+}
+
+CPP_TEST( flatTreeLimit )
+{
+    using namespace pcsh;
+    static const char script[] = "a = 1;\nb = a + 2;\nc = b * 3;\nif (c) { d = c - 1; }\n";
+
+    const auto limit = ir::flat_tree_limit();
+    TEST_TRUE(limit == (size_t(1) << 28) - 1);
+    ir::set_flat_tree_limit(size_t(1) << 40);
+    TEST_TRUE(ir::flat_tree_limit() == limit);
+
+    // four integer constants do not fit, and evaluation falls back
+    for (size_t n : { size_t(3), size_t(4), limit }) {
+        ir::set_flat_tree_limit(n);
+        auto ptree = parser::parser(script, ::strlen(script)).parse_to_tree();
+        ir::evaluate(ptree.get(), ir::evaluator::FLAT_TREE);
+        ir::evaluate(ptree.get(), ir::evaluator::FLAT_TREE);
+        TEST_TRUE(ir::query(ptree.get(), "b").int_val == 3);
+        TEST_TRUE(ir::query(ptree.get(), "c").int_val == 9);
+        TEST_TRUE(ir::query(ptree.get(), "d").int_val == 8);
+    }
+    TEST_TRUE(ir::flat_tree_limit() == limit);
+}
+
+CPP_TEST( constantFolding )
+{
+    using namespace pcsh;
+    static const char* const script =
+        "#!/usr/bin/env pcsh\n"
+        "day = 60 * 60 * 24;\n"
+        "half = 7 / 2 + 0.5;\n"
+        "t = (1.5 + 1.5 == 3);\n"
+        "u = (\"a\" == \"a\") * 2;\n"
+        "k = 3;\n"
+        "w = k * (2 + 3);\n"
+        "if (2 - 2) dead = 1 / 0;\n"
+        "if (\"\") { dead = 2; }\n"
+        "if (1 - 0.5) live = -(2 * 3);\n";
+
+    for (auto e : { ir::evaluator::TREE_WALKER, ir::evaluator::FLAT_TREE, ir::evaluator::BYTECODE, ir::evaluator::CLOSURE }) {
+        std::istringstream is(script);
+        auto ptree = parser::parser(is).parse_to_tree();
+        ir::evaluate(ptree.get(), e);
+        TEST_TRUE(ir::query(ptree.get(), "day").int_val == 86400);
+        // evaluated in the type of the assigned variable
+        TEST_TRUE(ir::query(ptree.get(), "half").dbl_val == 4.0);
+        TEST_TRUE(ir::query(ptree.get(), "t").int_val == 0);
+        TEST_TRUE(ir::query(ptree.get(), "u").int_val == 2);
+        TEST_TRUE(ir::query(ptree.get(), "w").int_val == 15);
+        TEST_TRUE(ir::query(ptree.get(), "dead").type == result_type::FAILED);
+        TEST_TRUE(ir::query(ptree.get(), "live").int_val == -6);
+    }
+    {// folded expressions and dead branches are gone from the tree
+        std::istringstream is(script);
+        auto ptree = parser::parser(is).parse_to_tree();
+        std::ostringstream os;
+        ir::print(ptree.get(), os, false);
+        auto out = os.str();
+        std::cout << out;
+        TEST_TRUE(out.find("<int:86400>") != std::string::npos);
+        TEST_TRUE(out.find("<int:60>") == std::string::npos);
+        TEST_TRUE(out.find("(div") == std::string::npos);
+        TEST_TRUE(out.find("(plus") == std::string::npos);
+        TEST_TRUE(out.find("<var:dead>") == std::string::npos);
+        TEST_TRUE(out.find("(mult <var:k> <int:5>)") != std::string::npos);
+    }
+}
+
+CPP_TEST( parseFromBuffer )
+{
+    using namespace pcsh;
+    // lives in read-only memory and is only lexed up to `len'
+    static const char script[] =
+        "#!/usr/bin/env pcsh\n"
+        "n = 40 + 2;\r\n"
+        "d = n / 4.0;\n"
+        "s = \"in \\\"quotes\\\"\";\n"
+        "cut = 1;";
+    const size_t len = sizeof(script) - 1 - 8;
+    parser::parser p(script, len);
+    auto ptree = p.parse_to_tree();
+    ir::evaluate(ptree.get());
+    TEST_TRUE(ir::query(ptree.get(), "n").int_val == 42);
+    TEST_TRUE(ir::query(ptree.get(), "d").dbl_val == 10.5);
+    TEST_TRUE(ir::query(ptree.get(), "s").str_val == std::string("in \"quotes\""));
+    TEST_TRUE(ir::query(ptree.get(), "cut").type == result_type::FAILED);
+
+    {// a number running into the end of the range
+        static const char bad[] = "x = 12;y = 345";
+        bool shouldBeTrue = false;
+        try {
+            parser::parser(bad, sizeof(bad) - 2).parse_to_tree();
+        } catch (const parser::exception& ex) {
+            shouldBeTrue = (ex.message().find("`;'") != std::string::npos);
+        }
+        TEST_TRUE(shouldBeTrue);
+    }
+}
+
+CPP_TEST( tokenStreamMatchesLexer )
+{
+    using namespace pcsh;
+    static const char script[] =
+        "#!/usr/bin/env pcsh\n"
+        "n = 40 + 2;\r\n"
+        "\n"
+        "d = (n / 4.0) - -1; # trailing\n"
+        "s = \"esc \\\"aped\\\"\";\r"
+        "t = \"two\";\n"
+        "if (n == 42) { e = 1; }\n";
+    const size_t len = sizeof(script) - 1;
+
+    parser::token_stream toks(script, len);
+    {// same tokens, text and positions as the lazy lexer
+        parser::parser p(script, len);
+        size_t idx = 0;
+        while (true) {
+            parser::pos_t start = 0;
+            auto t = p.peek(0, &start);
+            p.advance(start);
+            TEST_TRUE(idx < toks.size());
+            auto u = toks.get(idx);
+            TEST_TRUE(u.type() == t.type());
+            TEST_TRUE(toks.line(idx) == p.line());
+            TEST_TRUE(toks.column(idx) == p.curr_pos() - p.line_start());
+            if (t.is_a(parser::token_type::EOS)) {
+                break;
+            }
+            TEST_TRUE(u.length() == t.length());
+            TEST_TRUE(::strcmp(std::string(u.str().ptr, u.length()).c_str(), std::string(t.str().ptr, t.length()).c_str()) == 0);
+            p.advance(t.length() + (t.is_a(parser::token_type::QUOTE) ? 2 : 0), !t.is_a(parser::token_type::QUOTE));
+            ++idx;
+        }
+        TEST_TRUE(idx + 1 == toks.size());
+    }
+    for (int rep = 0; rep < 2; ++rep) {// parsed more than once
+        auto ptree = parser::parser(toks).parse_to_tree();
+        ir::evaluate(ptree.get());
+        TEST_TRUE(ir::query(ptree.get(), "n").int_val == 42);
+        TEST_TRUE(ir::query(ptree.get(), "d").dbl_val == 11.5);
+        TEST_TRUE(ir::query(ptree.get(), "s").str_val == std::string("esc \"aped\""));
+        TEST_TRUE(ir::query(ptree.get(), "t").str_val == std::string("two"));
+        TEST_TRUE(ir::query(ptree.get(), "e").int_val == 1);
+    }
+    {// from a stream
+        std::istringstream is(std::string(script, len));
+        parser::token_stream copied(is);
+        TEST_TRUE(copied.size() == toks.size());
+        auto ptree = parser::parser(copied).parse_to_tree();
+        ir::evaluate(ptree.get());
+        TEST_TRUE(ir::query(ptree.get(), "d").dbl_val == 11.5);
+    }
+    // errors read the same either way
+    for (auto bad : { "x = 1;\n  y = (2 + 3;\n", "x = 1;\ny = 3abc;\n", "x = \"open" }) {
+        std::string lazy, prelexed;
+        try {
+            parser::parser(bad, ::strlen(bad)).parse_to_tree();
+        } catch (const parser::exception& ex) {
+            lazy = ex.line() + ": " + ex.message();
+        }
+        try {
+            parser::token_stream ts(bad, ::strlen(bad));
+            parser::parser(ts).parse_to_tree();
+        } catch (const parser::exception& ex) {
+            prelexed = ex.line() + ": " + ex.message();
+        }
+        std::cout << prelexed << std::endl;
+        TEST_TRUE(!lazy.empty());
+        TEST_TRUE(lazy == prelexed);
+    }
+}
+
+CPP_TEST( typeErrorsCarryColumns )
+{
+    using namespace pcsh;
+    static const char bad[] = "x = 1;\n\n   z = \"s\" == 2.5;\n";
+    std::vector<std::string> got;
+    try {
+        parser::parser(bad, ::strlen(bad)).parse_to_tree();
+    } catch (const parser::exception& ex) {
+        TEST_TRUE(ex.fcn() == "(main)");
+        got.push_back(ex.line());
+    }
+    try {
+        std::istringstream is(bad);
+        parser::parser(is).parse_to_tree();
+    } catch (const parser::exception& ex) {
+        got.push_back(ex.line());
+    }
+    try {
+        parser::token_stream ts(bad, ::strlen(bad));
+        parser::parser(ts).parse_to_tree();
+    } catch (const parser::exception& ex) {
+        got.push_back(ex.line());
+    }
+    TEST_TRUE(got.size() == 3);
+    for (const auto& line : got) {
+        std::cout << line << std::endl;
+        TEST_TRUE(line == "line 3, char 8");
+    }
+}
+
+CPP_TEST( missingExpressionsAreSyntaxErrors )
+{
+    using namespace pcsh;
+    for (auto bad : { "x = ;", "{ }", "x = 1 + ;" }) {
+        bool shouldBeTrue = false;
+        try {
+            parser::parser(bad, ::strlen(bad)).parse_to_tree();
+        } catch (const parser::exception& ex) {
+            shouldBeTrue = (ex.message().find("Expected an expression.") != std::string::npos);
+        }
+        TEST_TRUE(shouldBeTrue);
+    }
+}
+
+CPP_TEST( passManagerPipeline )
+{
+    using namespace pcsh;
+    static const char script[] = "x = 2 * 3;\nif (0) { y = 1; }\nz = x + 1;\n";
+
+    ir::pass_manager passes;
+    TEST_TRUE(passes.passes().size() == 3);
+    TEST_TRUE(!passes.enable("type-check", false));
+    TEST_TRUE(!passes.enable("type-check", true));
+    TEST_TRUE(!passes.enable("no-such-pass", false));
+    TEST_TRUE(passes.enable("fold", false));
+    TEST_TRUE(!passes.add("type-check", [] (const ir::tree&) { }));
+    int ran = 0;
+    TEST_TRUE(passes.add("count", [&] (const ir::tree&) { ++ran; }));
+    passes.set_timing(true);
+
+    auto ptree = parser::parser(script, ::strlen(script)).parse_to_tree(passes);
+    TEST_TRUE(ran == 1);
+    const auto& stats = passes.stats();
+    std::vector<std::string> names;
+    for (const auto& s : stats) {
+        names.push_back(s.name);
+        TEST_TRUE(s.nodes == stats[0].nodes);
+    }
+    TEST_TRUE((names == std::vector<std::string>{ "parse", "type-check", "compile", "count" }));
+    TEST_TRUE(stats[0].arena_bytes > 0);
+    passes.report(std::cout);
+
+    ir::evaluate(ptree.get());
+    TEST_TRUE(ir::query(ptree.get(), "z").int_val == 7);
+
+    // folding drops the dead branch
+    ir::pass_manager folding;
+    folding.set_timing(true);
+    parser::parser(script, ::strlen(script)).parse_to_tree(folding);
+    TEST_TRUE(folding.stats()[2].name == "fold");
+    TEST_TRUE(folding.stats()[2].nodes < folding.stats()[1].nodes);
+}
+
+CPP_TEST( treeArenaSizedFromInput )
+{
+    using namespace pcsh;
+    std::ostringstream os;
+    for (int n = 0; n < 20000; ++n) {
+        os << "v" << n << " = (" << n << " + 2) * 3 - 1;\n";
+    }
+    auto script = os.str();
+    std::istringstream is(script);
+    auto unsized = parser::parser(is).parse_to_tree();
+    auto sized = parser::parser(script.data(), script.size()).parse_to_tree();
+    std::cout << "segments: " << unsized->get_arena().segment_count() << " unsized, "
+              << sized->get_arena().segment_count() << " sized" << std::endl;
+    TEST_TRUE(sized->get_arena().segment_count() < unsized->get_arena().segment_count());
+    TEST_TRUE(sized->get_arena().segment_count() <= 2);
+}
+
+CPP_TEST( internedNamesAndLiterals )
+{
+    using namespace pcsh;
+    std::istringstream is(
+        "greeting = \"hello\";\n"
+        "other = \"hello\";\n"
+        "count = 1;\n"
+        "{ middle = count + 1; { deeper = middle + count; } }\n");
+    auto ptree = parser::parser(is).parse_to_tree();
+    for (int round = 0; round < 2; ++round) {
+        ir::evaluate(ptree.get());
+        auto g = ir::query(ptree.get(), "greeting");
+        auto o = ir::query(ptree.get(), "other");
+        TEST_TRUE(g.type == result_type::STRING);
+        TEST_TRUE(::strcmp(g.str_val, "hello") == 0);
+        // one copy of each literal per tree
+        TEST_TRUE(g.str_val == o.str_val);
+        TEST_TRUE(ir::query(ptree.get(), "deeper").int_val == 3);
+        TEST_TRUE(ir::query(ptree.get(), "missing").type == result_type::FAILED);
+        ptree = ir::clone(ptree.get());
+    }
+}
+
+CPP_TEST( symbolTablesGrowAndNest )
+{
+    using namespace pcsh;
+    const int NVARS = 200;
+    const int DEPTH = 30;
+    std::ostringstream os;
+    for (int n = 0; n < NVARS; ++n) {
+        os << "v" << n << " = " << n << ";\n";
+    }
+    os << "d0 = v" << (NVARS - 1) << ";\n";
+    for (int d = 1; d <= DEPTH; ++d) {
+        // every other block declares nothing
+        os << "{ " << ((d % 2) ? "" : "e0 = 0; ") << "d" << d << " = d" << (d - 1) << " + 1;\n";
+    }
+    os << std::string(DEPTH, '}') << "\n";
+    auto script = os.str();
+    auto ptree = parser::parser(script.data(), script.size()).parse_to_tree();
+    ir::evaluate(ptree.get());
+    TEST_TRUE(ir::query(ptree.get(), "v0").int_val == 0);
+    TEST_TRUE(ir::query(ptree.get(), "v150").int_val == 150);
+    TEST_TRUE(ir::query(ptree.get(), "d30").int_val == NVARS - 1 + DEPTH);
+}
+
+CPP_TEST( scopesSpillPastInlineDepth )
+{
+    using namespace pcsh;
+    // more nested blocks than scope_stack keeps inline, with names shadowed
+    // and outer variables written from the innermost scope
+    const int DEPTH = 40;
+    std::ostringstream os;
+    os << "x0 = 0;\n";
+    for (int d = 1; d <= DEPTH; ++d) {
+        os << "{ x" << d << " = x" << (d - 1) << " + 1;\n";
+        if (d == 17) {
+            // shadowed below, read here after the inner block is done
+            os << "{ t = 5; u = t * 2; }\nt = 100;\n";
+        }
+    }
+    os << "w = t + x" << DEPTH << ";\nx0 = x0 + x" << DEPTH << ";\n";
+    os << std::string(DEPTH, '}') << "\n";
+    auto script = os.str();
+
+    for (auto e : { ir::evaluator::TREE_WALKER, ir::evaluator::FLAT_TREE, ir::evaluator::BYTECODE, ir::evaluator::CLOSURE }) {
+        auto ptree = parser::parser(script.data(), script.size()).parse_to_tree();
+        ir::evaluate(ptree.get(), e);
+        TEST_TRUE(ir::query(ptree.get(), "x16").int_val == 16);
+        TEST_TRUE(ir::query(ptree.get(), "x17").int_val == 17);
+        TEST_TRUE(ir::query(ptree.get(), "x40").int_val == DEPTH);
+        TEST_TRUE(ir::query(ptree.get(), "u").int_val == 10);
+        TEST_TRUE(ir::query(ptree.get(), "w").int_val == 100 + DEPTH);
+        TEST_TRUE(ir::query(ptree.get(), "x0").int_val == DEPTH);
+
+        auto cloned = ir::clone(ptree.get());
+        ir::evaluate(cloned.get(), e);
+        TEST_TRUE(ir::query(cloned.get(), "w").int_val == 100 + DEPTH);
+        TEST_TRUE(ir::query(cloned.get(), "x0").int_val == DEPTH);
+    }
+}
+
+CPP_TEST( conditionAssignmentsDeclareNothing )
+{
+    using namespace pcsh;
+    {// the condition does not declare `d'
+        static const char bad[] = "if (d = 7.0) if (4 - d - 4) x = 1;\n";
+        bool shouldBeTrue = false;
+        try {
+            parser::parser(bad, ::strlen(bad)).parse_to_tree();
+        } catch (const parser::exception& ex) {
+            shouldBeTrue = (ex.message().find("`-'") != std::string::npos);
+        }
+        TEST_TRUE(shouldBeTrue);
+    }
+    {// but types a declaration made by a later statement
+        static const char bad[] = "z = 0;\n{ if (d = 7.0) x = 1; }\nd = 2;\n";
+        bool shouldBeTrue = false;
+        try {
+            parser::parser(bad, ::strlen(bad)).parse_to_tree();
+        } catch (const parser::exception& ex) {
+            shouldBeTrue = (ex.message().find("`d' is changed") != std::string::npos);
+        }
+        TEST_TRUE(shouldBeTrue);
+    }
+    static const char script[] =
+        "if (c = \"s\") a = 1.5;\n"
+        "if ((e = 2) - 1) b = 3;\n"
+        "if (d = 7.0) x = d;\n"
+        "d = 2.0;\n";
+    for (auto e : { ir::evaluator::TREE_WALKER, ir::evaluator::FLAT_TREE, ir::evaluator::BYTECODE, ir::evaluator::CLOSURE }) {
+        auto ptree = parser::parser(script, ::strlen(script)).parse_to_tree();
+        ir::evaluate(ptree.get(), e);
+        // the values assigned to undeclared names are stored nowhere
+        TEST_TRUE(ir::query(ptree.get(), "c").type == result_type::FAILED);
+        TEST_TRUE(ir::query(ptree.get(), "e").type == result_type::FAILED);
+        TEST_TRUE(ir::query(ptree.get(), "a").dbl_val == 1.5);
+        TEST_TRUE(ir::query(ptree.get(), "b").int_val == 3);
+        TEST_TRUE(ir::query(ptree.get(), "x").dbl_val == 7.0);
+        TEST_TRUE(ir::query(ptree.get(), "d").dbl_val == 2.0);
+    }
+}
+
+CPP_TEST( checkerMatchesTwoPassValidation )
+{
+    using namespace pcsh;
+    // pseudo random statements, heavy on assignments in if conditions
+    struct generator
+    {
+        unsigned state;
+
+        unsigned next(unsigned n)
+        {
+            state = state * 1103515245u + 12345u;
+            return (state >> 16) % n;
+        }
+
+        std::string name()
+        {
+            static const char* const names[] = { "a", "b", "c", "d", "e" };
+            return names[next(5)];
+        }
+
+        // mostly names the script starts by declaring
+        std::string read()
+        {
+            return (next(4) != 0) ? (next(2) ? "p" : "q") : name();
+        }
+
+        std::string value(int depth)
+        {
+            // operands are generated in order, whatever the compiler's
+            // order of evaluation
+            std::string l;
+            switch (next(12)) {
+                case 0:
+                case 1:
+                case 2:
+                    return std::to_string(next(5));
+                case 3:
+                    if (next(2)) {
+                        return std::to_string(next(5));
+                    }
+                    return (next(4) != 0) ? "1.5" : "\"s\"";
+                case 4:
+                case 5:
+                case 6:
+                    return read();
+                case 7:
+                    if (depth == 2) {
+                        return "2";
+                    }
+                    l = value(depth + 1);
+                    l += next(2) ? " - " : " + ";
+                    return "(" + l + value(depth + 1) + ")";
+                case 8:
+                case 9:
+                    if (depth == 2) {
+                        return "0";
+                    }
+                    l = name();
+                    return "(" + l + " = " + value(depth + 1) + ")";
+                case 10:
+                    if (depth == 2) {
+                        return "3";
+                    }
+                    l = value(depth + 1);
+                    return "(" + l + " == " + value(depth + 1) + ")";
+                default:
+                    return (depth == 2) ? "4" : "(-" + value(depth + 1) + ")";
+            }
+        }
+
+        std::string assignment(int depth)
+        {
+            auto l = name();
+            return l + " = " + value(depth);
+        }
+
+        std::string condition()
+        {
+            if (next(3) != 0) {
+                return assignment(1);
+            }
+            // a bare name nothing assigned yet would leave the condition
+            // without a type
+            auto l = read();
+            return "(" + l + " == " + value(1) + ")";
+        }
+
+        void statements(std::string& s, int depth)
+        {
+            for (auto n = 1 + next(3); n != 0; --n) {
+                auto r = next(6);
+                if ((r == 0) && (depth < 3)) {
+                    s += "{ ";
+                    statements(s, depth + 1);
+                    s += "}\n";
+                } else if ((r <= 2) && (depth < 3)) {
+                    s += "if (" + condition() + ") ";
+                    switch (next(4)) {
+                        case 0:
+                        case 1:
+                            s += "{ ";
+                            statements(s, depth + 1);
+                            s += "}\n";
+                            break;
+                        case 2:
+                            s += "if (" + condition() + ") ";
+                            s += assignment(0) + ";\n";
+                            break;
+                        default:
+                            s += assignment(0) + ";\n";
+                            break;
+                    }
+                } else {
+                    s += assignment(0) + ";\n";
+                }
+            }
+        }
+    };
+
+    // FNV-1a of the symbol tables, or of the error, that populating the
+    // tables and type checking in two walks gave each script; 0 where that
+    // crashed on a condition assigning a name nothing declares
+    static const std::uint32_t expected[] = {
+        0x5b2e1471u, 0x76d1aef0u, 0x05e615a6u, 0x053e88a1u, 0x00000000u, 0x346f65cbu, 0x00000000u, 0x23313012u,
+        0xf3b5846fu, 0x2ba7f4fdu, 0x347dbbeeu, 0xa09f8d43u, 0x00000000u, 0x5b2e1471u, 0x42371dbcu, 0x00000000u,
+        0x5b2e1471u, 0x00000000u, 0x03b541ffu, 0xf1912b0eu, 0xde06c886u, 0x42acb01du, 0x00000000u, 0x00000000u,
+        0xcdd302b2u, 0x5b2e1471u, 0x160e9fb4u, 0xcdd302b2u, 0x00000000u, 0x5b2e1471u, 0x00000000u, 0x00000000u,
+        0x347dbbeeu, 0x347dbbeeu, 0xe25aeb14u, 0x00000000u, 0x05e615a6u, 0xf46fe0b9u, 0x00000000u, 0x2de69ee1u,
+        0x00000000u, 0x00000000u, 0x347dbbeeu, 0xe25aeb14u, 0x5b2e1471u, 0x00000000u, 0x42acb01du, 0x3adb181au,
+        0x00000000u, 0x5b2e1471u, 0x160e9fb4u, 0x35cd930du, 0x00000000u, 0x00000000u, 0x3adb181au, 0x497b4aa3u,
+        0xd0c1d035u, 0x160e9fb4u, 0x0f9c9c4cu, 0xa09f8d43u, 0x00000000u, 0x41dc4b50u, 0xf3b5846fu, 0x39688851u,
+        0x5b2e1471u, 0x00000000u, 0x5b2e1471u, 0x4de7cb40u, 0x2250f876u, 0x3ed035afu, 0x76acf9a4u, 0xc95d16bau,
+        0xb2410ad6u, 0x35cd930du, 0x00000000u, 0x72013393u, 0x00000000u, 0x00000000u, 0xcdd302b2u, 0x5b2e1471u,
+        0x35cd930du, 0x73ab567bu, 0x5b2e1471u, 0x5b2e1471u, 0x4ac7eefau, 0x162516a9u, 0x39688851u, 0x00000000u,
+        0xe25aeb14u, 0x00000000u, 0x5b2e1471u, 0x1232083eu, 0x5b2e1471u, 0x5b2e1471u, 0xe25aeb14u, 0x4de7cb40u,
+        0x5b2e1471u, 0xe25aeb14u, 0xc1acfb5bu, 0xd0c1d035u, 0x5c8639cau, 0x5b2e1471u, 0x00000000u, 0x00000000u,
+        0x7f27da61u, 0x5b2e1471u, 0xe1aae6eau, 0xa09f8d43u, 0x1232083eu, 0x00000000u, 0xf3b5846fu, 0x5b2e1471u,
+        0x347dbbeeu, 0xa09f8d43u, 0x05adcb06u, 0x160e9fb4u, 0x11f5ed8eu, 0x7fc9f93au, 0x5b2e1471u, 0x72013393u,
+        0x5b2e1471u, 0x72013393u, 0x5b2e1471u, 0x42acb01du, 0x00000000u, 0xc738f784u, 0xcdd302b2u, 0x05e615a6u,
+        0x0a694030u, 0xcdd302b2u, 0x778c07f9u, 0x72013393u, 0x7d0798f0u, 0x5b2e1471u, 0x1232083eu, 0x88d07aa2u,
+        0x00000000u, 0x5b2e1471u, 0xa09f8d43u, 0xf3b5846fu, 0x497b4aa3u, 0xa09f8d43u, 0xc2a01ce4u, 0x5b2e1471u,
+        0x72013393u, 0x347dbbeeu, 0x28495298u, 0x00000000u, 0x2a49cb24u, 0x00000000u, 0x347dbbeeu, 0x35cd930du,
+        0x39688851u, 0xb60869a7u, 0x42acb01du, 0x39688851u, 0x347dbbeeu, 0x42acb01du, 0x35cd930du, 0x5b2e1471u,
+        0x39688851u, 0x5b2e1471u, 0x5b2e1471u, 0x1232083eu, 0x00000000u, 0x00000000u, 0x5b2e1471u, 0x00000000u,
+        0x469948cfu, 0x3adb181au, 0xf3b5846fu, 0xc78a3651u, 0x5b2e1471u, 0x00000000u, 0x00000000u, 0x00000000u,
+        0x00000000u, 0x56b5a98eu, 0x72013393u, 0x5b2e1471u, 0x39688851u, 0x975a4237u, 0x2ba7f4fdu, 0x39688851u,
+        0xc95d16bau, 0x00000000u, 0x39688851u, 0x703b1720u, 0x00000000u, 0x56db985fu, 0x3f3f789au, 0x00000000u,
+        0x3adb181au, 0xcc859b2du, 0x347dbbeeu, 0x00000000u, 0x72013393u, 0x35cd930du, 0x347dbbeeu, 0x5fb82a60u,
+        0x4de7cb40u, 0xc8fca6d0u, 0x208bed01u, 0x347dbbeeu, 0x00000000u, 0xc1acfb5bu, 0x35cd930du, 0x00000000u,
+        0x39688851u, 0x5676b619u, 0x7fc9f93au, 0x5b2e1471u, 0x7f27da61u, 0x347dbbeeu, 0x1232083eu, 0xc1acfb5bu,
+        0x41dc4b50u, 0x41dc4b50u, 0x3adb181au, 0x35494aa1u, 0x5b2e1471u, 0x5b2e1471u, 0x72013393u, 0xa09f8d43u,
+        0xf3b5846fu, 0x4de7cb40u, 0x346f65cbu, 0x00000000u, 0xd0c1d035u, 0x00000000u, 0x39688851u, 0x5b2e1471u,
+        0x41dc4b50u, 0x5b2e1471u, 0x5b2e1471u, 0x544b267bu, 0x42acb01du, 0x41dc4b50u, 0x00000000u, 0x5b2e1471u,
+        0x0f4b6df0u, 0x1232083eu, 0x5b2e1471u, 0x41dc4b50u, 0x4de7cb40u, 0xb3ef4fbfu, 0x1232083eu, 0x5b2e1471u,
+        0x73ab567bu, 0xfa88a937u, 0xbf9b5aecu, 0xe1169825u, 0x5b2e1471u, 0x39688851u, 0xf4356f00u, 0x5b2e1471u,
+        0x00000000u, 0x35cd930du, 0x1232083eu, 0x5b2e1471u, 0x5b2e1471u, 0x0a694030u, 0xd0c1d035u, 0xd0c1d035u,
+        0xe25aeb14u, 0x39688851u, 0x72013393u, 0x00000000u, 0x5b2e1471u, 0x347dbbeeu, 0x42acb01du, 0x72013393u,
+        0x72013393u, 0x03b541ffu, 0x00000000u, 0x00000000u, 0x72013393u, 0xfd9ba72du, 0x41dc4b50u, 0x35ca8de9u,
+        0xa09f8d43u, 0x1232083eu, 0x00000000u, 0xdae08397u, 0x35cd930du, 0xc1acfb5bu, 0xdae08397u, 0x00000000u,
+        0x1232083eu, 0xec1ee019u, 0x3ed035afu, 0x00000000u, 0xf3b5846fu, 0x51910fc6u, 0x4de7cb40u, 0x9f71142bu,
+        0x42acb01du, 0x5b2e1471u, 0x4de7cb40u, 0xcdd302b2u, 0x5b2e1471u, 0xf4cb2250u, 0xc1acfb5bu, 0x347dbbeeu,
+        0x36da96d6u, 0xa09f8d43u, 0xf3b5846fu, 0x5b2e1471u, 0xa09f8d43u, 0x1232083eu, 0x346f65cbu, 0x912c403fu,
+        0x00000000u, 0x5b2e1471u, 0x1232083eu, 0x0ec5349fu, 0x8d352fb5u, 0x00000000u, 0xde06c886u, 0x1232083eu,
+        0xba29623du, 0x42acb01du, 0xf3b5846fu, 0x39688851u, 0x42acb01du, 0x4de7cb40u, 0xc1acfb5bu, 0xcdd302b2u,
+        0x1232083eu, 0x00000000u, 0x42acb01du, 0x72013393u, 0x35cd930du, 0x00000000u, 0x5b2e1471u, 0x5b2e1471u,
+        0x4de7cb40u, 0xf3b5846fu, 0x4de7cb40u, 0x00000000u, 0xf3b5846fu, 0x39688851u, 0xc1acfb5bu, 0xe25aeb14u,
+        0x72013393u, 0x347dbbeeu, 0xe25aeb14u, 0x160e9fb4u, 0x00000000u, 0x9f71142bu, 0x28495298u, 0x00000000u,
+        0x41dc4b50u, 0xd6f94a17u, 0x7f27da61u, 0x1232083eu, 0x4de7cb40u, 0x35cd930du, 0x5b2e1471u, 0xa09f8d43u,
+        0xf1912b0eu, 0x2ba7f4fdu, 0xa09f8d43u, 0x00000000u, 0x5b2e1471u, 0x4de7cb40u, 0x00000000u, 0x00000000u,
+        0x39688851u, 0x72013393u, 0x00000000u, 0x61a7dd41u, 0x1232083eu, 0xc85c2d08u, 0x00000000u, 0x42acb01du,
+        0x55f713d4u, 0xd0c1d035u, 0x497b4aa3u, 0x00000000u, 0x5b2e1471u, 0x5b2e1471u, 0xdf41a945u, 0x35cd930du,
+        0x1232083eu, 0x9c72e8d9u, 0x2ba7f4fdu, 0x35cd930du, 0xf3b5846fu, 0x174204f4u, 0x5b2e1471u, 0x42371dbcu,
+        0x8ac6b9abu, 0x5b2e1471u, 0x72013393u, 0x1232083eu, 0x00000000u, 0xe4ce5a56u, 0x00000000u, 0x00000000u,
+        0xe25aeb14u, 0x35cd930du, 0x346f65cbu, 0x35cd930du, 0x5b2e1471u, 0x00000000u, 0x00000000u, 0x5b2e1471u,
+        0x2ba7f4fdu, 0x72013393u, 0xd0c1d035u, 0x39688851u, 0x5b2e1471u, 0xa09f8d43u, 0x00000000u, 0xd0c1d035u,
+        0x4de7cb40u, 0x410199dbu, 0x72013393u, 0x00000000u, 0xd0c1d035u, 0x41dc4b50u, 0x00000000u, 0xd0c1d035u,
+        0x5b2e1471u, 0x00000000u, 0x42acb01du, 0x41dc4b50u, 0x5b2e1471u, 0x497b4aa3u, 0x94dc0f3cu, 0x830d15c1u,
+        0x72013393u, 0x4de7cb40u, 0x347dbbeeu, 0x1232083eu, 0x5b2e1471u, 0x5b2e1471u, 0x5b2e1471u, 0x5b2e1471u,
+        0x6e3ef857u, 0x5b2e1471u, 0x00000000u, 0x1232083eu, 0x00000000u, 0xde06c886u, 0x5b2e1471u, 0x00000000u,
+        0x00000000u, 0x00000000u, 0x00000000u, 0x5b2e1471u, 0x0f9c9c4cu, 0x830d15c1u, 0x00000000u, 0xf4356f00u,
+        0xc95d16bau, 0x1232083eu, 0x8f0b83bcu, 0x39688851u, 0x4de7cb40u, 0x00000000u, 0x5b2e1471u, 0x00000000u,
+        0x5b2e1471u, 0x5b2e1471u, 0xc1acfb5bu, 0x4de7cb40u, 0x174204f4u, 0xb2410ad6u, 0x5b2e1471u, 0x1232083eu,
+        0xa09f8d43u, 0x5b2e1471u, 0x5b2e1471u, 0x4de7cb40u, 0x39688851u, 0x72013393u, 0xa09f8d43u, 0x00000000u,
+        0x5b2e1471u, 0xa09f8d43u, 0xe25aeb14u, 0x160e9fb4u, 0x830d15c1u, 0x00000000u, 0xc1acfb5bu, 0x4e627619u,
+        0x43b13b33u, 0x72013393u, 0xaf9b7301u, 0x39688851u, 0x00000000u, 0x1a1d184au, 0x42acb01du, 0xf46fe0b9u,
+        0x72013393u, 0x00000000u, 0xf3b5846fu, 0x160e9fb4u, 0xb2410ad6u, 0x00000000u, 0xa310a3a3u, 0xea37c779u,
+        0x35cd930du, 0x4de7cb40u, 0x00000000u, 0xf3b5846fu, 0x00000000u, 0x4de7cb40u, 0xe25aeb14u, 0x00000000u
+    };
+
+    auto fnv = [] (const std::string& s) {
+        std::uint32_t h = 2166136261u;
+        for (unsigned char c : s) {
+            h = (h ^ c) * 16777619u;
+        }
+        return h;
+    };
+
+    // the symbol tables, outermost block first
+    auto tables = [] (const ir::tree* ptree) {
+        std::ostringstream os;
+        ir::print(ptree, os, true);
+        std::istringstream lines(os.str());
+        std::string line, out;
+        while (std::getline(lines, line)) {
+            auto p = line.find(" | typemap = ");
+            if (p != std::string::npos) {
+                out += line.substr(p + 3) + "\n";
+            }
+        }
+        return out;
+    };
+
+    // each block's variables by name, as a clone declares those assigned
+    // inside expressions in another order
+    auto variables = [] (const ir::tree* ptree) {
+        std::ostringstream os;
+        ir::print_variables(ptree, os);
+        std::istringstream lines(os.str());
+        std::string line, out;
+        std::vector<std::string> vars;
+        auto flush = [&] () {
+            std::sort(vars.begin(), vars.end());
+            for (const auto& v : vars) {
+                out += v + "\n";
+            }
+            vars.clear();
+        };
+        while (std::getline(lines, line)) {
+            auto p = line.find("(block) at ");
+            if (p == std::string::npos) {
+                vars.push_back(line);
+            } else {
+                flush();
+                out += line.substr(0, p + 7) + "\n";
+            }
+        }
+        flush();
+        return out;
+    };
+
+    // evaluated as it parsed, as constant folding would leave a clone with
+    // fewer declarations
+    auto evaluated = [&] (const ir::tree* ptree, ir::evaluator e) {
+        std::string out;
+        try {
+            ir::evaluate(ptree, e);
+        } catch (const parser::exception& ex) {
+            out = ex.message() + "\n";
+        }
+        return out + variables(ptree);
+    };
+
+    for (unsigned n = 0; n != sizeof(expected) / sizeof(expected[0]); ++n) {
+        generator gen = { n + 1 };
+        std::string script = "p = 1;\nq = 2;\n";
+        gen.statements(script, 0);
+        ir::tree::ptr ptree;
+        std::string outcome;
+        try {
+            ptree = parser::parser(script.data(), script.size()).parse_to_tree();
+            outcome = tables(ptree.get());
+        } catch (const parser::exception& ex) {
+            outcome = "ERR " + ex.message();
+        }
+        if ((expected[n] != 0) && (fnv(outcome) != expected[n])) {
+            std::cout << "script " << n << ":\n" << script << outcome << std::endl;
+            TEST_TRUE(false);
+        }
+        if (!ptree) {
+            continue;
+        }
+        // variables bound as the checker went agree with those a clone
+        // binds against its filled tables
+        ir::pass_manager nofold;
+        nofold.enable("fold", false);
+        for (auto e : { ir::evaluator::TREE_WALKER, ir::evaluator::FLAT_TREE, ir::evaluator::BYTECODE, ir::evaluator::CLOSURE }) {
+            auto checked = parser::parser(script.data(), script.size()).parse_to_tree(nofold);
+            auto cloned = ir::clone(checked.get());
+            TEST_TRUE(evaluated(checked.get(), e) == evaluated(cloned.get(), e));
+        }
+    }
+}
+
+CPP_TEST( millionTermExpressions )
+{
+    using namespace pcsh;
+    const int NTERMS = 1000000;
+    const int DEPTH = 100000;
+    const int NESTING = 200000;
+    std::string script = "one = 1;\nx = one";
+    for (int n = 1; n < NTERMS; ++n) {
+        script += (n % 2) ? "+1" : "+one";
+    }
+    script += ";\np = " + std::string(DEPTH, '(') + "-one" + std::string(DEPTH, ')') + ";\nc0";
+    for (int n = 1; n < DEPTH; ++n) {
+        script += " = c" + std::to_string(n);
+    }
+    script += " = x - 1;\nk = 0;\n";
+    // every other condition is a constant, which folding keeps
+    for (int n = 0; n < NESTING; ++n) {
+        script += (n % 2) ? "if (1) " : "if (one) ";
+    }
+    script += "k = x;\nif (one) if (p + 1) k = 0;\n";
+
+    // not printed, each level being indented; the conditions are constants
+    // since names are looked up through every enclosing block
+    std::string blocks = "one = 1;\nb = 0;\n";
+    for (int n = 0; n < NESTING; ++n) {
+        blocks += (n % 2) ? "{ if (1) " : "{ ";
+    }
+    blocks += "b = one + 1;";
+    for (int n = 0; n < NESTING; ++n) {
+        blocks += " }";
+    }
+    blocks += "\n";
+
+    // deeper than any call stack would allow; bounded by memory only
+    for (auto e : { ir::evaluator::TREE_WALKER, ir::evaluator::FLAT_TREE, ir::evaluator::BYTECODE, ir::evaluator::CLOSURE }) {
+        auto ptree = parser::parser(script.data(), script.size()).parse_to_tree();
+        auto pblocks = parser::parser(blocks.data(), blocks.size()).parse_to_tree();
+        if (e == ir::evaluator::TREE_WALKER) {
+            ptree = ir::clone(ptree.get());
+            pblocks = ir::clone(pblocks.get());
+            std::ostringstream os;
+            ir::print(ptree.get(), os, false);
+            TEST_TRUE(os.str().size() > static_cast<size_t>(NTERMS));
+        }
+        ir::evaluate(ptree.get(), e);
+        TEST_TRUE(ir::query(ptree.get(), "x").int_val == NTERMS);
+        TEST_TRUE(ir::query(ptree.get(), "p").int_val == -1);
+        TEST_TRUE(ir::query(ptree.get(), "c0").int_val == NTERMS - 1);
+        TEST_TRUE(ir::query(ptree.get(), ("c" + std::to_string(DEPTH - 1)).c_str()).int_val == NTERMS - 1);
+        TEST_TRUE(ir::query(ptree.get(), "k").int_val == NTERMS);
+        ir::evaluate(pblocks.get(), e);
+        TEST_TRUE(ir::query(pblocks.get(), "b").int_val == 2);
+    }
+}
+
+CPP_TEST( lexerKernelsAgree )
+{
+    using namespace pcsh::parser;
+
+    // runs long enough to cross several 16 and 32 byte blocks, at shifting
+    // alignments, with "\r\n" pairs split across blocks
+    std::string script;
+    int breaks = 0;
+    for (int n = 0; n < 64; ++n) {
+        script += std::string(n % 37, ' ') + "a_very_long_identifier_name_" + std::to_string(n) + std::string(n, 'x');
+        script += " = " + std::string(n % 41 + 1, '7') + "." + std::string(n % 19 + 1, '3');
+        script += (n % 3 == 0) ? " ;\r\n" : (n % 3 == 1) ? ";\t# a comment " + std::string(n, '#') + "\r" : ";\n\n\r\n";
+        breaks += (n % 3 == 2) ? 3 : 1;
+    }
+
+    struct lexed
+    {
+        token_type type;
+        std::string text;
+        int line;
+        pos_t column;
+    };
+
+    auto lex = [&script]() {
+        std::vector<lexed> out;
+        parser p(script.data(), script.size());
+        while (true) {
+            pos_t start = 0;
+            auto t = p.peek(0, &start);
+            if (t.is_a(token_type::EOS) || t.is_a(token_type::FAIL)) {
+                out.push_back({ t.type(), "", p.line(), 0 });
+                break;
+            }
+            p.advance(start);
+            out.push_back({ t.type(), std::string(t.str().ptr, t.length()), p.line(), p.curr_pos() - p.line_start() });
+            p.advance(t.length() + (t.is_a(token_type::QUOTE) ? 2 : 0));
+        }
+        return out;
+    };
+
+    std::string original = lexer_kernels();
+    TEST_TRUE(select_lexer_kernels("scalar"));
+    auto expected = lex();
+    TEST_TRUE(expected.back().type == token_type::EOS);
+    TEST_TRUE(expected.size() == 64 * 4 + 1);
+    // the last `;' is followed by one line break
+    TEST_TRUE(expected[expected.size() - 2].line == breaks);
+
+    for (auto name : { "sse2", "avx2" }) {
+        if (!select_lexer_kernels(name)) {
+            continue;
+        }
+        auto got = lex();
+        TEST_TRUE(got.size() == expected.size());
+        for (size_t k = 0; k != got.size(); ++k) {
+            TEST_TRUE(got[k].type == expected[k].type);
+            TEST_TRUE(got[k].text == expected[k].text);
+            TEST_TRUE(got[k].line == expected[k].line);
+            TEST_TRUE(got[k].column == expected[k].column);
+        }
+    }
+    TEST_TRUE(select_lexer_kernels(original.c_str()));
+}
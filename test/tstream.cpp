@@ -0,0 +1,99 @@
+/**
+ * \file tstream.cpp
+ * \date Oct 17, 2026
+ */
+
+#include "unittest.hpp"
+
+#include "pcsh/parser.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#if !defined(_WIN32)
+#  include <sys/resource.h>
+#endif//!defined(_WIN32)
+
+namespace {
+
+    const char* const STATEMENT =
+        "value_1 = (value_0 + 12345) * 2.5 - \"text\" == \"text\"; # comment\n";
+
+    const size_t TOKENS_PER_STATEMENT = 14;
+
+    // `total' bytes of repeated statements, generated on the fly so the input
+    // never exists in memory as a whole
+    class synthetic_script : public std::streambuf
+    {
+      public:
+        synthetic_script(size_t total) : left_(total), chunk_()
+        {
+            while (chunk_.size() < 64 * 1024) {
+                chunk_ += STATEMENT;
+            }
+        }
+      protected:
+        int underflow() override
+        {
+            if (left_ == 0) {
+                return traits_type::eof();
+            }
+            auto n = std::min(left_, chunk_.size());
+            left_ -= n;
+            auto p = &chunk_[0];
+            setg(p, p, p + n);
+            return traits_type::to_int_type(*p);
+        }
+      private:
+        size_t left_;
+        std::string chunk_;
+    };
+
+    long peak_rss_kb()
+    {
+#if defined(_WIN32)
+        return 0;
+#else
+        struct rusage ru;
+        ::getrusage(RUSAGE_SELF, &ru);
+        return ru.ru_maxrss;
+#endif//defined(_WIN32)
+    }
+
+}//namespace
+
+CPP_TEST( streamWindowBoundedMemory )
+{
+    using namespace pcsh::parser;
+    const size_t stmtlen = ::strlen(STATEMENT);
+    // a whole number of statements, about a gigabyte
+    const size_t total = ((size_t(1) << 30) / stmtlen) * stmtlen;
+
+    auto before = peak_rss_kb();
+    synthetic_script sb(total);
+    std::istream is(&sb);
+    parser p(is);
+    size_t ntokens = 0;
+    bool failed = false;
+    while (true) {
+        pos_t start = 0;
+        auto t = p.peek(0, &start);
+        if (t.is_a(token_type::EOS)) {
+            // past the trailing comment
+            p.advance(start);
+            break;
+        }
+        if (t.is_a(token_type::FAIL)) {
+            failed = true;
+            break;
+        }
+        p.advance(start + t.length() + (t.is_a(token_type::QUOTE) ? 2 : 0));
+        ++ntokens;
+    }
+    TEST_TRUE(!failed);
+    TEST_TRUE(p.curr_pos() == total);
+    TEST_TRUE(ntokens == (total / stmtlen) * TOKENS_PER_STATEMENT);
+    // holding the input would take a gigabyte
+    TEST_TRUE(peak_rss_kb() - before < 16 * 1024);
+}